@@ -1,109 +1,1067 @@
 #include "adaptive_memory_manager.h"
-#include <iostream>
+#include "event_log.h"
 #include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
 
-AdaptiveMemoryManager::AdaptiveMemoryManager() {
-    // Example: create 3 tiers (fast, normal, slow)
-    memoryTiers = {
-        { 64*1024*1024, 64*1024*1024, 1.0f, {} }, // Fast (e.g., L1/L2)
-        { 256*1024*1024, 256*1024*1024, 0.7f, {} }, // Normal (RAM)
-        { 1024*1024*1024, 1024*1024*1024, 0.3f, {} } // Slow (swap/SSD)
+namespace {
+    // Smoothing factors of the usage forecaster: level, trend, forecast error
+    constexpr float LEVEL_ALPHA = 0.5f;
+    constexpr float TREND_BETA = 0.2f;
+    constexpr float ERROR_GAMMA = 0.25f;
+    // Smoothing factor of the per-pass access heat
+    constexpr float HEAT_ALPHA = 0.1f;
+
+    // Example: 3 tiers (fast, normal, slow) sharing one arena
+    constexpr std::pair<size_t, float> TIERS[] = {
+        { 64*1024*1024, 1.0f },   // Fast (e.g., L1/L2)
+        { 256*1024*1024, 0.7f },  // Normal (RAM)
+        { 1024*1024*1024, 0.3f }  // Slow (swap/SSD)
     };
+    constexpr int FAST_TIER = 0;
+    constexpr int SLOW_TIER = static_cast<int>(std::size(TIERS)) - 1;
+    static_assert(std::size(TIERS) == AdaptiveMemoryManager::TIER_COUNT, "TIER_COUNT must match TIERS");
+
+    constexpr size_t totalTierBytes() {
+        size_t total = 0;
+        for (const auto& tier : TIERS) total += tier.first;
+        return total;
+    }
+}
+
+const char* slowTierModeName(SlowTierMode mode) {
+    switch (mode) {
+        case SlowTierMode::MEMORY: return "memory";
+        case SlowTierMode::SWAP_FILE: return "file";
+        case SlowTierMode::COMPRESSED: return "compressed";
+    }
+    return "unknown";
+}
+
+bool parseSlowTierMode(const std::string& name, SlowTierMode& mode) {
+    for (SlowTierMode m : {SlowTierMode::MEMORY, SlowTierMode::SWAP_FILE, SlowTierMode::COMPRESSED}) {
+        if (name == slowTierModeName(m)) {
+            mode = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+void MemoryPrediction::update(size_t currentUsage) {
+    float x = static_cast<float>(currentUsage);
+    if (samples == 0) {
+        level = x;
+    } else {
+        float predicted = level + trend;
+        deviation += ERROR_GAMMA * (std::fabs(x - predicted) - deviation);
+        float previous = level;
+        level = predicted + LEVEL_ALPHA * (x - predicted);
+        trend += TREND_BETA * (level - previous - trend);
+    }
+    if (samples < UINT32_MAX) samples++;
+}
+
+size_t MemoryPrediction::forecast(int steps) const {
+    float expected = level + trend * static_cast<float>(steps);
+    return expected > 0 ? static_cast<size_t>(expected) : 0;
+}
+
+size_t MemoryPrediction::upperBound(float deviations) const {
+    return forecast(1) + static_cast<size_t>(deviations * deviation);
+}
+
+AdaptiveMemoryManager::AdaptiveMemoryManager() : AdaptiveMemoryManager(std::make_shared<ProcessTable>()) {}
+
+AdaptiveMemoryManager::AdaptiveMemoryManager(std::shared_ptr<ProcessTable> table, SlowTierMode slowTier,
+                                             const std::string& swapDirectory)
+    : arena(totalTierBytes()),
+      swapFile(arena.data(), arena.capacityBytes(), slowTier == SlowTierMode::SWAP_FILE ? swapDirectory : std::string()),
+      compressedPages(slowTier == SlowTierMode::COMPRESSED ? arena.data() : nullptr, arena.capacityBytes()),
+      table(std::move(table)), processMemory(*this->table) {
+    for (int i = 0; i < TIER_COUNT; ++i) {
+        size_t capacity = arena.capacityBytes() ? TIERS[i].first : 0;
+        memoryTiers[i].totalSize = capacity;
+        memoryTiers[i].availableSize.store(capacity, std::memory_order_relaxed);
+        memoryTiers[i].accessSpeed = TIERS[i].second;
+    }
 }
 
-void AdaptiveMemoryManager::registerProcess(pid_t pid) {
-    std::lock_guard<std::mutex> lock(mtx);
-    processMemoryNeeds[pid] = MemoryPrediction();
-    processMemoryUsage[pid] = 0;
+AdaptiveMemoryManager::~AdaptiveMemoryManager() { stopRebalancer(); }
+
+ProcessHandle AdaptiveMemoryManager::registerProcess(pid_t pid) {
+    ScopedTimer timer(callStats, TIME_REGISTER);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::MEM_REGISTER, pid);
+    ProcessHandle h = table->acquire(pid);
+    if (processMemory.create(h, [&](ProcessMemoryState& state) { trackUsage(state, h.slot); })) return h;
+    // Registering again gives back the extra table reference, releases what
+    // the process holds and resets its state
+    table->release(pid);
+    releaseHeld(pid);
+    processMemory.find(h, [&](ProcessMemoryState& state) {
+        untrackUsage(state);
+        state = ProcessMemoryState();
+        trackUsage(state, h.slot);
+    });
+    return h;
 }
 
 void AdaptiveMemoryManager::unregisterProcess(pid_t pid) {
-    std::lock_guard<std::mutex> lock(mtx);
-    processMemoryNeeds.erase(pid);
-    processMemoryUsage.erase(pid);
+    ScopedTimer timer(callStats, TIME_UNREGISTER);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::MEM_UNREGISTER, pid);
+    releaseHeld(pid);
+    if (processMemory.erase(pid, [&](ProcessMemoryState& state) { untrackUsage(state); })) table->release(pid);
+}
+
+namespace {
+    thread_local std::vector<ProcessHandle> expiringScratch;
+    thread_local std::vector<std::pair<void*, int>> expiredScratch;
 }
 
 void AdaptiveMemoryManager::analyzeMemoryUsage() {
-    std::lock_guard<std::mutex> lock(mtx);
-    float systemUtilization = calculateSystemMemoryUtilization();
-    auto underutilizedRegions = findUnderutilizedMemoryRegions();
-    auto starvedProcesses = identifyMemoryStarvedProcesses();
-    if (systemUtilization < 0.7f && !starvedProcesses.empty()) {
-        redistributeMemory(underutilizedRegions, starvedProcesses);
-        std::cout << "Redistributed memory due to low utilization." << std::endl;
+    ScopedTimer timer(callStats, TIME_ANALYZE);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::ANALYZE_MEMORY, 0);
+    uint64_t epoch = analysisEpoch.fetch_add(1, std::memory_order_relaxed) + 1;
+    expireReservations(epoch);
+
+    // Both are kept up to date by the calls that change them. Moving memory
+    // is the rebalancer's job: with room to spare and processes starved, it
+    // is woken early rather than left to wait out its interval.
+    if (getMemoryUtilization() >= 0.7f || getStarvedProcessCount() == 0) return;
+    std::lock_guard<std::mutex> lock(rebalancerMtx);
+    if (rebalancerStopping || rebalanceRequested || earlyPass || !rebalancer.joinable()) return;
+    rebalanceRequested = true;
+    rebalancerCv.notify_all();
+}
+
+// Return reservations still unused RESERVATION_TTL passes after they were
+// made to their tiers. Only processes queued in the epoch now expiring are
+// looked at.
+void AdaptiveMemoryManager::expireReservations(uint64_t epoch) {
+    auto& expiring = expiringScratch;
+    {
+        std::lock_guard<StatsMutex> lock(mtx);
+        expiring.swap(reservationQueue[(epoch - RESERVATION_TTL) % (RESERVATION_TTL + 1)]);
+    }
+    auto& expired = expiredScratch;
+    expired.clear();
+    uint64_t wasted = 0;
+    processMemory.findBatch(expiring.size(), [&](size_t i) { return expiring[i]; },
+                            [&](size_t, ProcessMemoryState& state) {
+        Reservation& r = state.reservation;
+        if (!r.addr || r.epoch > epoch || epoch - r.epoch < RESERVATION_TTL) return;
+        expired.emplace_back(r.addr, r.tier);
+        wasted += r.capacity;
+        r = Reservation();
+    });
+    // Keep the vector's capacity for the epoch that reuses it
+    expiring.clear();
+    {
+        std::lock_guard<StatsMutex> lock(mtx);
+        for (const auto& [addr, tier] : expired) releaseLocked(tier, addr);
+        auto& queue = reservationQueue[(epoch - RESERVATION_TTL) % (RESERVATION_TTL + 1)];
+        if (queue.empty()) queue.swap(expiring);
     }
+    counters.reclaimed.fetch_add(expired.size(), std::memory_order_relaxed);
+    counters.wastedBytes.fetch_add(wasted, std::memory_order_relaxed);
+}
+
+// Queue the process's new reservation for expiry unless it is queued for
+// its epoch already. Caller holds the process's stripe; the queue is pushed
+// to under mtx.
+bool AdaptiveMemoryManager::queueReservation(ProcessMemoryState& state) {
+    if (state.queuedEpoch == state.reservation.epoch + 1) return false;
+    state.queuedEpoch = state.reservation.epoch + 1;
+    return true;
 }
 
 void AdaptiveMemoryManager::predictMemoryNeeds(pid_t pid, size_t currentUsage) {
-    std::lock_guard<std::mutex> lock(mtx);
-    auto& prediction = processMemoryNeeds[pid];
-    prediction.update(currentUsage);
-    processMemoryUsage[pid] = currentUsage;
-    auto projectedNeeds = prediction.project(5 * 60);
-    if (projectedNeeds.expectedGrowth > MEMORY_GROWTH_THRESHOLD) {
-        preAllocateMemory(pid, projectedNeeds.expectedGrowth);
-        std::cout << "Pre-allocated memory for PID: " << pid << std::endl;
+    predictMemoryNeeds(table->lookup(pid), currentUsage);
+}
+
+void AdaptiveMemoryManager::predictMemoryNeeds(ProcessHandle process, size_t currentUsage) {
+    ScopedTimer timer(callStats, TIME_PREDICT);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire); t && table->isLive(process)) {
+        t->record(TraceOp::PREDICT_MEMORY, table->pidOf(process.slot), nullptr, static_cast<int64_t>(currentUsage));
+    }
+    // The batch path maps a new slow tier reservation onto the swap file
+    // outside the process's stripe
+    MemoryUsageSample sample{process, currentUsage};
+    predictBatch(&sample, 1);
+}
+
+namespace {
+    // Per-item state carried between the phases of a batch
+    struct BatchScratch {
+        pid_t pid;
+        int tier;
+        size_t target;   // Reservation size wanted
+        size_t capacity; // Block size of the reservation taken or made
+        void* addr;      // Reservation made
+        void* freed;     // Block to return: the previous allocation or a replaced reservation
+        int freedTier;
+        bool recorded;
+        bool queued;     // Reservation to queue for expiry
+    };
+    thread_local std::vector<BatchScratch> batchScratch;
+}
+
+void AdaptiveMemoryManager::predictMemoryNeedsBatch(const MemoryUsageSample* samples, size_t count) {
+    ScopedTimer timer(callStats, TIME_PREDICT_BATCH);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!table->isLive(samples[i].process)) continue;
+            t->record(TraceOp::PREDICT_MEMORY, table->pidOf(samples[i].process.slot), nullptr,
+                      static_cast<int64_t>(samples[i].currentUsage));
+        }
     }
+    predictBatch(samples, count);
 }
 
-void AdaptiveMemoryManager::allocateMemoryByTier(pid_t pid, size_t size, SecurityLevel secLevel) {
-    std::lock_guard<std::mutex> lock(mtx);
-    int tierIndex = selectAppropriateMemoryTier(pid, secLevel);
-    if (tierIndex >= 0 && tierIndex < static_cast<int>(memoryTiers.size())) {
-        memoryTiers[tierIndex].allocations.push_back({pid, size, getCurrentTime(), secLevel, nullptr});
-        memoryTiers[tierIndex].availableSize -= size;
-        processMemoryUsage[pid] += size;
-        std::cout << "Allocated " << size << " bytes to PID: " << pid << " in tier " << tierIndex << std::endl;
+// predictMemoryNeeds(Batch) without the timing and tracing
+void AdaptiveMemoryManager::predictBatch(const MemoryUsageSample* samples, size_t count) {
+    batchScratch.resize(count);
+    for (size_t i = 0; i < count; ++i) batchScratch[i] = BatchScratch{-1, -1, 0, 0, nullptr, nullptr, -1, false, false};
+    uint64_t replaced = 0, replacedBytes = 0;
+    bool reserving = false;
+    // 1. Update forecasts; hand back reservations that no longer fit
+    processMemory.findBatch(count, [&](size_t i) { return samples[i].process; }, [&](size_t i, ProcessMemoryState& state) {
+        BatchScratch& s = batchScratch[i];
+        state.prediction.update(samples[i].currentUsage);
+        setUsage(state, samples[i].currentUsage);
+        s.target = reservationTarget(state);
+        if (s.target == 0) return;
+        s.tier = state.preferredTier;
+        Reservation& r = state.reservation;
+        if (r.addr) {
+            s.freed = r.addr;
+            s.freedTier = r.tier;
+            replaced++;
+            replacedBytes += r.capacity;
+            r = Reservation();
+        }
+        reserving = true;
+    });
+    if (!reserving) return;
+    // 2. One tier lock for every release and reservation
+    {
+        std::lock_guard<StatsMutex> lock(mtx);
+        for (size_t i = 0; i < count; ++i) {
+            BatchScratch& s = batchScratch[i];
+            if (s.target == 0) continue;
+            if (s.freed) releaseLocked(s.freedTier, s.freed);
+            s.addr = reserveLocked(s.tier, s.target);
+            if (s.addr) s.capacity = arena.blockSize(s.addr);
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const BatchScratch& s = batchScratch[i];
+        if (s.addr) prepareBacking(s.addr, s.capacity, s.tier);
+    }
+    // 3. Install; a process unregistered (or reserved) in between gets none
+    uint64_t epoch = analysisEpoch.load(std::memory_order_relaxed);
+    processMemory.findBatch(count, [&](size_t i) { return samples[i].process; }, [&](size_t i, ProcessMemoryState& state) {
+        BatchScratch& s = batchScratch[i];
+        if (!s.addr || state.reservation.addr || state.preferredTier != s.tier) return;
+        state.reservation = Reservation{s.addr, s.capacity, s.tier, epoch};
+        s.recorded = true;
+        s.queued = queueReservation(state);
+    });
+    uint64_t made = 0, madeBytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const BatchScratch& s = batchScratch[i];
+        if (!s.recorded) continue;
+        made++;
+        madeBytes += s.capacity;
+        EventLog::instance().log(LogLevel::INFO, LogEvent::PRE_ALLOCATION, table->pidOf(samples[i].process.slot),
+                                 static_cast<int64_t>(s.capacity));
+    }
+    // Queue the new reservations for expiry and return the orphans
+    {
+        std::lock_guard<StatsMutex> lock(mtx);
+        for (size_t i = 0; i < count; ++i) {
+            const BatchScratch& s = batchScratch[i];
+            if (s.queued) reservationQueue[epoch % (RESERVATION_TTL + 1)].push_back(samples[i].process);
+            else if (s.addr && !s.recorded) releaseLocked(s.tier, s.addr);
+        }
     }
+    counters.reserved.fetch_add(made, std::memory_order_relaxed);
+    counters.reservedBytes.fetch_add(madeBytes, std::memory_order_relaxed);
+    counters.reclaimed.fetch_add(replaced, std::memory_order_relaxed);
+    counters.wastedBytes.fetch_add(replacedBytes, std::memory_order_relaxed);
+}
+
+void AdaptiveMemoryManager::allocateMemoryByTierBatch(const TierRequest* requests, size_t count, void** results) {
+    ScopedTimer timer(callStats, TIME_ALLOCATE_BATCH);
+    // Frees are recorded before they happen and allocations after, so a block
+    // reused by another thread is freed first in the trace as well
+    TraceRecorder* t = trace.load(std::memory_order_acquire);
+    if (t) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!requests[i].previous || !table->isLive(requests[i].process)) continue;
+            t->record(TraceOp::FREE_MEMORY, table->pidOf(requests[i].process.slot), requests[i].previous);
+        }
+    }
+    allocateBatch(requests, count, results);
+    if (!t) return;
+    for (size_t i = 0; i < count; ++i) {
+        if (batchScratch[i].pid < 0) continue;
+        t->record(TraceOp::ALLOCATE_TIER, batchScratch[i].pid, results[i], static_cast<int64_t>(requests[i].size),
+                  static_cast<int64_t>(requests[i].secLevel));
+    }
+}
+
+// allocateMemoryByTier(Batch) without the timing and tracing; leaves each
+// request's owner in batchScratch[i].pid (-1 if unregistered)
+void AdaptiveMemoryManager::allocateBatch(const TierRequest* requests, size_t count, void** results) {
+    batchScratch.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        batchScratch[i] = BatchScratch{-1, -1, 0, 0, nullptr, nullptr, -1, false, false};
+        results[i] = nullptr;
+    }
+    auto handleOf = [&](size_t i) { return requests[i].process; };
+    bool locking = false;
+    // 1. Detach the previous blocks and serve what the reservations can;
+    //    unregistered processes get nothing
+    processMemory.findBatch(count, handleOf, [&](size_t i, ProcessMemoryState& state) {
+        const TierRequest& req = requests[i];
+        BatchScratch& s = batchScratch[i];
+        s.pid = table->pidOf(req.process.slot);
+        OwnedBlock block;
+        if (req.previous && takeOwned(state, req.previous, block)) {
+            setUsage(state, state.usage - std::min(state.usage, block.size));
+            // A moving block is freed by the rebalancer
+            if (!block.moving) {
+                s.freed = block.addr;
+                s.freedTier = block.tier;
+            }
+        }
+        s.tier = selectAppropriateMemoryTier(state, req.secLevel);
+        if (s.tier >= 0) {
+            state.preferredTier = s.tier;
+            s.capacity = takeReservation(state, s.tier, req.size, req.secLevel, results[i]);
+        }
+        locking |= s.freed || (s.tier >= 0 && !results[i]);
+    });
+    // 2. One tier lock for the frees and the remaining allocations
+    if (locking) {
+        {
+            std::lock_guard<StatsMutex> lock(mtx);
+            for (size_t i = 0; i < count; ++i) {
+                BatchScratch& s = batchScratch[i];
+                if (s.freed) releaseLocked(s.freedTier, s.freed);
+                if (s.pid >= 0 && s.tier >= 0 && !results[i]) s.tier = allocateLocked(s.tier, requests[i].size, results[i]);
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            const BatchScratch& s = batchScratch[i];
+            if (results[i] && !s.capacity) prepareBacking(results[i], BuddyArena::blockSizeFor(requests[i].size), s.tier);
+        }
+        // 3. Record the new blocks with their owners
+        processMemory.findBatch(count, handleOf, [&](size_t i, ProcessMemoryState& state) {
+            BatchScratch& s = batchScratch[i];
+            if (s.capacity || !results[i]) return;
+            recordAllocation(state, results[i], requests[i].size, s.tier, requests[i].secLevel);
+            s.recorded = true;
+        });
+    }
+    uint64_t allocations = 0, hits = 0, wasted = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const TierRequest& req = requests[i];
+        BatchScratch& s = batchScratch[i];
+        if (s.pid < 0) continue;
+        if (results[i] && !s.capacity && !s.recorded) {
+            // Unregistered in between; the block has no owner to go to
+            std::lock_guard<StatsMutex> lock(mtx);
+            releaseLocked(s.tier, results[i]);
+            results[i] = nullptr;
+        }
+        if (results[i]) {
+            allocations++;
+            if (s.capacity) {
+                hits++;
+                wasted += s.capacity - BuddyArena::blockSizeFor(req.size);
+            }
+            EventLog::instance().log(LogLevel::INFO, LogEvent::TIER_ALLOCATION, s.pid,
+                                     static_cast<int64_t>(req.size), s.tier);
+        } else {
+            EventLog::instance().log(LogLevel::WARN, LogEvent::ALLOCATION_FAILED, s.pid, static_cast<int64_t>(req.size));
+        }
+    }
+    counters.allocations.fetch_add(allocations, std::memory_order_relaxed);
+    counters.hits.fetch_add(hits, std::memory_order_relaxed);
+    counters.wastedBytes.fetch_add(wasted, std::memory_order_relaxed);
+}
+
+void* AdaptiveMemoryManager::allocateMemoryByTier(pid_t pid, size_t size, SecurityLevel secLevel) {
+    return allocateMemoryByTier(table->lookup(pid), size, secLevel);
+}
+
+void* AdaptiveMemoryManager::allocateMemoryByTier(ProcessHandle process, size_t size, SecurityLevel secLevel) {
+    ScopedTimer timer(callStats, TIME_ALLOCATE);
+    // The batch path maps a new slow tier block onto the swap file outside
+    // the process's stripe
+    TierRequest request{process, size, secLevel, nullptr};
+    void* addr = nullptr;
+    allocateBatch(&request, 1, &addr);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire); t && batchScratch[0].pid >= 0) {
+        t->record(TraceOp::ALLOCATE_TIER, batchScratch[0].pid, addr, static_cast<int64_t>(size),
+                  static_cast<int64_t>(secLevel));
+    }
+    return addr;
+}
+
+bool AdaptiveMemoryManager::freeMemory(pid_t pid, void* addr) {
+    ScopedTimer timer(callStats, TIME_FREE);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::FREE_MEMORY, pid, addr);
+    bool freed = false;
+    processMemory.find(pid, [&](ProcessMemoryState& state) {
+        OwnedBlock block;
+        if (!takeOwned(state, addr, block)) return;
+        setUsage(state, state.usage - std::min(state.usage, block.size));
+        freed = true;
+        // The rebalancer frees it once its backing has changed
+        if (block.moving) return;
+        std::lock_guard<StatsMutex> lock(mtx);
+        releaseLocked(block.tier, block.addr);
+    });
+    return freed;
+}
+
+size_t AdaptiveMemoryManager::releaseProcess(pid_t pid) {
+    ScopedTimer timer(callStats, TIME_RELEASE);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::RELEASE_PROCESS, pid);
+    return releaseHeld(pid);
+}
+
+size_t AdaptiveMemoryManager::releaseHeld(pid_t pid) {
+    std::vector<OwnedBlock> blocks;
+    Reservation reservation;
+    size_t released = 0;
+    processMemory.find(pid, [&](ProcessMemoryState& state) {
+        blocks.swap(state.blocks);
+        reservation = std::exchange(state.reservation, Reservation());
+        for (const auto& block : blocks) released += block.size;
+        setUsage(state, state.usage - std::min(state.usage, released));
+    });
+    if (blocks.empty() && !reservation.addr) return 0;
+    {
+        std::lock_guard<StatsMutex> lock(mtx);
+        for (const auto& block : blocks) {
+            if (!block.moving) releaseLocked(block.tier, block.addr);
+        }
+        if (reservation.addr) releaseLocked(reservation.tier, reservation.addr);
+    }
+    if (reservation.addr) {
+        counters.reclaimed.fetch_add(1, std::memory_order_relaxed);
+        counters.wastedBytes.fetch_add(reservation.capacity, std::memory_order_relaxed);
+    }
+    return released;
+}
+
+void AdaptiveMemoryManager::saveState(const ProcessHandle* handles, size_t count, Snapshot::ProcessRecord* processes,
+                                      Snapshot::MemoryRecord* records) {
+    for (size_t i = 0; i < count; ++i) records[i] = Snapshot::MemoryRecord{};
+    processMemory.findBatch(count, [&](size_t i) { return handles[i]; }, [&](size_t i, ProcessMemoryState& state) {
+        Snapshot::MemoryRecord& r = records[i];
+        r.level = state.prediction.level;
+        r.trend = state.prediction.trend;
+        r.deviation = state.prediction.deviation;
+        r.samples = state.prediction.samples;
+        r.usage = state.usage;
+        r.heat = state.heat;
+        r.preferredTier = static_cast<int8_t>(state.preferredTier);
+        r.placement = static_cast<int8_t>(state.placement);
+        processes[i].managers |= Snapshot::IN_MEMORY;
+    });
+}
+
+void AdaptiveMemoryManager::restoreState(const ProcessHandle* handles, size_t count,
+                                         const Snapshot::ProcessRecord* processes,
+                                         const Snapshot::MemoryRecord* records) {
+    auto tierOrNone = [&](int tier) { return tier >= 0 && tier < TIER_COUNT ? tier : -1; };
+    uint64_t pass = rebalancePass.load(std::memory_order_relaxed);
+    auto handleOf = [&](size_t i) {
+        return processes[i].managers & Snapshot::IN_MEMORY ? handles[i] : ProcessHandle();
+    };
+    processMemory.updateBatch(count, handleOf, [&](size_t i, ProcessMemoryState& state) {
+        const Snapshot::MemoryRecord& r = records[i];
+        untrackUsage(state);
+        state = ProcessMemoryState();
+        trackUsage(state, handles[i].slot);
+        state.prediction.level = r.level;
+        state.prediction.trend = r.trend;
+        state.prediction.deviation = r.deviation;
+        state.prediction.samples = r.samples;
+        setUsage(state, static_cast<size_t>(r.usage));
+        state.heat = r.heat;
+        state.lastAccessPass = pass;
+        state.preferredTier = tierOrNone(r.preferredTier);
+        state.placement = tierOrNone(r.placement);
+    });
+}
+
+ReservationStats AdaptiveMemoryManager::getReservationStats() const {
+    ReservationStats stats;
+    stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+    stats.hits = counters.hits.load(std::memory_order_relaxed);
+    stats.reserved = counters.reserved.load(std::memory_order_relaxed);
+    stats.reservedBytes = counters.reservedBytes.load(std::memory_order_relaxed);
+    stats.wastedBytes = counters.wastedBytes.load(std::memory_order_relaxed);
+    stats.reclaimed = counters.reclaimed.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool AdaptiveMemoryManager::recordMemoryAccess(pid_t pid, void* addr, uint32_t count) {
+    return recordMemoryAccess(table->lookup(pid), addr, count);
+}
+
+bool AdaptiveMemoryManager::recordMemoryAccess(ProcessHandle process, void* addr, uint32_t count) {
+    ScopedTimer timer(callStats, TIME_ACCESS);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire); t && table->isLive(process)) {
+        t->record(TraceOp::RECORD_ACCESS, table->pidOf(process.slot), addr, count);
+    }
+    auto p = static_cast<const char*>(addr);
+    for (;;) {
+        bool owned = false, moving = false;
+        uint64_t finished = 0;
+        processMemory.find(process, [&](ProcessMemoryState& state) {
+            for (auto& block : state.blocks) {
+                auto begin = static_cast<const char*>(block.addr);
+                if (p < begin || p >= begin + block.size) continue;
+                if (block.moving) {
+                    // Keep a demotion from sealing the block, and wait for
+                    // the move to end
+                    block.touched = true;
+                    moveCancelled.store(true, std::memory_order_relaxed);
+                    std::lock_guard<std::mutex> lock(moveMtx);
+                    finished = movesFinished;
+                    moving = true;
+                    return;
+                }
+                // First access since the block was compressed. Pages that do
+                // not come back stay sealed, and the caller must not touch them.
+                if (block.compressed) {
+                    if (!compressedPages.restore(block.addr, BuddyArena::blockSizeFor(block.size))) {
+                        tiering.restoreFailures.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    block.compressed = false;
+                    tiering.accessRestores.fetch_add(1, std::memory_order_relaxed);
+                }
+                state.passAccesses += count;
+                state.unreported += count;
+                if (block.tier == FAST_TIER) state.unreportedFast += count;
+                state.lastAccessPass = rebalancePass.load(std::memory_order_relaxed);
+                owned = true;
+                return;
+            }
+        });
+        if (!moving) return owned;
+        std::unique_lock<std::mutex> lock(moveMtx);
+        moveCv.wait(lock, [&] { return movesFinished != finished; });
+    }
+}
+
+void AdaptiveMemoryManager::startRebalancer(const RebalancerConfig& config) {
+    stopRebalancer();
+    std::lock_guard<std::mutex> lock(rebalancerMtx);
+    rebalancerConfig = config;
+    rebalancerStopping = false;
+    rebalancer = std::thread([this] { rebalancerLoop(); });
+}
+
+void AdaptiveMemoryManager::stopRebalancer() {
+    {
+        std::lock_guard<std::mutex> lock(rebalancerMtx);
+        if (!rebalancer.joinable()) return;
+        rebalancerStopping = true;
+    }
+    rebalancerCv.notify_all();
+    rebalancer.join();
+}
+
+void AdaptiveMemoryManager::rebalancerLoop() {
+    std::unique_lock<std::mutex> lock(rebalancerMtx);
+    for (;;) {
+        rebalancerCv.wait_for(lock, rebalancerConfig.interval, [&] { return rebalancerStopping || rebalanceRequested; });
+        if (rebalancerStopping) return;
+        earlyPass = std::exchange(rebalanceRequested, false);
+        lock.unlock();
+        runRebalancePass();
+        lock.lock();
+    }
+}
+
+void AdaptiveMemoryManager::rebalanceOnce() {
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::REBALANCE, 0);
+    runRebalancePass();
+}
+
+void AdaptiveMemoryManager::runRebalancePass() {
+    ScopedTimer timer(callStats, TIME_REBALANCE);
+    std::lock_guard<std::mutex> passLock(passMtx);
+    RebalancerConfig config;
+    {
+        std::lock_guard<std::mutex> lock(rebalancerMtx);
+        config = rebalancerConfig;
+    }
+    uint64_t pass = rebalancePass.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    // 1. Fold the accesses since the last pass into each process's heat and
+    //    pick candidates against the previous pass's mean heat
+    migrations.clear();
+    double heatSum = 0;
+    size_t processes = 0;
+    uint64_t accesses = 0, fastAccesses = 0;
+    const float hot = meanHeat * config.hotRatio, cold = meanHeat * config.coldRatio;
+    processMemory.forEach([&](pid_t pid, ProcessMemoryState& state) {
+        state.heat += HEAT_ALPHA * (static_cast<float>(state.passAccesses) - state.heat);
+        state.passAccesses = 0;
+        accesses += std::exchange(state.unreported, 0);
+        fastAccesses += std::exchange(state.unreportedFast, 0);
+        heatSum += state.heat;
+        processes++;
+        if (meanHeat == 0) return;
+        int to = -1;
+        if (state.heat >= hot) to = FAST_TIER;
+        else if (state.heat <= cold || pass - state.lastAccessPass >= config.idlePasses) to = SLOW_TIER;
+        if (to < 0) return;
+        bool movable = std::any_of(state.blocks.begin(), state.blocks.end(), [&](const OwnedBlock& b) {
+            return !b.pinned && (b.tier != to || (to == SLOW_TIER && needsBacking(b)));
+        });
+        if (movable) migrations.push_back({pid, state.heat, to});
+    });
+    meanHeat = processes ? static_cast<float>(heatSum / processes) : 0.0f;
+    tiering.accesses.fetch_add(accesses, std::memory_order_relaxed);
+    tiering.fastAccesses.fetch_add(fastAccesses, std::memory_order_relaxed);
+
+    // 2. Demotions first, coldest first: they make room in the fast tier for
+    //    the promotions, hottest first
+    std::sort(migrations.begin(), migrations.end(), [](const Migration& a, const Migration& b) {
+        if (a.to != b.to) return a.to > b.to;
+        return a.to == SLOW_TIER ? a.heat < b.heat : a.heat > b.heat;
+    });
+
+    // 3. Move within the budget. The tier lock is held for one process's
+    //    blocks at a time, and moving a block is O(1) bookkeeping.
+    size_t budget = config.budgetBytes;
+    uint64_t promoted = 0, demoted = 0, promotions = 0, demotions = 0, longest = 0;
+    for (const Migration& m : migrations) {
+        if (budget == 0) break;
+        movingBlocks.clear();
+        processMemory.find(m.pid, [&](ProcessMemoryState& state) {
+            moveCancelled.store(false, std::memory_order_relaxed);
+            size_t moved;
+            auto start = std::chrono::steady_clock::now();
+            {
+                std::lock_guard<StatsMutex> lock(mtx);
+                moved = migrateLocked(state, m.to, budget);
+            }
+            auto held = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            longest = std::max<uint64_t>(longest, static_cast<uint64_t>(held.count()));
+            state.placement = m.to;
+            budget -= moved;
+            (m.to == FAST_TIER ? promoted : demoted) += moved;
+            (m.to == FAST_TIER ? promotions : demotions) += movedBlocks.size();
+            budget -= markMoving(state, m.to, budget, state.lastAccessPass + 1 < pass);
+        });
+        if (movingBlocks.empty()) continue;
+        // The writeback, remap or compression holds no lock: other processes
+        // of the stripe are not stalled behind it
+        moveBacking(m.to);
+        finishMoving(m.pid, m.to);
+    }
+    tiering.passes.fetch_add(1, std::memory_order_relaxed);
+    tiering.promotions.fetch_add(promotions, std::memory_order_relaxed);
+    tiering.demotions.fetch_add(demotions, std::memory_order_relaxed);
+    tiering.promotedBytes.fetch_add(promoted, std::memory_order_relaxed);
+    tiering.demotedBytes.fetch_add(demoted, std::memory_order_relaxed);
+    if (longest > tiering.longestLockNs.load(std::memory_order_relaxed)) {
+        tiering.longestLockNs.store(longest, std::memory_order_relaxed);
+    }
+    if (promoted || demoted) {
+        EventLog::instance().log(LogLevel::INFO, LogEvent::TIER_REBALANCED, 0, static_cast<int64_t>(promoted),
+                                 static_cast<int64_t>(demoted));
+    }
+}
+
+// Move the process's unpinned blocks to tier `to` while the budget and the
+// destination's free bytes allow; returns the bytes moved and lists the blocks
+// in movedBlocks. The blocks keep their addresses: only the tier charges
+// change. Caller holds the process's stripe and mtx.
+size_t AdaptiveMemoryManager::migrateLocked(ProcessMemoryState& state, int to, size_t budget) {
+    size_t moved = 0;
+    movedBlocks.clear();
+    for (size_t i = 0; i < state.blocks.size(); ++i) {
+        OwnedBlock& block = state.blocks[i];
+        if (block.pinned || block.tier == to) continue;
+        size_t bytes = BuddyArena::blockSizeFor(block.size);
+        if (moved + bytes > budget) break;
+        if (memoryTiers[to].availableSize.load(std::memory_order_relaxed) < bytes) continue;
+        memoryTiers[block.tier].availableSize.fetch_add(bytes, std::memory_order_relaxed);
+        memoryTiers[to].availableSize.fetch_sub(bytes, std::memory_order_relaxed);
+        block.tier = to;
+        moved += bytes;
+        movedBlocks.push_back(i);
+    }
+    return moved;
+}
+
+// Mark the blocks migrateLocked moved as moving and list them in
+// movingBlocks for moveBacking. A demotion also takes the process's slow
+// tier blocks that are not on the swap file or compressed yet, within
+// `budget` more bytes, so they change backing outside the stripe as well;
+// returns the bytes of those extra blocks. A demotion changes no backing
+// unless the process is quiet: an access reported since the previous pass
+// began may still be writing. Caller holds the process's stripe.
+size_t AdaptiveMemoryManager::markMoving(ProcessMemoryState& state, int to, size_t budget, bool quiet) {
+    auto mark = [&](OwnedBlock& block) {
+        block.moving = true;
+        movingBlocks.push_back({block.addr, BuddyArena::blockSizeFor(block.size), block.compressed});
+    };
+    size_t extra = 0;
+    if (to == SLOW_TIER && !quiet) return extra;
+    for (size_t i : movedBlocks) mark(state.blocks[i]);
+    if (to != SLOW_TIER) return extra;
+    for (OwnedBlock& block : state.blocks) {
+        if (!needsBacking(block)) continue;
+        size_t bytes = BuddyArena::blockSizeFor(block.size);
+        if (extra + bytes > budget) break;
+        extra += bytes;
+        mark(block);
+    }
+    return extra;
+}
+
+// Give the moving blocks the backing of tier `to`: copy demoted ones to the
+// swap file, remap promoted ones from it; in COMPRESSED mode compress or
+// decompress them. Runs with no lock held; demoted copies are mapped or
+// sealed by finishMoving.
+void AdaptiveMemoryManager::moveBacking(int to) {
+    for (MovingBlock& b : movingBlocks) {
+        // The owner is using the process again: leave the rest where they are
+        if (to == SLOW_TIER && moveCancelled.load(std::memory_order_relaxed)) break;
+        changeBacking(b, to);
+    }
+}
+
+// Under the owner's stripe, map or seal the copies of demoted blocks no
+// access was reported to meanwhile and drop the others, then clear the
+// moving marks and wake the accesses waiting for them. Writeback of the
+// mapped blocks starts after the stripe is released. Blocks the owner let
+// go of meanwhile were left for us and are returned to tier `to`.
+void AdaptiveMemoryManager::finishMoving(pid_t pid, int to) {
+    size_t orphans = movingBlocks.size();
+    processMemory.find(pid, [&](ProcessMemoryState& state) {
+        for (MovingBlock& b : movingBlocks) {
+            auto it = std::find_if(state.blocks.begin(), state.blocks.end(),
+                                   [&](const OwnedBlock& o) { return o.addr == b.addr && o.moving; });
+            if (it == state.blocks.end()) continue;
+            if (b.staged && it->touched) {
+                compressedPages.cancel(b.addr, b.bytes);
+                b.staged = false;
+            } else if (b.staged && compressedPages.enabled()) {
+                // Marked even when no page shrank, so the block is not tried again
+                compressedPages.seal(b.addr, b.bytes);
+                b.compressed = true;
+            } else if (b.staged) {
+                b.staged = swapFile.mapCopied(b.addr, b.bytes);
+            }
+            if (b.staged && b.held) {
+                demoteNs.record(b.ns);
+                tiering.writebacks.fetch_add(1, std::memory_order_relaxed);
+            }
+            it->moving = false;
+            it->touched = false;
+            it->compressed = b.compressed;
+            b.orphan = false;
+            orphans--;
+        }
+    });
+    {
+        std::lock_guard<std::mutex> lock(moveMtx);
+        movesFinished++;
+    }
+    moveCv.notify_all();
+    if (!compressedPages.enabled()) {
+        for (const MovingBlock& b : movingBlocks) {
+            if (b.staged && !b.orphan) swapFile.pageOut(b.addr, b.bytes);
+        }
+    }
+    if (orphans == 0) return;
+    std::lock_guard<StatsMutex> lock(mtx);
+    for (const MovingBlock& b : movingBlocks) {
+        if (b.orphan) releaseLocked(to, b.addr);
+    }
+}
+
+void AdaptiveMemoryManager::changeBacking(MovingBlock& block, int to) {
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&] {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    };
+    if (to == SLOW_TIER) {
+        if (compressedPages.enabled()) {
+            block.staged = compressedPages.covers(block.addr, block.bytes);
+            block.held = compressedPages.stage(block.addr, block.bytes) > 0;
+        } else {
+            block.staged = block.held = swapFile.copyOut(block.addr, block.bytes);
+        }
+        block.ns = elapsed();
+        return;
+    }
+    bool changed = false;
+    if (!compressedPages.enabled()) {
+        changed = swapFile.remapPrivate(block.addr, block.bytes);
+    } else if (block.compressed) {
+        // A failed block stays compressed; its next access tries again
+        changed = compressedPages.restore(block.addr, block.bytes);
+        if (changed) block.compressed = false;
+        else tiering.restoreFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!changed) return;
+    promoteNs.record(elapsed());
+    tiering.remaps.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool AdaptiveMemoryManager::needsBacking(const OwnedBlock& block) const {
+    if (block.tier != SLOW_TIER || block.pinned || block.moving) return false;
+    size_t bytes = BuddyArena::blockSizeFor(block.size);
+    if (compressedPages.enabled()) return !block.compressed && compressedPages.covers(block.addr, bytes);
+    return swapFile.remappable(block.addr, bytes) && !swapFile.shared(block.addr);
+}
+
+TieringStats AdaptiveMemoryManager::getTieringStats() {
+    std::lock_guard<std::mutex> passLock(passMtx);
+    // Pick up accesses recorded since the last pass
+    uint64_t accesses = 0, fastAccesses = 0;
+    processMemory.forEach([&](pid_t, ProcessMemoryState& state) {
+        accesses += std::exchange(state.unreported, 0);
+        fastAccesses += std::exchange(state.unreportedFast, 0);
+    });
+    tiering.accesses.fetch_add(accesses, std::memory_order_relaxed);
+    tiering.fastAccesses.fetch_add(fastAccesses, std::memory_order_relaxed);
+    TieringStats stats;
+    stats.passes = tiering.passes.load(std::memory_order_relaxed);
+    stats.promotions = tiering.promotions.load(std::memory_order_relaxed);
+    stats.demotions = tiering.demotions.load(std::memory_order_relaxed);
+    stats.promotedBytes = tiering.promotedBytes.load(std::memory_order_relaxed);
+    stats.demotedBytes = tiering.demotedBytes.load(std::memory_order_relaxed);
+    stats.accesses = tiering.accesses.load(std::memory_order_relaxed);
+    stats.fastAccesses = tiering.fastAccesses.load(std::memory_order_relaxed);
+    stats.longestLockNs = tiering.longestLockNs.load(std::memory_order_relaxed);
+    stats.fileMaps = tiering.fileMaps.load(std::memory_order_relaxed);
+    stats.writebacks = tiering.writebacks.load(std::memory_order_relaxed);
+    stats.remaps = tiering.remaps.load(std::memory_order_relaxed);
+    stats.accessRestores = tiering.accessRestores.load(std::memory_order_relaxed);
+    stats.restoreFailures = tiering.restoreFailures.load(std::memory_order_relaxed);
+    stats.demoteNs = demoteNs;
+    stats.promoteNs = promoteNs;
+    return stats;
+}
+
+// Walk towards slower tiers from tierIndex until one has budget for the
+// request. Returns the tier used, or -1 with addr left null.
+int AdaptiveMemoryManager::allocateLocked(int tierIndex, size_t size, void*& addr) {
+    size_t block = BuddyArena::blockSizeFor(size);
+    for (; tierIndex < TIER_COUNT; ++tierIndex) {
+        if (memoryTiers[tierIndex].availableSize.load(std::memory_order_relaxed) < block) continue;
+        // Every tier draws on the same arena; if it is full, so are the rest
+        addr = reserveLocked(tierIndex, size);
+        return addr ? tierIndex : -1;
+    }
+    return -1;
+}
+
+// A block charged to exactly this tier, or nullptr
+void* AdaptiveMemoryManager::reserveLocked(int tierIndex, size_t size) {
+    MemoryTier& tier = memoryTiers[tierIndex];
+    size_t block = BuddyArena::blockSizeFor(size);
+    if (tier.availableSize.load(std::memory_order_relaxed) < block) return nullptr;
+    void* addr = tierIndex == SLOW_TIER ? takeSwapBlockLocked(block) : nullptr;
+    if (!addr) addr = arena.allocate(size);
+    if (!addr && swapCacheBytes > 0) {
+        // The budgets count cached blocks as free; give them back to the arena
+        flushSwapCacheLocked();
+        addr = arena.allocate(size);
+    }
+    if (addr) tier.availableSize.fetch_sub(block, std::memory_order_relaxed);
+    return addr;
+}
+
+void AdaptiveMemoryManager::releaseLocked(int tierIndex, void* addr) {
+    size_t block = arena.blockSize(addr);
+    if (block == 0) return;
+    memoryTiers[tierIndex].availableSize.fetch_add(block, std::memory_order_relaxed);
+    // Free blocks must be accessible: the arena keeps its free list in them
+    compressedPages.discard(addr, block);
+    if (swapFile.onFile(addr)) {
+        if (tierIndex == SLOW_TIER && cacheSwapBlockLocked(addr, block)) return;
+        // Free blocks must be anonymous memory: they may be split into blocks
+        // for other tiers, and HIGH security data never goes to disk
+        swapFile.discard(addr, block);
+    }
+    arena.release(addr);
+}
+
+// Keep a freed slow tier block on the swap file for a later slow tier
+// reservation; false if the cache is full
+bool AdaptiveMemoryManager::cacheSwapBlockLocked(void* addr, size_t block) {
+    if (swapCacheBytes + block > SWAP_CACHE_BYTES) return false;
+    size_t order = static_cast<size_t>(__builtin_ctzll(block));
+    if (swapCache.size() <= order) swapCache.resize(order + 1);
+    swapCache[order].push_back(addr);
+    swapCacheBytes += block;
+    return true;
+}
+
+void* AdaptiveMemoryManager::takeSwapBlockLocked(size_t block) {
+    size_t order = static_cast<size_t>(__builtin_ctzll(block));
+    if (order >= swapCache.size() || swapCache[order].empty()) return nullptr;
+    void* addr = swapCache[order].back();
+    swapCache[order].pop_back();
+    swapCacheBytes -= block;
+    return addr;
+}
+
+void AdaptiveMemoryManager::flushSwapCacheLocked() {
+    for (size_t order = 0; order < swapCache.size(); ++order) {
+        for (void* addr : swapCache[order]) {
+            swapFile.discard(addr, size_t(1) << order);
+            arena.release(addr);
+        }
+        swapCache[order].clear();
+    }
+    swapCacheBytes = 0;
+}
+
+// Put a slow tier block of whole pages on the swap file. Called by the
+// block's owner, without mtx, before anyone else knows the address.
+void AdaptiveMemoryManager::prepareBacking(void* addr, size_t blockSize, int tierIndex) {
+    if (tierIndex != SLOW_TIER || !swapFile.remappable(addr, blockSize) || swapFile.onFile(addr)) return;
+    if (swapFile.mapFile(addr, blockSize)) tiering.fileMaps.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Caller holds the process's stripe. On a hit, addr receives the reserved
+// block, which is recorded as allocated; returns the block size (0 on a miss).
+size_t AdaptiveMemoryManager::takeReservation(ProcessMemoryState& state, int tierIndex, size_t size,
+                                              SecurityLevel secLevel, void*& addr) {
+    Reservation& r = state.reservation;
+    if (!r.addr || r.tier != tierIndex || size > r.capacity) return 0;
+    addr = r.addr;
+    size_t capacity = r.capacity;
+    r = Reservation();
+    recordAllocation(state, addr, size, tierIndex, secLevel);
+    return capacity;
+}
+
+// Detach addr from the process's blocks; false if it does not own addr
+bool AdaptiveMemoryManager::takeOwned(ProcessMemoryState& state, void* addr, OwnedBlock& block) {
+    auto it = std::find_if(state.blocks.begin(), state.blocks.end(), [&](const OwnedBlock& b) { return b.addr == addr; });
+    if (it == state.blocks.end()) return false;
+    block = *it;
+    *it = state.blocks.back();
+    state.blocks.pop_back();
+    return true;
+}
+
+void AdaptiveMemoryManager::recordAllocation(ProcessMemoryState& state, void* addr, size_t size, int tierIndex,
+                                             SecurityLevel secLevel) {
+    state.blocks.push_back({addr, size, tierIndex, secLevel == SecurityLevel::HIGH});
+    setUsage(state, state.usage + size);
+}
+
+// Size to reserve for the process's next allocation, or 0 when the forecast
+// is not warmed up yet or the current reservation still covers it
+size_t AdaptiveMemoryManager::reservationTarget(const ProcessMemoryState& state) {
+    if (state.prediction.samples < RESERVATION_WARMUP || state.preferredTier < 0) return 0;
+    size_t target = state.prediction.upperBound(RESERVATION_MARGIN);
+    if (target == 0) return 0;
+    const Reservation& r = state.reservation;
+    // Keep a reservation up to one size class too large, so a forecast
+    // hovering at a class boundary does not churn blocks
+    if (r.addr && r.tier == state.preferredTier && r.capacity >= target &&
+        r.capacity <= 2 * BuddyArena::blockSizeFor(target)) {
+        return 0;
+    }
+    return target;
 }
 
 size_t AdaptiveMemoryManager::getTotalMemoryUsage() {
-    std::lock_guard<std::mutex> lock(mtx);
+    ScopedTimer timer(callStats, TIME_TOTAL_USAGE);
     size_t total = 0;
-    for (const auto& [pid, usage] : processMemoryUsage) total += usage;
+    for (const UsageShard& shard : usageShards) total += shard.bytes.load(std::memory_order_relaxed);
     return total;
 }
 
-std::vector<pid_t> AdaptiveMemoryManager::getAllPIDs() {
-    std::lock_guard<std::mutex> lock(mtx);
-    std::vector<pid_t> pids;
-    for (const auto& [pid, _] : processMemoryNeeds) pids.push_back(pid);
-    return pids;
+TierUsage AdaptiveMemoryManager::getTierUsage(int tier) const {
+    if (tier < 0 || tier >= TIER_COUNT) return TierUsage();
+    const MemoryTier& t = memoryTiers[tier];
+    size_t available = std::min(t.totalSize, t.availableSize.load(std::memory_order_relaxed));
+    return TierUsage{t.totalSize, t.totalSize - available};
 }
 
-float AdaptiveMemoryManager::calculateSystemMemoryUtilization() {
-    size_t total = 0, available = 0;
-    for (const auto& tier : memoryTiers) {
-        total += tier.totalSize;
-        available += tier.availableSize;
+float AdaptiveMemoryManager::getMemoryUtilization() const {
+    size_t total = 0, used = 0;
+    for (int i = 0; i < TIER_COUNT; ++i) {
+        TierUsage u = getTierUsage(i);
+        total += u.capacity;
+        used += u.used;
     }
-    return 1.0f - (float)available / (float)total;
+    return total ? (float)used / (float)total : 0.0f;
 }
 
-std::vector<MemoryRegion> AdaptiveMemoryManager::findUnderutilizedMemoryRegions() {
-    std::vector<MemoryRegion> result;
-    // For demo: return empty
-    return result;
+size_t AdaptiveMemoryManager::getStarvedProcessCount() const {
+    return starvedCount.load(std::memory_order_relaxed);
 }
 
-std::vector<pid_t> AdaptiveMemoryManager::identifyMemoryStarvedProcesses() {
-    std::vector<pid_t> result;
-    for (const auto& [pid, usage] : processMemoryUsage) {
-        if (usage < 2048) result.push_back(pid);
-    }
-    return result;
+CompressionStats AdaptiveMemoryManager::getCompressionStats() const {
+    return compressedPages.stats();
 }
 
-void AdaptiveMemoryManager::redistributeMemory(const std::vector<MemoryRegion>&, const std::vector<pid_t>&) {
-    // Demo: no-op
+std::vector<pid_t> AdaptiveMemoryManager::getAllPIDs() {
+    ScopedTimer timer(callStats, TIME_ALL_PIDS);
+    std::vector<pid_t> pids;
+    processMemory.forEach([&](pid_t pid, const ProcessMemoryState&) { pids.push_back(pid); });
+    return pids;
 }
 
-size_t AdaptiveMemoryManager::getCurrentMemoryUsage(pid_t pid) {
-    auto it = processMemoryUsage.find(pid);
-    return it != processMemoryUsage.end() ? it->second : 0;
+// Set a registered process's usage, keeping the stripe's total and the
+// starved count in step. Caller holds the process's stripe.
+void AdaptiveMemoryManager::setUsage(ProcessMemoryState& state, size_t usage) {
+    size_t previous = state.usage;
+    state.usage = usage;
+    if (usage == previous || state.slot == NO_SLOT) return;
+    std::atomic<size_t>& total = usageShards[processMemory.stripeIndex(state.slot)].bytes;
+    total.store(total.load(std::memory_order_relaxed) + usage - previous, std::memory_order_relaxed);
+    if ((previous < STARVED_BYTES) == (usage < STARVED_BYTES)) return;
+    if (usage < STARVED_BYTES) starvedCount.fetch_add(1, std::memory_order_relaxed);
+    else starvedCount.fetch_sub(1, std::memory_order_relaxed);
 }
 
-int AdaptiveMemoryManager::selectAppropriateMemoryTier(pid_t, SecurityLevel secLevel) {
+// Start (or stop) counting a process's usage in the totals and the starved
+// count. Caller holds the process's stripe.
+void AdaptiveMemoryManager::trackUsage(ProcessMemoryState& state, uint32_t slot) {
+    size_t usage = std::exchange(state.usage, 0);
+    state.slot = slot;
+    starvedCount.fetch_add(1, std::memory_order_relaxed);
+    setUsage(state, usage);
+}
+
+void AdaptiveMemoryManager::untrackUsage(ProcessMemoryState& state) {
+    if (state.slot == NO_SLOT) return;
+    setUsage(state, 0);
+    starvedCount.fetch_sub(1, std::memory_order_relaxed);
+    state.slot = NO_SLOT;
+}
+
+int AdaptiveMemoryManager::selectAppropriateMemoryTier(const ProcessMemoryState& state, SecurityLevel secLevel) {
+    // HIGH security memory always goes to the fast tier; otherwise follow the
+    // rebalancer once it has placed the process
+    if (secLevel != SecurityLevel::HIGH && state.placement >= 0) return state.placement;
     // Demo: map security level to tier
     switch (secLevel) {
         case SecurityLevel::HIGH: return 0;
@@ -111,6 +1069,3 @@ int AdaptiveMemoryManager::selectAppropriateMemoryTier(pid_t, SecurityLevel secL
         case SecurityLevel::LOW: default: return 2;
     }
 }
-
-std::time_t AdaptiveMemoryManager::getCurrentTime() { return std::time(nullptr); }
-void AdaptiveMemoryManager::preAllocateMemory(pid_t, size_t) {/* Stub */}
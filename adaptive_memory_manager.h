@@ -2,72 +2,398 @@
 #define ADAPTIVE_MEMORY_MANAGER_H
 
 #include <vector>
-#include <unordered_map>
-#include <ctime>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include "cache_line.h"
+#include "latency_histogram.h"
+#include "memory_region.h"
+#include "process_table.h"
+#include "slot_store.h"
+#include "buddy_arena.h"
+#include "compressed_pages.h"
+#include "swap_file.h"
+#include "trace_log.h"
+#include "snapshot_format.h"
+#include "manager_stats.h"
 
-using pid_t = int;
+// Where the slow tier keeps blocks of whole pages
+enum class SlowTierMode {
+    MEMORY,     // Anonymous memory, like the other tiers
+    SWAP_FILE,  // On a swap file: written back on demotion, remapped on promotion
+    COMPRESSED  // Compressed in memory by demotion, restored on promotion or first access
+};
+const char* slowTierModeName(SlowTierMode mode);
+// "memory", "file" or "compressed"; false for anything else
+bool parseSlowTierMode(const std::string& name, SlowTierMode& mode);
 
-enum class SecurityLevel { LOW, MEDIUM, HIGH };
+// Online forecast of one process's memory usage: Holt's linear trend (a
+// smoothed level plus a smoothed per-sample trend) and the mean absolute
+// one-step forecast error. Constant size; update() is O(1).
+struct MemoryPrediction {
+    float level = 0;
+    float trend = 0;
+    float deviation = 0;
+    uint32_t samples = 0;
 
-struct MemoryRegion {
-    pid_t pid;
-    size_t size;
-    std::time_t allocTime;
-    SecurityLevel secLevel;
-    void* address;
+    void update(size_t currentUsage);
+    // Usage expected `steps` samples ahead
+    size_t forecast(int steps = 1) const;
+    // Next sample plus a margin of `deviations` mean errors
+    size_t upperBound(float deviations) const;
 };
 
-struct MemoryPrediction {
-    size_t expectedGrowth;
-    void update(size_t currentUsage) {
-        expectedGrowth = currentUsage / 10 + 1024; // Stub
-    }
-    MemoryPrediction project(int seconds) const {
-        MemoryPrediction p = *this;
-        p.expectedGrowth += seconds / 60 * 256;
-        return p;
-    }
+// Counters for the forecast-driven reservations since construction
+struct ReservationStats {
+    uint64_t allocations = 0;   // Successful allocateMemoryByTier requests
+    uint64_t hits = 0;          // ... served from a reservation
+    uint64_t reserved = 0;      // Reservations made
+    uint64_t reservedBytes = 0;
+    uint64_t wastedBytes = 0;   // Unused reserved bytes: oversize on hits plus reclaimed blocks
+    uint64_t reclaimed = 0;     // Reservations returned unused
+    double hitRate() const { return allocations ? double(hits) / allocations : 0.0; }
+};
+
+// Budget of one tier: block bytes it may hand out and those handed out
+// (allocations and reservations)
+struct TierUsage {
+    size_t capacity = 0;
+    size_t used = 0;
+    float utilization() const { return capacity ? float(used) / float(capacity) : 0.0f; }
+};
+
+// Knobs of the background tier rebalancer. Thresholds are relative to the
+// mean process heat (smoothed accesses per pass), so they do not depend on
+// the pass interval or the access rate.
+struct RebalancerConfig {
+    std::chrono::milliseconds interval{10};
+    size_t budgetBytes = 4 * 1024 * 1024; // Bytes migrated per pass at most
+    float hotRatio = 1.25f;  // Promote to the fast tier at this multiple of the mean heat
+    float coldRatio = 0.6f;  // Demote to the slow tier at or below this multiple
+    uint32_t idlePasses = 100; // ... or after this many passes without an access
+};
+
+// Counters of the rebalancer and of recorded accesses since construction
+struct TieringStats {
+    uint64_t passes = 0;
+    uint64_t promotions = 0;     // Blocks moved to the fast tier
+    uint64_t demotions = 0;      // Blocks moved to the slow tier
+    uint64_t promotedBytes = 0;
+    uint64_t demotedBytes = 0;
+    uint64_t accesses = 0;       // Recorded by recordMemoryAccess
+    uint64_t fastAccesses = 0;   // ... to blocks in the fast tier
+    uint64_t longestLockNs = 0;  // Longest hold of the tier lock by a pass
+    uint64_t fileMaps = 0;       // Slow tier blocks put on the swap file when handed out
+    uint64_t writebacks = 0;     // Slow tier blocks written to the swap file or compressed
+    uint64_t remaps = 0;         // Promoted blocks remapped from the swap file or decompressed
+    uint64_t accessRestores = 0; // Compressed blocks decompressed by a recorded access
+    uint64_t restoreFailures = 0; // Blocks an access or promotion left sealed: a copy did not decompress
+    LatencyHistogram demoteNs;   // Per block written back or compressed
+    LatencyHistogram promoteNs;  // Per block remapped or decompressed
+    double fastTierHitRatio() const { return accesses ? double(fastAccesses) / accesses : 0.0; }
+};
+
+// Batch entry types. A TierRequest first frees `previous` (when non-null and
+// owned by pid) and then allocates, which is the per-tick reallocation pattern.
+struct MemoryUsageSample {
+    ProcessHandle process;
+    size_t currentUsage;
+};
+struct TierRequest {
+    ProcessHandle process;
+    size_t size;
+    SecurityLevel secLevel;
+    void* previous;
 };
 
 class AdaptiveMemoryManager {
 public:
+    // Directory of the slow tier's swap file; should be on local disk
+    static constexpr const char* DEFAULT_SWAP_DIRECTORY = "/var/tmp";
+    // Fast, normal and slow
+    static constexpr int TIER_COUNT = 3;
+    // Processes using less than this are memory starved
+    static constexpr size_t STARVED_BYTES = 2048;
+
     AdaptiveMemoryManager();
-    // Register a process for memory tracking
-    void registerProcess(pid_t pid);
-    // Remove a process
+    // Per-process state is keyed by slots of a table that may be shared. The
+    // swap file goes in swapDirectory; if it cannot be created there, the
+    // slow tier stays in anonymous memory.
+    explicit AdaptiveMemoryManager(std::shared_ptr<ProcessTable> table,
+                                   SlowTierMode slowTier = SlowTierMode::SWAP_FILE,
+                                   const std::string& swapDirectory = DEFAULT_SWAP_DIRECTORY);
+    ~AdaptiveMemoryManager();
+    // Register a process for memory tracking. The per-process calls below do
+    // nothing (or fail) for processes that are not registered.
+    ProcessHandle registerProcess(pid_t pid);
+    // Remove a process and release everything it still holds
     void unregisterProcess(pid_t pid);
-    // Analyze system-wide memory usage and rebalance
+    // Reclaim reservations left unused for RESERVATION_TTL passes. Memory is
+    // moved by the rebalancer alone: when utilization is below 70% and some
+    // processes are starved, the background one is woken early, at most once
+    // per interval. Costs O(expiring reservations), not O(processes).
     void analyzeMemoryUsage();
-    // Predict memory needs for a process
+    // Feed a usage sample to the process's forecaster and reserve a block
+    // for its next allocation in the tier it last allocated from
     void predictMemoryNeeds(pid_t pid, size_t currentUsage = 0);
-    // Allocate memory by tier and security level
-    void allocateMemoryByTier(pid_t pid, size_t size, SecurityLevel secLevel);
-    // Get total memory usage
+    void predictMemoryNeeds(ProcessHandle process, size_t currentUsage = 0);
+    // Allocate memory by tier and security level. Takes the process's
+    // reservation when it is in the right tier and large enough; otherwise
+    // falls back to the next (slower) tier when the preferred one is
+    // exhausted; nullptr if all are.
+    void* allocateMemoryByTier(pid_t pid, size_t size, SecurityLevel secLevel);
+    void* allocateMemoryByTier(ProcessHandle process, size_t size, SecurityLevel secLevel);
+    // Batched predictMemoryNeeds: each process-state stripe and the tier lock
+    // are taken at most twice
+    void predictMemoryNeedsBatch(const MemoryUsageSample* samples, size_t count);
+    // Batched free-then-allocateMemoryByTier under a single tier lock.
+    // results[i] receives the new address, or nullptr if every tier is exhausted.
+    void allocateMemoryByTierBatch(const TierRequest* requests, size_t count, void** results);
+    // Return one allocation to its tier; false if addr is not owned by pid
+    bool freeMemory(pid_t pid, void* addr);
+    // Free every allocation held by pid, and its reservation; returns the
+    // number of (requested) bytes released
+    size_t releaseProcess(pid_t pid);
+    ReservationStats getReservationStats() const;
+    // Count accesses to the block containing addr; false if pid owns none.
+    // Feeds the rebalancer and the fast-tier hit ratio. A compressed block is
+    // decompressed first, so callers report an access before making it; if it
+    // does not decompress, it stays sealed, nothing is counted and the result
+    // is false. If
+    // the rebalancer is moving the block, its demotion is cancelled or its
+    // promotion waited for: the caller never gets sealed pages.
+    bool recordMemoryAccess(pid_t pid, void* addr, uint32_t count = 1);
+    bool recordMemoryAccess(ProcessHandle process, void* addr, uint32_t count = 1);
+    // Run rebalance passes every config.interval on a background thread until
+    // stopRebalancer() or destruction
+    void startRebalancer(const RebalancerConfig& config = RebalancerConfig());
+    void stopRebalancer();
+    // One pass on the calling thread: promote the blocks of hot processes to
+    // the fast tier and demote those of cold ones to the slow tier, within
+    // the byte budget. HIGH security blocks stay where they are. Blocks of
+    // whole pages are written back to the swap file on demotion and remapped
+    // from it on promotion, or compressed and decompressed, along with the
+    // cold process's other slow tier blocks. Only processes with no access
+    // reported since the previous pass began are written back or compressed,
+    // and the copies replace the pages, under the owner's stripe, only if no
+    // access was reported while they were made: an access has a rebalancer
+    // interval to finish.
+    void rebalanceOnce();
+    TieringStats getTieringStats();
+    // Sum of the processes' usage, kept as running totals by every call that
+    // changes it; O(1) and takes no lock
     size_t getTotalMemoryUsage();
+    // A tier's budget in use, and all tiers' together; O(1) and take no lock
+    TierUsage getTierUsage(int tier) const;
+    float getMemoryUtilization() const;
+    // Registered processes below STARVED_BYTES; O(1) and takes no lock
+    size_t getStarvedProcessCount() const;
+    // Slow tier compression: ratio, CPU cost per GB and resident bytes saved.
+    // All zero unless the slow tier is COMPRESSED.
+    CompressionStats getCompressionStats() const;
     // For simulation: get all known PIDs
     std::vector<pid_t> getAllPIDs();
+    // Record every call above that changes state (nullptr stops); passes of
+    // the background rebalancer are not recorded. The recorder must outlive
+    // its attachment.
+    void setTraceRecorder(TraceRecorder* recorder) { trace.store(recorder, std::memory_order_release); }
+    // Snapshot support (state_snapshot.h): the forecast, heat and tier choices
+    // of the given processes, setting IN_MEMORY for those registered here.
+    // Restored processes hold no blocks.
+    void saveState(const ProcessHandle* handles, size_t count, Snapshot::ProcessRecord* processes,
+                   Snapshot::MemoryRecord* records);
+    void restoreState(const ProcessHandle* handles, size_t count, const Snapshot::ProcessRecord* processes,
+                      const Snapshot::MemoryRecord* records);
+    // Latency of each call above (pid overloads are timed through the handle
+    // overload they call; "rebalancePass" includes background passes) and
+    // contention on mtx; see manager_stats.h
+    std::string statsSnapshot(StatsFormat format = StatsFormat::JSON) { return callStats.snapshot(format); }
+    void setStatsEnabled(bool on) { callStats.setEnabled(on); }
 
 private:
+    // Tiers share one arena; a tier's size is a budget of block bytes, so a
+    // block can change tier without changing address. Slow tier blocks of
+    // whole pages live on the swap file; free blocks are always anonymous
+    // memory. Smaller blocks share pages and move by accounting only.
+    // In COMPRESSED mode a slow tier block's pages are compressed instead,
+    // and made inaccessible until restored.
+    // Freed slow tier blocks are kept on the file (up to SWAP_CACHE_BYTES)
+    // for the next slow tier reservation, so steady reallocation does not
+    // remap; the budgets count them as free.
     struct MemoryTier {
-        size_t totalSize;
-        size_t availableSize;
-        float accessSpeed;
-        std::vector<MemoryRegion> allocations;
+        size_t totalSize = 0;
+        std::atomic<size_t> availableSize{0}; // Written under mtx; read without it
+        float accessSpeed = 0;
+    };
+    struct OwnedBlock {
+        void* addr;
+        size_t size; // As requested
+        int tier;
+        bool pinned; // HIGH security; never migrated
+        bool compressed = false; // Compressed (or found incompressible) since it entered the slow tier
+        // Backing being changed by the rebalancer outside the stripe: not
+        // moved again, and if its owner lets go meanwhile the rebalancer frees it
+        bool moving = false;
+        bool touched = false; // Access reported while moving: a demotion is cancelled
+    };
+    // A block the rebalancer changes the backing of with no lock held
+    struct MovingBlock {
+        void* addr;
+        size_t bytes;
+        bool compressed;
+        // Copy made (compressed, or written to the swap file) to seal or map
+        // under the owner's stripe, or to drop
+        bool staged = false;
+        bool held = false;   // ... holding some page
+        bool orphan = true;  // Let go of by its owner meanwhile; freed by the rebalancer
+        uint64_t ns = 0;     // Time the copy took
+    };
+    // Block taken from a tier ahead of the allocation it is meant for
+    struct Reservation {
+        void* addr = nullptr;
+        size_t capacity = 0; // Block size
+        int tier = -1;
+        uint64_t epoch = 0;  // Analysis pass it was made in
+    };
+    static constexpr uint32_t NO_SLOT = UINT32_MAX;
+    struct ProcessMemoryState {
+        uint32_t slot = NO_SLOT; // Set while registered; picks the usage shard
+        MemoryPrediction prediction;
+        size_t usage = 0;       // Changed through setUsage() only
+        int preferredTier = -1; // Tier the latest allocation asked for; reservations go there
+        int placement = -1;     // Tier chosen by the rebalancer; -1 follows the security level
+        Reservation reservation;
+        uint64_t queuedEpoch = 0; // Epoch + 1 of the last expiry queue entry
+        std::vector<OwnedBlock> blocks;
+        // Access statistics. Kept per process rather than per block: workloads
+        // replace their blocks far more often than a pass runs.
+        float heat = 0;              // Smoothed accesses per pass
+        uint64_t lastAccessPass = 0;
+        uint32_t passAccesses = 0;   // Since the last pass
+        uint64_t unreported = 0;     // Since the last stats fold
+        uint64_t unreportedFast = 0;
+    };
+    // One process picked by a pass
+    struct Migration {
+        pid_t pid;
+        float heat;
+        int to;
+    };
+    struct alignas(CACHE_LINE_SIZE) Counters {
+        std::atomic<uint64_t> allocations{0}, hits{0}, reserved{0}, reservedBytes{0}, wastedBytes{0}, reclaimed{0};
+    };
+    struct alignas(CACHE_LINE_SIZE) TieringCounters {
+        std::atomic<uint64_t> passes{0}, promotions{0}, demotions{0}, promotedBytes{0}, demotedBytes{0};
+        std::atomic<uint64_t> accesses{0}, fastAccesses{0}, longestLockNs{0};
+        std::atomic<uint64_t> fileMaps{0}, writebacks{0}, remaps{0}, accessRestores{0}, restoreFailures{0};
+    };
+    // Guards the tiers. Allocation ownership and reservations live with the
+    // per-process state, so a reservation hit takes no tier lock. Lock order:
+    // a process-state stripe may be held while taking mtx, never the reverse.
+    MemoryTier memoryTiers[TIER_COUNT];
+    BuddyArena arena;
+    SwapFile swapFile;
+    CompressedPages compressedPages;
+    std::shared_ptr<ProcessTable> table;
+    SlotStore<ProcessMemoryState> processMemory;
+    // Usage totals, one per processMemory stripe and written under its lock,
+    // so updates need no read-modify-write; summed on read
+    struct alignas(CACHE_LINE_SIZE) UsageShard {
+        std::atomic<size_t> bytes{0};
+    };
+    UsageShard usageShards[decltype(processMemory)::STRIPES];
+    // Changed only when a process's usage crosses STARVED_BYTES
+    std::atomic<size_t> starvedCount{0};
+    enum Timed : size_t {
+        TIME_REGISTER, TIME_UNREGISTER, TIME_ANALYZE, TIME_PREDICT, TIME_PREDICT_BATCH, TIME_ALLOCATE,
+        TIME_ALLOCATE_BATCH, TIME_FREE, TIME_RELEASE, TIME_ACCESS, TIME_REBALANCE, TIME_TOTAL_USAGE, TIME_ALL_PIDS,
+        TIMED_COUNT
+    };
+    static constexpr const char* TIMED_NAMES[TIMED_COUNT] = {
+        "registerProcess", "unregisterProcess", "analyzeMemoryUsage", "predictMemoryNeeds", "predictMemoryNeedsBatch",
+        "allocateMemoryByTier", "allocateMemoryByTierBatch", "freeMemory", "releaseProcess", "recordMemoryAccess",
+        "rebalancePass", "getTotalMemoryUsage", "getAllPIDs"
     };
-    std::vector<MemoryTier> memoryTiers;
-    std::unordered_map<pid_t, MemoryPrediction> processMemoryNeeds;
-    std::unordered_map<pid_t, size_t> processMemoryUsage;
-    std::mutex mtx;
-    const size_t MEMORY_GROWTH_THRESHOLD = 4096;
+    ManagerStats callStats{"memory", TIMED_NAMES, TIMED_COUNT};
+    StatsMutex mtx{callStats};
+    std::atomic<uint64_t> analysisEpoch{0};
+    std::vector<std::vector<void*>> swapCache; // By block order; guarded by mtx
+    size_t swapCacheBytes = 0;
+    Counters counters;
+    TieringCounters tiering;
+    // Rebalancer: passMtx serialises passes and guards their scratch;
+    // rebalancerMtx guards the config and the thread's lifetime
+    std::mutex passMtx;
+    std::vector<Migration> migrations;
+    std::vector<size_t> movedBlocks; // Indices into one process's blocks
+    std::vector<MovingBlock> movingBlocks; // One process's blocks marked moving
+    // An access to a moving block sets moveCancelled (under the owner's
+    // stripe) and waits on moveCv until finishMoving bumps movesFinished;
+    // moveMtx is a leaf lock
+    std::atomic<bool> moveCancelled{false};
+    std::mutex moveMtx;
+    std::condition_variable moveCv;
+    uint64_t movesFinished = 0;
+    LatencyHistogram demoteNs, promoteNs;
+    float meanHeat = 0;
+    std::atomic<uint64_t> rebalancePass{0};
+    std::mutex rebalancerMtx;
+    std::condition_variable rebalancerCv;
+    RebalancerConfig rebalancerConfig;
+    bool rebalancerStopping = false;
+    // Set by analyzeMemoryUsage to run the next pass without waiting out the
+    // interval; earlyPass allows one such pass per interval
+    bool rebalanceRequested = false;
+    bool earlyPass = false;
+    std::thread rebalancer;
+    std::atomic<TraceRecorder*> trace{nullptr};
+    // Samples seen before the forecast is trusted with a reservation
+    static constexpr uint32_t RESERVATION_WARMUP = 2;
+    // Analysis passes an unused reservation survives
+    static constexpr uint64_t RESERVATION_TTL = 2;
+    // Margin of the reservation over the forecast, in mean forecast errors
+    static constexpr float RESERVATION_MARGIN = 1.5f;
+    static constexpr size_t SWAP_CACHE_BYTES = 32 * 1024 * 1024;
+    // Processes that made a reservation, by analysis epoch modulo TTL + 1, at
+    // most once per epoch; guarded by mtx. Entries of reservations taken or
+    // replaced since are skipped on expiry.
+    std::vector<ProcessHandle> reservationQueue[RESERVATION_TTL + 1];
 
-    float calculateSystemMemoryUtilization();
-    std::vector<MemoryRegion> findUnderutilizedMemoryRegions();
-    std::vector<pid_t> identifyMemoryStarvedProcesses();
-    void redistributeMemory(const std::vector<MemoryRegion>&, const std::vector<pid_t>&);
-    size_t getCurrentMemoryUsage(pid_t);
-    int selectAppropriateMemoryTier(pid_t, SecurityLevel);
-    std::time_t getCurrentTime();
-    void preAllocateMemory(pid_t, size_t);
+    void setUsage(ProcessMemoryState& state, size_t usage);
+    void trackUsage(ProcessMemoryState& state, uint32_t slot);
+    void untrackUsage(ProcessMemoryState& state);
+    void expireReservations(uint64_t epoch);
+    bool queueReservation(ProcessMemoryState& state);
+    int selectAppropriateMemoryTier(const ProcessMemoryState& state, SecurityLevel secLevel);
+    int allocateLocked(int tierIndex, size_t size, void*& addr);
+    void* reserveLocked(int tierIndex, size_t size);
+    void releaseLocked(int tierIndex, void* addr);
+    bool cacheSwapBlockLocked(void* addr, size_t block);
+    void* takeSwapBlockLocked(size_t block);
+    void flushSwapCacheLocked();
+    void prepareBacking(void* addr, size_t blockSize, int tierIndex);
+    size_t takeReservation(ProcessMemoryState& state, int tierIndex, size_t size, SecurityLevel secLevel, void*& addr);
+    bool takeOwned(ProcessMemoryState& state, void* addr, OwnedBlock& block);
+    void recordAllocation(ProcessMemoryState& state, void* addr, size_t size, int tierIndex, SecurityLevel secLevel);
+    size_t migrateLocked(ProcessMemoryState& state, int to, size_t budget);
+    size_t markMoving(ProcessMemoryState& state, int to, size_t budget, bool quiet);
+    void moveBacking(int to);
+    void finishMoving(pid_t pid, int to);
+    void changeBacking(MovingBlock& block, int to);
+    // A slow tier block of whole pages not on the swap file (or, in
+    // COMPRESSED mode, not compressed) yet
+    bool needsBacking(const OwnedBlock& block) const;
+    void rebalancerLoop();
+    void runRebalancePass();
+    size_t releaseHeld(pid_t pid);
+    size_t reservationTarget(const ProcessMemoryState& state);
+    void predictBatch(const MemoryUsageSample* samples, size_t count);
+    void allocateBatch(const TierRequest* requests, size_t count, void** results);
 };
 
 #endif // ADAPTIVE_MEMORY_MANAGER_H
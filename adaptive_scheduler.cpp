@@ -1,53 +1,120 @@
 #include "adaptive_scheduler.h"
+#include "event_log.h"
 #include <algorithm>
 
-AdaptiveScheduler::AdaptiveScheduler() {}
+namespace {
+    constexpr long SECONDS_PER_DAY = 24 * 3600;
+    constexpr int HOURS = 24;
+}
+
+AdaptiveScheduler::AdaptiveScheduler() : AdaptiveScheduler(std::make_shared<ProcessTable>()) {}
 
-void AdaptiveScheduler::registerProcess(pid_t pid, const std::string& name) {
-    std::lock_guard<std::mutex> lock(mtx);
-    userProfiles[pid] = ApplicationProfile{pid, name};
-    processMetrics[pid] = UsageMetrics();
+AdaptiveScheduler::AdaptiveScheduler(std::shared_ptr<ProcessTable> table)
+    : table(std::move(table)), processMetrics(*this->table, true), userProfiles(*this->table) {
+    // Taken once: std::localtime is neither cheap nor thread-safe
+    std::time_t now = std::time(nullptr);
+    const std::tm* local = std::localtime(&now);
+    long localSeconds = local ? local->tm_hour * 3600L + local->tm_min * 60L + local->tm_sec : 0;
+    utcOffset = ((localSeconds - static_cast<long>(now % SECONDS_PER_DAY)) % SECONDS_PER_DAY + SECONDS_PER_DAY) %
+                SECONDS_PER_DAY;
+}
+
+ProcessHandle AdaptiveScheduler::registerProcess(pid_t pid, const std::string& name) {
+    ScopedTimer timer(callStats, TIME_REGISTER);
+    // Registering again refreshes the profile and gives back the extra table
+    // reference, so concurrent registrations of one PID hold one between them
+    ProcessHandle h = table->acquire(pid);
+    ApplicationProfile profile{pid, name};
+    if (!userProfiles.insertIfAbsent(h, profile)) {
+        table->release(pid);
+        userProfiles.find(h, [&](ApplicationProfile& existing) { existing = profile; });
+    }
+    processMetrics.insert(h, UsageMetrics());
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->recordRegister(pid, name);
+    return h;
 }
 
 void AdaptiveScheduler::unregisterProcess(pid_t pid) {
-    std::lock_guard<std::mutex> lock(mtx);
-    userProfiles.erase(pid);
-    processMetrics.erase(pid);
-    dependencies.erase(pid);
+    ScopedTimer timer(callStats, TIME_UNREGISTER);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::SCHED_UNREGISTER, pid);
+    ProcessHandle h = table->lookup(pid);
+    bool registered = userProfiles.erase(h);
+    processMetrics.erase(h);
+    {
+        std::lock_guard<StatsMutex> lock(mtx);
+        dependencies.erase(pid);
+        preBoosts.erase(pid);
+        if (h.valid()) removeFeatureRow(h.slot);
+        priorityIndex.erase(pid);
+    }
+    if (registered) table->release(pid);
 }
 
 void AdaptiveScheduler::updateUsageMetrics(pid_t pid, ApplicationEvent event, int cpuUsage, int ioUsage) {
-    std::lock_guard<std::mutex> lock(mtx);
-    auto& metrics = processMetrics[pid];
-    metrics.lastInteractionTime = std::time(nullptr);
-    metrics.interactionCount++;
-    metrics.cpuUsage = cpuUsage;
-    metrics.ioUsage = ioUsage;
-    if (event.type == ApplicationEvent::FOCUS_CHANGE) {
-        recordApplicationDependency(event.previous_pid, pid);
+    updateUsageMetrics(table->lookup(pid), event, cpuUsage, ioUsage);
+}
+
+void AdaptiveScheduler::updateUsageMetrics(ProcessHandle process, ApplicationEvent event, int cpuUsage, int ioUsage) {
+    ScopedTimer timer(callStats, TIME_UPDATE_USAGE);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire); t && table->isLive(process)) {
+        t->record(TraceOp::USAGE_UPDATE, table->pidOf(process.slot), nullptr, event.type, event.previous_pid,
+                  cpuUsage, ioUsage);
+    }
+    // Only the process's stripe is locked; the change mark feeds the next priority pass
+    std::time_t now = std::time(nullptr);
+    int hour = hourOfDay(now);
+    bool live = processMetrics.update(process, [&](UsageMetrics& metrics) {
+        metrics.lastInteractionTime = now;
+        metrics.interactionCount++;
+        recordActivity(metrics, hour);
+        metrics.cpuUsage = cpuUsage;
+        metrics.ioUsage = ioUsage;
+    });
+    if (live && event.type == ApplicationEvent::FOCUS_CHANGE) {
+        std::lock_guard<StatsMutex> lock(mtx);
+        recordApplicationDependency(event.previous_pid, table->pidOf(process.slot));
+    }
+}
+
+void AdaptiveScheduler::updateUsageMetricsBatch(const UsageUpdate* updates, size_t count) {
+    ScopedTimer timer(callStats, TIME_UPDATE_USAGE_BATCH);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) {
+        for (size_t i = 0; i < count; ++i) {
+            const UsageUpdate& u = updates[i];
+            if (!table->isLive(u.process)) continue;
+            t->record(TraceOp::USAGE_UPDATE, table->pidOf(u.process.slot), nullptr, u.event.type,
+                      u.event.previous_pid, u.cpuUsage, u.ioUsage);
+        }
+    }
+    std::time_t now = std::time(nullptr);
+    int hour = hourOfDay(now);
+    bool focusChanged = false;
+    processMetrics.updateBatch(count, [&](size_t i) { return updates[i].process; }, [&](size_t i, UsageMetrics& metrics) {
+        metrics.lastInteractionTime = now;
+        metrics.interactionCount++;
+        recordActivity(metrics, hour);
+        metrics.cpuUsage = updates[i].cpuUsage;
+        metrics.ioUsage = updates[i].ioUsage;
+        focusChanged |= updates[i].event.type == ApplicationEvent::FOCUS_CHANGE;
+    });
+    if (!focusChanged) return;
+    // Focus changes are replayed in submission order
+    std::lock_guard<StatsMutex> lock(mtx);
+    for (size_t i = 0; i < count; ++i) {
+        if (updates[i].event.type == ApplicationEvent::FOCUS_CHANGE && table->isLive(updates[i].process)) {
+            recordApplicationDependency(updates[i].event.previous_pid, table->pidOf(updates[i].process.slot));
+        }
     }
 }
 
 std::vector<AdaptiveScheduler::SchedulingDecision> AdaptiveScheduler::calculateProcessPriorities() {
-    std::lock_guard<std::mutex> lock(mtx);
+    ScopedTimer timer(callStats, TIME_PRIORITIES);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::CALCULATE_PRIORITIES, 0);
+    std::lock_guard<StatsMutex> lock(mtx);
+    refreshPriorityIndex();
     std::vector<SchedulingDecision> decisions;
-    for (const auto& [pid, metrics] : processMetrics) {
-        float importance = priorityModel.predict({
-            static_cast<float>(metrics.interactionCount),
-            timeSinceLastInteraction(metrics),
-            getDependencyScore(pid),
-            getTimeOfDayRelevance(pid),
-            static_cast<float>(metrics.cpuUsage),
-            static_cast<float>(metrics.ioUsage)
-        });
-        float performanceFactor = getSystemPerformanceFactor(pid);
-        decisions.push_back({
-            pid,
-            calculateBasePriority(importance),
-            importance * performanceFactor,
-            calculateTimeSlice(importance, performanceFactor)
-        });
-    }
+    decisions.reserve(priorityIndex.size());
+    priorityIndex.forEach([&](const SchedulingDecision& d) { decisions.push_back(d); });
     // Sort by importance descending for simulation
     std::sort(decisions.begin(), decisions.end(), [](const SchedulingDecision& a, const SchedulingDecision& b) {
         return a.importance_factor > b.importance_factor;
@@ -55,9 +122,180 @@ std::vector<AdaptiveScheduler::SchedulingDecision> AdaptiveScheduler::calculateP
     return decisions;
 }
 
+std::vector<AdaptiveScheduler::SchedulingDecision> AdaptiveScheduler::topK(size_t n) {
+    ScopedTimer timer(callStats, TIME_TOP_K);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) {
+        t->record(TraceOp::TOP_K, 0, nullptr, static_cast<int64_t>(n));
+    }
+    std::lock_guard<StatsMutex> lock(mtx);
+    refreshPriorityIndex();
+    return priorityIndex.topK(n);
+}
+
+bool AdaptiveScheduler::next(SchedulingDecision& out) {
+    ScopedTimer timer(callStats, TIME_NEXT);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::NEXT_DECISION, 0);
+    std::lock_guard<StatsMutex> lock(mtx);
+    refreshPriorityIndex();
+    if (!priorityIndex.cursorActive()) priorityIndex.reset();
+    return priorityIndex.next(out);
+}
+
+void AdaptiveScheduler::reportOutcome(ProcessHandle process, float waitMs, float runMs) {
+    SchedulingOutcome outcome{process, waitMs, runMs};
+    reportOutcomes(&outcome, 1);
+}
+
+void AdaptiveScheduler::reportOutcomes(const SchedulingOutcome* outcomes, size_t count) {
+    ScopedTimer timer(callStats, TIME_REPORT_OUTCOMES);
+    std::vector<ML::TrainingSample> samples;
+    samples.reserve(count);
+    {
+        std::lock_guard<StatsMutex> lock(mtx);
+        for (size_t i = 0; i < count; ++i) {
+            const SchedulingOutcome& o = outcomes[i];
+            if (!table->isLive(o.process) || o.process.slot >= featureRowOfSlot.size()) continue;
+            uint32_t row = featureRowOfSlot[o.process.slot];
+            if (row == NO_ROW || features.pids[row] != table->pidOf(o.process.slot)) continue;
+            ML::TrainingSample s;
+            for (int f = 0; f < ML::NUM_FEATURES; ++f) s.features[f] = features.columns[f][row];
+            s.waitMs = o.waitMs;
+            s.runMs = o.runMs;
+            samples.push_back(s);
+        }
+    }
+    trainer.submit(samples.data(), samples.size());
+}
+
+// Rescore only the PIDs touched since the last pass, plus those whose
+// time-dependent features are due for a refresh: O(changed * log n).
+// Changed rows are written into the feature columns first; when a large share
+// of processes changed, the whole matrix is scored in one vectorized batch.
+// A newly published model, or a new local hour for TIME_OF_DAY, recomputes
+// and rescores every row.
+void AdaptiveScheduler::refreshPriorityIndex() {
+    ML::ModelPublisher::Reader model = models.read();
+    std::time_t now = std::time(nullptr);
+    int hour = hourOfDay(now);
+    if (model->version != scoredVersion || hour != scoredHour) {
+        scoredVersion = model->version;
+        scoredHour = hour;
+        for (pid_t pid : features.pids) processMetrics.touch(pid);
+    }
+    touchStaleRows(now);
+    changedRows.clear();
+    changedMetrics.clear();
+    processMetrics.drainChanged([&](pid_t pid, ProcessHandle h, const UsageMetrics& metrics) {
+        size_t row = featureRowFor(pid, h.slot);
+        // Every update counts an interaction; rows touched for a refresh only
+        // keep their counters
+        changedMetrics.push_back(!priorityIndex.contains(pid) ||
+                                 features.at(ML::INTERACTION_COUNT, row) != static_cast<float>(metrics.interactionCount) ||
+                                 features.at(ML::CPU_USAGE, row) != static_cast<float>(metrics.cpuUsage) ||
+                                 features.at(ML::IO_USAGE, row) != static_cast<float>(metrics.ioUsage));
+        features.at(ML::INTERACTION_COUNT, row) = static_cast<float>(metrics.interactionCount);
+        features.at(ML::RECENCY, row) = timeSinceLastInteraction(metrics);
+        features.at(ML::DEPENDENCY, row) = getDependencyScore(pid);
+        features.at(ML::TIME_OF_DAY, row) = getTimeOfDayRelevance(metrics, hour);
+        features.at(ML::CPU_USAGE, row) = static_cast<float>(metrics.cpuUsage);
+        features.at(ML::IO_USAGE, row) = static_cast<float>(metrics.ioUsage);
+        changedRows.push_back(row);
+        scheduleRefresh(h, metrics, now);
+    });
+    if (changedRows.empty()) return;
+    bool batch = changedRows.size() * BATCH_SCORING_FRACTION >= features.rows();
+    if (batch) {
+        batchScores.resize(features.rows());
+        model->model.predictBatch(features, batchScores.data());
+    }
+    for (size_t k = 0; k < changedRows.size(); ++k) {
+        size_t row = changedRows[k];
+        pid_t pid = features.pids[row];
+        float importance = batch ? batchScores[row] : model->model.predictRow(features, row);
+        auto boost = preBoosts.find(pid);
+        if (boost != preBoosts.end()) importance += boost->second;
+        SchedulingDecision d = makeDecision(pid, importance, model->performanceFactor);
+        // Refreshed scores reorder the processes next() has yet to hand out
+        // without restarting it
+        if (changedMetrics[k]) priorityIndex.upsert(pid, d.importance_factor, d);
+        else priorityIndex.reorder(pid, d.importance_factor, d);
+    }
+}
+
+// Mark changed the rows whose refresh fell due since the last pass
+void AdaptiveScheduler::touchStaleRows(std::time_t now) {
+    std::time_t from = now - wheelTime > static_cast<std::time_t>(REFRESH_WHEEL) ? now - REFRESH_WHEEL + 1
+                                                                                  : wheelTime + 1;
+    for (std::time_t t = from; t <= now; ++t) {
+        std::vector<RefreshEntry>& bucket = refreshWheel[t % REFRESH_WHEEL];
+        size_t kept = 0;
+        for (const RefreshEntry& e : bucket) {
+            if (e.due > now) bucket[kept++] = e;
+            else if (refreshDueOfSlot[e.process.slot] == e.due) processMetrics.touch(e.process);
+        }
+        bucket.resize(kept);
+    }
+    wheelTime = std::max(wheelTime, now);
+}
+
+void AdaptiveScheduler::scheduleRefresh(ProcessHandle process, const UsageMetrics& metrics, std::time_t now) {
+    std::time_t idle = std::max<std::time_t>(0, now - metrics.lastInteractionTime);
+    std::time_t due = now + std::clamp<std::time_t>(idle / 4, 1, REFRESH_MAX_SECONDS);
+    if (process.slot >= refreshDueOfSlot.size()) refreshDueOfSlot.resize(table->slotCount(), 0);
+    refreshDueOfSlot[process.slot] = due;
+    refreshWheel[due % REFRESH_WHEEL].push_back({process, due});
+}
+
+size_t AdaptiveScheduler::featureRowFor(pid_t pid, uint32_t slot) {
+    if (slot >= featureRowOfSlot.size()) featureRowOfSlot.resize(table->slotCount(), NO_ROW);
+    uint32_t& row = featureRowOfSlot[slot];
+    if (row == NO_ROW) {
+        row = static_cast<uint32_t>(features.addRow(pid));
+        slotOfFeatureRow.push_back(slot);
+    } else if (features.pids[row] != pid) {
+        // Slot recycled without the scheduler seeing its previous owner leave
+        priorityIndex.erase(features.pids[row]);
+        features.pids[row] = pid;
+    }
+    return row;
+}
+
+void AdaptiveScheduler::removeFeatureRow(uint32_t slot) {
+    if (slot >= featureRowOfSlot.size() || featureRowOfSlot[slot] == NO_ROW) return;
+    size_t row = featureRowOfSlot[slot];
+    featureRowOfSlot[slot] = NO_ROW;
+    // Mirror the matrix's swap-remove
+    features.removeRow(row);
+    slotOfFeatureRow[row] = slotOfFeatureRow.back();
+    slotOfFeatureRow.pop_back();
+    if (row < slotOfFeatureRow.size()) featureRowOfSlot[slotOfFeatureRow[row]] = static_cast<uint32_t>(row);
+}
+
+AdaptiveScheduler::SchedulingDecision AdaptiveScheduler::makeDecision(pid_t pid, float importance,
+                                                                      float performanceFactor) {
+    return {
+        pid,
+        calculateBasePriority(importance),
+        importance * performanceFactor,
+        calculateTimeSlice(importance, performanceFactor)
+    };
+}
+
 void AdaptiveScheduler::recordApplicationDependency(pid_t prev, pid_t curr) {
-    dependencies[curr].push_back(prev);
-    std::cout << "Dependency: " << prev << " -> " << curr << std::endl;
+    double now = static_cast<double>(std::time(nullptr));
+    dependencies.recordTransition(prev, curr, now);
+    updatePreBoosts(curr, now);
+    EventLog::instance().log(LogLevel::INFO, LogEvent::DEPENDENCY, curr, prev);
+}
+
+void AdaptiveScheduler::updatePreBoosts(pid_t focused, double now) {
+    // Previously boosted processes fall back to their plain score
+    for (const auto& [pid, _] : preBoosts) processMetrics.touch(pid);
+    preBoosts.clear();
+    for (const auto& edge : dependencies.strongestPredecessors(focused, PRE_BOOST_COUNT, now)) {
+        preBoosts[edge.pid] = 0.1f * edge.weight;
+        processMetrics.touch(edge.pid);
+    }
 }
 
 float AdaptiveScheduler::timeSinceLastInteraction(const UsageMetrics& metrics) {
@@ -65,19 +303,28 @@ float AdaptiveScheduler::timeSinceLastInteraction(const UsageMetrics& metrics) {
 }
 
 float AdaptiveScheduler::getDependencyScore(pid_t pid) {
-    // Example: if many dependencies, increase importance
-    auto it = dependencies.find(pid);
-    return it != dependencies.end() ? 1.0f + 0.1f * it->second.size() : 1.0f;
+    // Frequently switched-to processes are more important; old switches fade out
+    return 1.0f + 0.1f * dependencies.incomingWeight(pid, static_cast<double>(std::time(nullptr)));
 }
 
-float AdaptiveScheduler::getTimeOfDayRelevance(pid_t pid) {
-    // Stub: could use actual time for real system
-    return 1.0f;
+int AdaptiveScheduler::hourOfDay(std::time_t now) const {
+    return static_cast<int>((now + utcOffset) % SECONDS_PER_DAY / 3600);
 }
 
-float AdaptiveScheduler::getSystemPerformanceFactor(pid_t pid) {
-    // Stub: could use system load, latency, etc.
-    return 1.0f;
+void AdaptiveScheduler::recordActivity(UsageMetrics& metrics, int hour) {
+    if (metrics.hourActivity[hour] == UINT8_MAX) {
+        // Halving keeps the proportions and lets old habits fade
+        for (uint8_t& count : metrics.hourActivity) count /= 2;
+    }
+    metrics.hourActivity[hour]++;
+}
+
+// Share of the process's activity that falls in the current hour, relative
+// to an even spread: 1 when unknown, 24 when it is only active now
+float AdaptiveScheduler::getTimeOfDayRelevance(const UsageMetrics& metrics, int hour) {
+    int total = 0;
+    for (uint8_t count : metrics.hourActivity) total += count;
+    return total ? static_cast<float>(HOURS * metrics.hourActivity[hour]) / total : 1.0f;
 }
 
 int AdaptiveScheduler::calculateBasePriority(float importance) {
@@ -88,9 +335,96 @@ TimeSlice AdaptiveScheduler::calculateTimeSlice(float importance, float perf) {
     return {static_cast<int>(100 * importance * perf)};
 }
 
+std::vector<DependencyGraph::Edge> AdaptiveScheduler::getStrongestPredecessors(pid_t pid, size_t k) {
+    ScopedTimer timer(callStats, TIME_PREDECESSORS);
+    std::lock_guard<StatsMutex> lock(mtx);
+    return dependencies.strongestPredecessors(pid, k, static_cast<double>(std::time(nullptr)));
+}
+
 std::vector<pid_t> AdaptiveScheduler::getAllPIDs() {
-    std::lock_guard<std::mutex> lock(mtx);
+    ScopedTimer timer(callStats, TIME_ALL_PIDS);
     std::vector<pid_t> pids;
-    for (const auto& [pid, _] : processMetrics) pids.push_back(pid);
+    processMetrics.forEach([&](pid_t pid, const UsageMetrics&) { pids.push_back(pid); });
     return pids;
 }
+
+void AdaptiveScheduler::saveState(const ProcessHandle* handles, size_t count, Snapshot::ProcessRecord* processes,
+                                  Snapshot::SchedulerRecord* records, std::string& names) {
+    auto handleOf = [&](size_t i) { return handles[i]; };
+    for (size_t i = 0; i < count; ++i) records[i] = Snapshot::SchedulerRecord{};
+    userProfiles.findBatch(count, handleOf, [&](size_t i, ApplicationProfile& profile) {
+        records[i].nameOffset = static_cast<uint32_t>(names.size());
+        records[i].nameLength = static_cast<uint32_t>(profile.name.size());
+        names += profile.name;
+        processes[i].managers |= Snapshot::IN_SCHEDULER;
+    });
+    processMetrics.findBatch(count, handleOf, [&](size_t i, UsageMetrics& m) {
+        Snapshot::SchedulerRecord& r = records[i];
+        r.lastInteractionTime = static_cast<int64_t>(m.lastInteractionTime);
+        r.interactionCount = m.interactionCount;
+        r.burstCount = m.burstCount;
+        r.cpuUsage = m.cpuUsage;
+        r.ioUsage = m.ioUsage;
+        std::copy(std::begin(m.hourActivity), std::end(m.hourActivity), r.hourActivity);
+    });
+}
+
+void AdaptiveScheduler::restoreState(const ProcessHandle* handles, size_t count,
+                                     const Snapshot::ProcessRecord* processes,
+                                     const Snapshot::SchedulerRecord* records, const char* names, size_t namesBytes) {
+    auto handleOf = [&](size_t i) {
+        return processes[i].managers & Snapshot::IN_SCHEDULER ? handles[i] : ProcessHandle();
+    };
+    userProfiles.updateBatch(count, handleOf, [&](size_t i, ApplicationProfile& profile) {
+        const Snapshot::SchedulerRecord& r = records[i];
+        profile.pid = processes[i].pid;
+        if (r.nameOffset <= namesBytes && r.nameLength <= namesBytes - r.nameOffset) {
+            profile.name.assign(names + r.nameOffset, r.nameLength);
+        }
+    });
+    // Restored metrics are marked changed, so the next pass scores them
+    processMetrics.updateBatch(count, handleOf, [&](size_t i, UsageMetrics& m) {
+        const Snapshot::SchedulerRecord& r = records[i];
+        m.lastInteractionTime = static_cast<std::time_t>(r.lastInteractionTime);
+        m.interactionCount = r.interactionCount;
+        m.burstCount = r.burstCount;
+        m.cpuUsage = r.cpuUsage;
+        m.ioUsage = r.ioUsage;
+        std::copy(std::begin(r.hourActivity), std::end(r.hourActivity), m.hourActivity);
+    });
+}
+
+static_assert(sizeof(UsageMetrics::hourActivity) == sizeof(Snapshot::SchedulerRecord::hourActivity),
+              "snapshot holds every hour");
+static_assert(DependencyGraph::MAX_FAN_OUT == Snapshot::DependencyRecord::MAX_EDGES, "snapshot holds every edge");
+
+void AdaptiveScheduler::saveDependencies(std::vector<Snapshot::DependencyRecord>& out) {
+    std::unique_lock<StatsMutex> lock(mtx);
+    size_t first = out.size();
+    out.reserve(first + dependencies.nodeCount());
+    dependencies.forEachNode([&](pid_t pid, const DependencyGraph::Edge* edges, uint32_t edgeCount, float total,
+                                 double stamp) {
+        Snapshot::DependencyRecord r{};
+        r.pid = pid;
+        r.edgeCount = std::min<uint32_t>(edgeCount, Snapshot::DependencyRecord::MAX_EDGES);
+        r.totalWeight = total;
+        r.stamp = stamp;
+        for (uint32_t e = 0; e < r.edgeCount; ++e) r.edges[e] = {edges[e].pid, edges[e].weight};
+        out.push_back(r);
+    });
+    lock.unlock();
+    // By pid, so the same graph always saves to the same bytes
+    std::sort(out.begin() + first, out.end(),
+              [](const Snapshot::DependencyRecord& a, const Snapshot::DependencyRecord& b) { return a.pid < b.pid; });
+}
+
+void AdaptiveScheduler::restoreDependencies(const Snapshot::DependencyRecord* records, size_t count) {
+    DependencyGraph::Edge edges[Snapshot::DependencyRecord::MAX_EDGES];
+    std::lock_guard<StatsMutex> lock(mtx);
+    for (size_t i = 0; i < count; ++i) {
+        const Snapshot::DependencyRecord& r = records[i];
+        size_t n = std::min<size_t>(r.edgeCount, Snapshot::DependencyRecord::MAX_EDGES);
+        for (size_t e = 0; e < n; ++e) edges[e] = {r.edges[e].pid, r.edges[e].weight};
+        dependencies.restoreNode(r.pid, edges, n, r.totalWeight, r.stamp);
+    }
+}
@@ -9,6 +9,16 @@
 #include <mutex>
 #include <atomic>
 #include <random>
+#include <memory>
+#include "priority_index.h"
+#include "process_table.h"
+#include "slot_store.h"
+#include "prediction_model.h"
+#include "online_model.h"
+#include "dependency_graph.h"
+#include "trace_log.h"
+#include "snapshot_format.h"
+#include "manager_stats.h"
 
 using pid_t = int;
 
@@ -18,7 +28,9 @@ struct UsageMetrics {
     int burstCount; // Number of bursts in recent window
     int cpuUsage;   // Simulated CPU usage
     int ioUsage;    // Simulated IO usage
-    UsageMetrics() : lastInteractionTime(0), interactionCount(0), burstCount(0), cpuUsage(0), ioUsage(0) {}
+    uint8_t hourActivity[24]; // Updates by local hour of day; halved when one saturates
+    UsageMetrics()
+        : lastInteractionTime(0), interactionCount(0), burstCount(0), cpuUsage(0), ioUsage(0), hourActivity{} {}
 };
 
 struct ApplicationEvent {
@@ -26,6 +38,22 @@ struct ApplicationEvent {
     pid_t previous_pid;
 };
 
+// One entry of a batched usage update
+struct UsageUpdate {
+    ProcessHandle process;
+    ApplicationEvent event;
+    int cpuUsage;
+    int ioUsage;
+};
+
+// How a scheduling decision worked out: time the process waited for the CPU
+// and then ran
+struct SchedulingOutcome {
+    ProcessHandle process;
+    float waitMs;
+    float runMs;
+};
+
 struct ApplicationProfile {
     pid_t pid;
     std::string name;
@@ -35,15 +63,6 @@ struct TimeSlice {
     int ms;
 };
 
-namespace ML {
-    struct PredictionModel {
-        float predict(const std::vector<float>& features) {
-            // Stub: return a dummy importance
-            return features.empty() ? 1.0f : features[0] * 0.1f + 1.0f;
-        }
-    };
-}
-
 class AdaptiveScheduler {
 public:
     struct SchedulingDecision {
@@ -54,29 +73,133 @@ public:
     };
 
     AdaptiveScheduler();
-    // Update process usage metrics (thread-safe)
+    // Per-process state is keyed by slots of table, which the memory and
+    // security managers may share
+    explicit AdaptiveScheduler(std::shared_ptr<ProcessTable> table);
+    // Update process usage metrics (thread-safe); no-op for unregistered processes
     void updateUsageMetrics(pid_t pid, ApplicationEvent event, int cpuUsage = 0, int ioUsage = 0);
-    // Calculate dynamic priorities for all processes
+    void updateUsageMetrics(ProcessHandle process, ApplicationEvent event, int cpuUsage = 0, int ioUsage = 0);
+    // Same as updateUsageMetrics for each entry, locking every metrics stripe at
+    // most once and the dependency graph at most once per call
+    void updateUsageMetricsBatch(const UsageUpdate* updates, size_t count);
+    // Calculate dynamic priorities for all processes (full list, sorted by importance)
     std::vector<SchedulingDecision> calculateProcessPriorities();
-    // Register a new process
-    void registerProcess(pid_t pid, const std::string& name);
+    // The n most important processes; only PIDs changed since the last pass are rescored
+    std::vector<SchedulingDecision> topK(size_t n);
+    // Hand out decisions one at a time in priority order; restarts from the top
+    // whenever metrics changed since the previous call. Rescoring for time or
+    // a new model only reorders the decisions not handed out yet. Returns
+    // false when exhausted.
+    bool next(SchedulingDecision& out);
+    // Feed outcomes to the online trainer, paired with the features each
+    // process was last scored with; unregistered or unscored processes are
+    // skipped. Training happens on the trainer's thread: a published model
+    // rescores every process on the next pass, and scoring never waits for it.
+    void reportOutcomes(const SchedulingOutcome* outcomes, size_t count);
+    void reportOutcome(ProcessHandle process, float waitMs, float runMs);
+    void startTraining(std::chrono::milliseconds interval) { trainer.start(interval); }
+    void stopTraining() { trainer.stop(); }
+    // Train on the queued outcomes on the calling thread (deterministic runs)
+    size_t trainOnce() { return trainer.trainOnce(); }
+    ML::TrainerStats trainingStats() { return trainer.stats(); }
+    ML::ModelVersion currentModel() { return *models.read(); }
+    // Register a new process; the handle skips the PID lookup on later calls
+    ProcessHandle registerProcess(pid_t pid, const std::string& name);
     // Remove a process
     void unregisterProcess(pid_t pid);
     // For simulation: get all known PIDs
     std::vector<pid_t> getAllPIDs();
+    // Processes the user most often switches to pid from, strongest first
+    std::vector<DependencyGraph::Edge> getStrongestPredecessors(pid_t pid, size_t k);
+    // Record every call above that changes state or scores (nullptr stops);
+    // the recorder must outlive its attachment
+    void setTraceRecorder(TraceRecorder* recorder) { trace.store(recorder, std::memory_order_release); }
+    // Snapshot support (state_snapshot.h). saveState fills the records of the
+    // given processes, sets IN_SCHEDULER for those registered here and appends
+    // their names to names; restoreState installs the processes with
+    // IN_SCHEDULER set, whose handles the caller has already acquired.
+    void saveState(const ProcessHandle* handles, size_t count, Snapshot::ProcessRecord* processes,
+                   Snapshot::SchedulerRecord* records, std::string& names);
+    void restoreState(const ProcessHandle* handles, size_t count, const Snapshot::ProcessRecord* processes,
+                      const Snapshot::SchedulerRecord* records, const char* names, size_t namesBytes);
+    void saveDependencies(std::vector<Snapshot::DependencyRecord>& out);
+    void restoreDependencies(const Snapshot::DependencyRecord* records, size_t count);
+    // Latency of each call above (pid overloads are timed through the handle
+    // overload they call) and contention on mtx; see manager_stats.h
+    std::string statsSnapshot(StatsFormat format = StatsFormat::JSON) { return callStats.snapshot(format); }
+    void setStatsEnabled(bool on) { callStats.setEnabled(on); }
 
 private:
-    std::unordered_map<pid_t, UsageMetrics> processMetrics;
-    std::unordered_map<pid_t, ApplicationProfile> userProfiles;
-    ML::PredictionModel priorityModel;
-    std::mutex mtx;
-    std::unordered_map<pid_t, std::vector<pid_t>> dependencies;
+    // Per-process state lives in dense slot-indexed stores with striped locks;
+    // processMetrics tracks changed processes, which are rescored on the next pass
+    std::shared_ptr<ProcessTable> table;
+    SlotStore<UsageMetrics> processMetrics;
+    SlotStore<ApplicationProfile> userProfiles;
+    // Scoring reads the latest published model without locking; the trainer
+    // is declared after it so that its thread stops first
+    ML::ModelPublisher models;
+    ML::OnlineTrainer trainer{models};
+    uint64_t scoredVersion = 0; // Model version the priority index was scored with
+    int scoredHour = -1;        // Local hour TIME_OF_DAY was computed for
+    long utcOffset;             // Local time minus UTC, in seconds
+    enum Timed : size_t {
+        TIME_REGISTER, TIME_UNREGISTER, TIME_UPDATE_USAGE, TIME_UPDATE_USAGE_BATCH, TIME_PRIORITIES, TIME_TOP_K,
+        TIME_NEXT, TIME_PREDECESSORS, TIME_ALL_PIDS, TIME_REPORT_OUTCOMES, TIMED_COUNT
+    };
+    static constexpr const char* TIMED_NAMES[TIMED_COUNT] = {
+        "registerProcess", "unregisterProcess", "updateUsageMetrics", "updateUsageMetricsBatch",
+        "calculateProcessPriorities", "topK", "next", "getStrongestPredecessors", "getAllPIDs",
+        "reportOutcomes"
+    };
+    ManagerStats callStats{"scheduler", TIMED_NAMES, TIMED_COUNT};
+    // Guards the dependency graph, the feature matrix and the priority index
+    StatsMutex mtx{callStats};
+    DependencyGraph dependencies;
+    // Predecessors of the focused process get a temporary importance boost,
+    // since the user is likely to switch back to them
+    std::unordered_map<pid_t, float> preBoosts;
+    const size_t PRE_BOOST_COUNT = 3;
+    // Model inputs in contiguous columns, one row per process
+    ML::FeatureMatrix features;
+    std::vector<uint32_t> featureRowOfSlot; // NO_ROW when the slot has none
+    std::vector<uint32_t> slotOfFeatureRow;
+    static constexpr uint32_t NO_ROW = UINT32_MAX;
+    // Scratch reused across passes so scoring never allocates per process
+    std::vector<size_t> changedRows;
+    std::vector<bool> changedMetrics; // By changedRows entry: false if only due a refresh
+    std::vector<float> batchScores;
+    // Batch-score the whole matrix once at least 1/N of the processes changed
+    const size_t BATCH_SCORING_FRACTION = 4;
+    // Recency and dependency decay age without a metrics change, so every
+    // scored row is marked changed again after a quarter of its idle time
+    // (1 s to REFRESH_MAX_SECONDS). Due rows wait in a wheel of one-second
+    // buckets; an entry is stale once its slot was rescheduled.
+    struct RefreshEntry {
+        ProcessHandle process;
+        std::time_t due;
+    };
+    static constexpr std::time_t REFRESH_MAX_SECONDS = 60;
+    static constexpr size_t REFRESH_WHEEL = 64; // Buckets, more than REFRESH_MAX_SECONDS
+    std::vector<RefreshEntry> refreshWheel[REFRESH_WHEEL];
+    std::vector<std::time_t> refreshDueOfSlot;
+    std::time_t wheelTime = 0; // Last second whose bucket was taken
+    // Incrementally maintained priority order
+    PriorityIndex<SchedulingDecision> priorityIndex;
+    std::atomic<TraceRecorder*> trace{nullptr};
 
+    void refreshPriorityIndex();
+    void touchStaleRows(std::time_t now);
+    void scheduleRefresh(ProcessHandle process, const UsageMetrics& metrics, std::time_t now);
+    size_t featureRowFor(pid_t pid, uint32_t slot);
+    void removeFeatureRow(uint32_t slot);
+    SchedulingDecision makeDecision(pid_t pid, float importance, float performanceFactor);
     void recordApplicationDependency(pid_t prev, pid_t curr);
+    void updatePreBoosts(pid_t focused, double now);
     float timeSinceLastInteraction(const UsageMetrics& metrics);
     float getDependencyScore(pid_t pid);
-    float getTimeOfDayRelevance(pid_t pid);
-    float getSystemPerformanceFactor(pid_t pid);
+    int hourOfDay(std::time_t now) const;
+    static void recordActivity(UsageMetrics& metrics, int hour);
+    float getTimeOfDayRelevance(const UsageMetrics& metrics, int hour);
     int calculateBasePriority(float importance);
     TimeSlice calculateTimeSlice(float importance, float perf);
 };
@@ -0,0 +1,106 @@
+#ifndef ADDRESS_RANGE_INDEX_H
+#define ADDRESS_RANGE_INDEX_H
+
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <shared_mutex>
+#include <cstddef>
+#include <cstdint>
+#include "cache_line.h"
+#include "memory_region.h"
+
+// Maps addresses to the live, non-overlapping MemoryRegion that contains them.
+// The address space is cut into 1 MiB chunks; each chunk keeps a small
+// vector of the regions overlapping it, sorted by start address, so a lookup
+// is one hash probe plus a binary search over a few cache lines. Chunks are
+// hashed over ShardCount shards, each behind its own reader/writer lock, so
+// concurrent validators only ever take a shared lock on one shard.
+template <size_t ShardCount = 64>
+class AddressRangeIndex {
+    static_assert((ShardCount & (ShardCount - 1)) == 0, "ShardCount must be a power of two");
+
+public:
+    static constexpr unsigned CHUNK_SHIFT = 20; // 1 MiB
+
+    // Record a region; regions must not overlap live ones
+    void insert(const MemoryRegion& region) {
+        if (!region.address || region.size == 0) return;
+        uintptr_t start = reinterpret_cast<uintptr_t>(region.address);
+        forEachChunk(start, region.size, [&](Shard& shard, uintptr_t chunk) {
+            auto& list = shard.chunks[chunk];
+            auto it = std::upper_bound(list.begin(), list.end(), start, StartLess());
+            if (it != list.begin() && startOf(*(it - 1)) == start) *(it - 1) = region;
+            else list.insert(it, region);
+        });
+    }
+
+    // Forget the region of the given extent starting at address; returns false
+    // if none was recorded
+    bool erase(const void* address, size_t size) {
+        uintptr_t start = reinterpret_cast<uintptr_t>(address);
+        bool found = false;
+        forEachChunk(start, size, [&](Shard& shard, uintptr_t chunk) {
+            auto c = shard.chunks.find(chunk);
+            if (c == shard.chunks.end()) return;
+            auto& list = c->second;
+            auto it = std::lower_bound(list.begin(), list.end(), start, StartLess());
+            if (it == list.end() || startOf(*it) != start) return;
+            list.erase(it);
+            if (list.empty()) shard.chunks.erase(c);
+            found = true;
+        });
+        return found;
+    }
+
+    // Copy the region containing address into out
+    bool find(const void* address, MemoryRegion& out) const {
+        uintptr_t addr = reinterpret_cast<uintptr_t>(address);
+        uintptr_t chunk = addr >> CHUNK_SHIFT;
+        const Shard& shard = shards[shardIndex(chunk)];
+        std::shared_lock<std::shared_mutex> lock(shard.mtx);
+        auto c = shard.chunks.find(chunk);
+        if (c == shard.chunks.end()) return false;
+        const auto& list = c->second;
+        auto it = std::upper_bound(list.begin(), list.end(), addr, StartLess());
+        if (it == list.begin()) return false;
+        --it;
+        if (addr - startOf(*it) >= it->size) return false;
+        out = *it;
+        return true;
+    }
+
+    static size_t shardIndex(uintptr_t chunk) {
+        // Fibonacci hashing so neighbouring chunks land in different shards
+        return static_cast<size_t>((chunk * 11400714819323198485ull) >> 58) & (ShardCount - 1);
+    }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        mutable std::shared_mutex mtx;
+        std::unordered_map<uintptr_t, std::vector<MemoryRegion>> chunks;
+    };
+    struct StartLess {
+        bool operator()(uintptr_t addr, const MemoryRegion& r) const { return addr < startOf(r); }
+        bool operator()(const MemoryRegion& r, uintptr_t addr) const { return startOf(r) < addr; }
+    };
+
+    Shard shards[ShardCount];
+
+    static uintptr_t startOf(const MemoryRegion& r) { return reinterpret_cast<uintptr_t>(r.address); }
+
+    // Run fn(shard, chunk) under the shard's exclusive lock for every chunk
+    // overlapped by [start, start + size)
+    template <typename Fn>
+    void forEachChunk(uintptr_t start, size_t size, Fn&& fn) {
+        uintptr_t last = (start + (size ? size - 1 : 0)) >> CHUNK_SHIFT;
+        for (uintptr_t chunk = start >> CHUNK_SHIFT; chunk <= last; ++chunk) {
+            Shard& shard = shards[shardIndex(chunk)];
+            std::unique_lock<std::shared_mutex> lock(shard.mtx);
+            fn(shard, chunk);
+        }
+    }
+};
+
+#endif // ADDRESS_RANGE_INDEX_H
@@ -0,0 +1,157 @@
+#include "anomaly_detector.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    std::atomic<uint64_t> nextDetectorId{1};
+}
+
+// The calling thread's rings, one per detector it has recorded into
+struct DetectorBufferCache {
+    struct Entry {
+        uint64_t detector;
+        std::shared_ptr<AnomalyDetector::ThreadBuffer> buffer;
+    };
+    std::vector<Entry> entries;
+    AnomalyDetector::ThreadBuffer* lastBuffer = nullptr;
+    uint64_t lastDetector = 0;
+
+    ~DetectorBufferCache() {
+        for (auto& e : entries) e.buffer->abandoned.store(true, std::memory_order_release);
+    }
+};
+
+AnomalyDetector::AnomalyDetector()
+    : id(nextDetectorId.fetch_add(1, std::memory_order_relaxed)), lastPass(std::chrono::steady_clock::now()) {}
+
+AnomalyDetector::~AnomalyDetector() {
+    std::lock_guard<std::mutex> lock(registryMtx);
+    for (auto& buffer : buffers) buffer->orphaned.store(true, std::memory_order_release);
+}
+
+AnomalyDetector::ThreadBuffer& AnomalyDetector::localBuffer() {
+    thread_local DetectorBufferCache cache;
+    if (cache.lastDetector == id) return *cache.lastBuffer;
+    auto it = std::find_if(cache.entries.begin(), cache.entries.end(),
+                           [&](const DetectorBufferCache::Entry& e) { return e.detector == id; });
+    if (it == cache.entries.end()) {
+        // Drop rings of detectors that no longer exist before adding ours
+        cache.entries.erase(std::remove_if(cache.entries.begin(), cache.entries.end(),
+                                           [](const DetectorBufferCache::Entry& e) {
+                                               return e.buffer->orphaned.load(std::memory_order_acquire);
+                                           }),
+                            cache.entries.end());
+        auto buffer = std::make_shared<ThreadBuffer>();
+        {
+            std::lock_guard<std::mutex> lock(registryMtx);
+            buffers.push_back(buffer);
+        }
+        cache.entries.push_back({id, buffer});
+        it = cache.entries.end() - 1;
+    }
+    cache.lastDetector = id;
+    cache.lastBuffer = it->buffer.get();
+    return *cache.lastBuffer;
+}
+
+void AnomalyDetector::record(pid_t pid, const void* address, size_t size, AccessType access, Outcome outcome) {
+    AccessRecord r{reinterpret_cast<uintptr_t>(address), static_cast<uint32_t>(std::min<size_t>(size, UINT32_MAX)),
+                   pid, access, outcome};
+    if (!localBuffer().ring.push(r)) dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AnomalyDetector::registerRegionForMonitoring(pid_t pid, const MemoryRegion&) {
+    sketches[pid].regions++;
+}
+
+void AnomalyDetector::forgetProcess(pid_t pid) {
+    // Records still queued for pid recreate a fresh sketch; harmless
+    sketches.erase(pid);
+}
+
+void AnomalyDetector::collect() {
+    AccessRecord batch[DRAIN_BATCH];
+    std::lock_guard<std::mutex> lock(registryMtx);
+    for (size_t i = 0; i < buffers.size();) {
+        ThreadBuffer& buffer = *buffers[i];
+        bool abandoned = buffer.abandoned.load(std::memory_order_acquire);
+        size_t n;
+        while ((n = buffer.ring.popBulk(batch, DRAIN_BATCH)) > 0) {
+            for (size_t j = 0; j < n; ++j) fold(batch[j]);
+        }
+        if (abandoned) {
+            buffers[i] = std::move(buffers.back());
+            buffers.pop_back();
+        } else {
+            ++i;
+        }
+    }
+}
+
+void AnomalyDetector::fold(const AccessRecord& r) {
+    Sketch& s = sketches[r.pid];
+    if (!s.dirty) {
+        s.dirty = true;
+        dirtyPids.push_back(r.pid);
+    }
+    s.windowEvents++;
+    s.strideWindow[strideBucket(s.lastAddress, r.address)]++;
+    s.lastAddress = r.address;
+    if (r.outcome == Outcome::VIOLATION) {
+        s.windowViolations++;
+    } else if (r.outcome == Outcome::UNTRACKED) {
+        s.windowUntracked++;
+    }
+}
+
+int AnomalyDetector::strideBucket(uintptr_t from, uintptr_t to) {
+    uintptr_t stride = from > to ? from - to : to - from;
+    int bucket = 0;
+    while (stride > 0 && bucket < STRIDE_BUCKETS - 1) {
+        stride >>= 4;
+        ++bucket;
+    }
+    return bucket;
+}
+
+// Score one window against the process's own history, then fold the window
+// into that history
+int AnomalyDetector::score(Sketch& s, float seconds) {
+    const uint32_t MIN_EVENTS = 32; // Too few events to judge rate or locality
+    float rate = s.windowEvents / seconds;
+    bool judged = s.windows >= WARMUP_WINDOWS && s.windowEvents >= MIN_EVENTS;
+    int severity = 20 * static_cast<int>(std::min<uint32_t>(s.windowViolations, 5));
+    if (judged && rate > 8.0f * s.rateEwma) severity += 30;
+    float distance = 0.0f;
+    for (int b = 0; b < STRIDE_BUCKETS; ++b) {
+        float share = static_cast<float>(s.strideWindow[b]) / s.windowEvents;
+        distance += std::fabs(share - s.strideBaseline[b]);
+        s.strideBaseline[b] = s.windows == 0 ? share : s.strideBaseline[b] + STRIDE_ALPHA * (share - s.strideBaseline[b]);
+        s.strideWindow[b] = 0;
+    }
+    // Distance ranges 0..2; above 1 the access pattern has mostly changed
+    if (judged && distance > 1.0f) severity += static_cast<int>(25.0f * distance);
+    // Mostly probing outside its own regions
+    if (judged && s.regions > 0 && s.windowUntracked * 2 > s.windowEvents) severity += 10;
+    s.rateEwma = s.windows == 0 ? rate : s.rateEwma + RATE_ALPHA * (rate - s.rateEwma);
+    s.windows++;
+    s.windowEvents = s.windowViolations = s.windowUntracked = 0;
+    return std::min(severity, 100);
+}
+
+std::vector<Anomaly> AnomalyDetector::detectAnomalies() {
+    collect();
+    auto now = std::chrono::steady_clock::now();
+    float seconds = std::max(std::chrono::duration<float>(now - lastPass).count(), 1e-3f);
+    lastPass = now;
+    std::vector<Anomaly> anomalies;
+    for (pid_t pid : dirtyPids) {
+        auto it = sketches.find(pid);
+        if (it == sketches.end() || !it->second.dirty) continue;
+        it->second.dirty = false;
+        int severity = score(it->second, seconds);
+        if (severity >= MIN_SEVERITY) anomalies.push_back({pid, severity});
+    }
+    dirtyPids.clear();
+    return anomalies;
+}
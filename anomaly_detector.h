@@ -0,0 +1,105 @@
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "memory_region.h"
+#include "spsc_ring.h"
+
+struct Anomaly {
+    pid_t pid;
+    int severity;
+};
+
+// Streaming per-process access anomaly detector.
+// record() is called on the validation hot path: it pushes a small record into
+// the calling thread's own SPSC ring and never takes a shared lock (the ring is
+// registered once per thread). The single consumer folds the rings into a
+// compact sketch per PID (access-rate EWMA, log2 stride histogram, violation
+// and out-of-region counts) and only re-scores PIDs that received events since
+// the last pass, so detectAnomalies() is O(processes with new events).
+// collect()/detectAnomalies()/register/forget must be called by one thread at
+// a time (the security manager calls them under its mutex).
+class AnomalyDetector {
+public:
+    enum class Outcome : uint8_t {
+        IN_REGION,  // Allowed access inside a tracked region
+        UNTRACKED,  // Address outside every tracked region
+        VIOLATION   // Denied: foreign owner, out of bounds or forbidden type
+    };
+
+    AnomalyDetector();
+    ~AnomalyDetector();
+    AnomalyDetector(const AnomalyDetector&) = delete;
+    AnomalyDetector& operator=(const AnomalyDetector&) = delete;
+
+    // Producer side; thread-safe and lock-free after a thread's first call
+    void record(pid_t pid, const void* address, size_t size, AccessType access, Outcome outcome);
+
+    // Consumer side
+    void registerRegionForMonitoring(pid_t pid, const MemoryRegion& region);
+    void forgetProcess(pid_t pid);
+    // Fold pending records and score every PID that saw new events
+    std::vector<Anomaly> detectAnomalies();
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    // Anomalies below this severity are not reported
+    static constexpr int MIN_SEVERITY = 10;
+
+private:
+    static constexpr size_t RING_CAPACITY = 4096;
+    static constexpr size_t DRAIN_BATCH = 256;
+    static constexpr int STRIDE_BUCKETS = 8;  // log16 of the stride: 0, <16 B, .., >=16^6 B
+    static constexpr int WARMUP_WINDOWS = 4;  // Windows observed before rates are judged
+    static constexpr float RATE_ALPHA = 0.25f;
+    static constexpr float STRIDE_ALPHA = 0.1f;
+
+    struct AccessRecord {
+        uintptr_t address;
+        uint32_t size;
+        pid_t pid;
+        AccessType access;
+        Outcome outcome;
+    };
+    struct ThreadBuffer {
+        SpscRing<AccessRecord> ring{RING_CAPACITY};
+        std::atomic<bool> abandoned{false}; // Producing thread has exited
+        std::atomic<bool> orphaned{false};  // Detector has been destroyed
+    };
+    friend struct DetectorBufferCache;
+
+    struct Sketch {
+        uintptr_t lastAddress = 0;
+        float rateEwma = 0.0f;                    // Accesses per second, smoothed
+        float strideBaseline[STRIDE_BUCKETS] = {}; // Smoothed stride distribution
+        uint32_t strideWindow[STRIDE_BUCKETS] = {};
+        uint32_t windowEvents = 0;
+        uint32_t windowViolations = 0;
+        uint32_t windowUntracked = 0;
+        uint32_t windows = 0;
+        uint32_t regions = 0;
+        bool dirty = false;
+    };
+
+    const uint64_t id; // Distinguishes detectors in the per-thread buffer cache
+    std::atomic<uint64_t> dropped{0};
+    std::mutex registryMtx; // Guards buffers
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+    std::unordered_map<pid_t, Sketch> sketches;
+    std::vector<pid_t> dirtyPids;
+    std::chrono::steady_clock::time_point lastPass;
+
+    ThreadBuffer& localBuffer();
+    void collect();
+    void fold(const AccessRecord& r);
+    static int strideBucket(uintptr_t from, uintptr_t to);
+    static int score(Sketch& s, float seconds);
+};
+
+#endif // ANOMALY_DETECTOR_H
@@ -0,0 +1,319 @@
+// benchmark.cpp
+// Reproducible end-to-end benchmark built on the simulation workload. Replays
+// the same per-tick event stream as simulation.cpp for a configurable number
+// of processes and ticks, times every call to the main manager APIs and
+// reports ops/sec and latency percentiles as JSON. Every process reports
+// accesses to its tier block in proportion to its CPU use and then fills the
+// block with records once per tick, and a rebalance pass runs after each
+// tick, so the page faults and the swap file I/O or compression of tiering
+// show up in the report. With --record the run is also written to a trace
+// for trace_replay, and the timings include the cost of recording. The
+// managers' own statistics (manager_stats.h) are included under manager_stats.
+//
+// Usage: os_benchmark [--processes N] [--ticks N] [--seed N] [--mix balanced|cpu|memory|secure]
+//                     [--validations N] [--output FILE] [--no-rebalance]
+//                     [--slow-tier memory|file|compressed] [--record FILE]
+#include "adaptive_scheduler.h"
+#include "adaptive_memory_manager.h"
+#include "security_memory_manager.h"
+#include "event_log.h"
+#include "latency_histogram.h"
+#include "trace_log.h"
+#include "workload.h"
+#include <sys/resource.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Options {
+        int processes = 10000;
+        int ticks = 20;
+        uint64_t seed = 42;
+        WorkloadMix mix = WorkloadMix::BALANCED;
+        int validations = 4; // Per process per tick
+        std::string output;  // Empty: stdout
+        bool rebalance = true;
+        SlowTierMode slowTier = SlowTierMode::SWAP_FILE;
+        std::string recordPath; // Empty: no trace
+    };
+
+    enum Api {
+        UPDATE_USAGE_METRICS,
+        CALCULATE_PROCESS_PRIORITIES,
+        PREDICT_MEMORY_NEEDS,
+        ALLOCATE_MEMORY_BY_TIER,
+        ALLOCATE_SECURE_MEMORY,
+        VALIDATE_MEMORY_ACCESS,
+        REBALANCE_ONCE,
+        NUM_APIS
+    };
+    const char* const API_NAMES[NUM_APIS] = {
+        "updateUsageMetrics", "calculateProcessPriorities", "predictMemoryNeeds",
+        "allocateMemoryByTier", "allocateSecureMemory", "validateMemoryAccess", "rebalanceOnce"
+    };
+
+    void usage(const char* argv0) {
+        std::cerr << "usage: " << argv0 << " [--processes N (1..1000000)] [--ticks N] [--seed N]"
+                  << " [--mix balanced|cpu|memory|secure] [--validations N] [--output FILE]"
+                  << " [--no-rebalance] [--slow-tier memory|file|compressed] [--record FILE]\n";
+    }
+
+    bool parseOptions(int argc, char** argv, Options& opts) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--no-rebalance") {
+                opts.rebalance = false;
+                continue;
+            }
+            if (arg == "--help" || arg == "-h" || i + 1 >= argc) return false;
+            const char* value = argv[++i];
+            if (arg == "--processes") opts.processes = std::atoi(value);
+            else if (arg == "--ticks") opts.ticks = std::atoi(value);
+            else if (arg == "--seed") opts.seed = std::strtoull(value, nullptr, 10);
+            else if (arg == "--validations") opts.validations = std::atoi(value);
+            else if (arg == "--output") opts.output = value;
+            else if (arg == "--record") opts.recordPath = value;
+            else if (arg == "--mix") {
+                if (!parseWorkloadMix(value, opts.mix)) return false;
+            } else if (arg == "--slow-tier") {
+                if (!parseSlowTierMode(value, opts.slowTier)) return false;
+            } else {
+                return false;
+            }
+        }
+        return opts.processes > 0 && opts.processes <= 1000000 && opts.ticks > 0 && opts.validations >= 0;
+    }
+
+    // Run fn, adding its duration to hist (and storing it in *ns if given)
+    template <typename Fn>
+    auto timed(LatencyHistogram& hist, Fn&& fn, uint64_t* ns = nullptr) {
+        auto start = std::chrono::steady_clock::now();
+        auto result = fn();
+        uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        hist.record(elapsed);
+        if (ns) *ns = elapsed;
+        return result;
+    }
+
+    // allocateMemoryByTier latencies split by whether a reservation served the call
+    struct ReservationReport {
+        ReservationStats stats;
+        LatencyHistogram hit;
+        LatencyHistogram miss;
+    };
+
+    // Page faults taken by the process over the run
+    struct PageFaults {
+        long minor = 0;
+        long major = 0;
+    };
+
+    PageFaults pageFaults() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return {usage.ru_minflt, usage.ru_majflt};
+    }
+
+    // Write a small record every RECORD_STRIDE bytes of the block, as a
+    // process filling its working set would; the data compresses like
+    // typical heap pages
+    constexpr size_t RECORD_STRIDE = 64;
+    void touchPages(void* addr, size_t size, pid_t pid, int tick) {
+        auto p = static_cast<char*>(addr);
+        for (size_t offset = 0; offset + 16 <= size; offset += RECORD_STRIDE) {
+            uint32_t record[4] = {static_cast<uint32_t>(pid), static_cast<uint32_t>(tick),
+                                  static_cast<uint32_t>(offset / RECORD_STRIDE), 0x5ca1ab1e};
+            std::memcpy(p + offset, record, sizeof record);
+        }
+    }
+
+    void writeLatency(std::ostream& out, const char* name, const LatencyHistogram& h) {
+        out << "\"" << name << "_mean_ns\": " << h.mean() << ", \"" << name << "_p50_ns\": " << h.percentile(0.5)
+            << ", \"" << name << "_p99_ns\": " << h.percentile(0.99) << ", \"" << name << "_max_ns\": " << h.max();
+    }
+
+    void writeJson(std::ostream& out, const Options& opts, double wallSeconds,
+                   const LatencyHistogram (&hist)[NUM_APIS], const ReservationReport& res,
+                   const TieringStats& tiers, const CompressionStats& comp, const PageFaults& faults,
+                   uint64_t tierFailures, uint64_t secureFailures, const TraceRecorder* recorder,
+                   const std::string& managerStats) {
+        out << "{\n";
+        out << "  \"config\": {\"processes\": " << opts.processes << ", \"ticks\": " << opts.ticks
+            << ", \"seed\": " << opts.seed << ", \"mix\": \"" << workloadMixName(opts.mix)
+            << "\", \"validations\": " << opts.validations << ", \"rebalance\": " << std::boolalpha
+            << opts.rebalance << std::noboolalpha << ", \"slow_tier\": \"" << slowTierModeName(opts.slowTier)
+            << "\"},\n";
+        out << "  \"wall_seconds\": " << wallSeconds << ",\n";
+        out << "  \"apis\": {\n";
+        for (int a = 0; a < NUM_APIS; ++a) {
+            const LatencyHistogram& h = hist[a];
+            double busySeconds = h.sumNs() / 1e9;
+            out << "    \"" << API_NAMES[a] << "\": {"
+                << "\"ops\": " << h.count()
+                << ", \"ops_per_sec\": " << (busySeconds > 0 ? h.count() / busySeconds : 0.0)
+                << ", \"mean_ns\": " << h.mean()
+                << ", \"p50_ns\": " << h.percentile(0.5)
+                << ", \"p99_ns\": " << h.percentile(0.99)
+                << ", \"p999_ns\": " << h.percentile(0.999)
+                << ", \"max_ns\": " << h.max() << "}"
+                << (a + 1 < NUM_APIS ? ",\n" : "\n");
+        }
+        out << "  },\n";
+        out << "  \"reservations\": {\"hit_rate\": " << res.stats.hitRate()
+            << ", \"reserved\": " << res.stats.reserved
+            << ", \"reserved_bytes\": " << res.stats.reservedBytes
+            << ", \"wasted_bytes\": " << res.stats.wastedBytes
+            << ", \"reclaimed\": " << res.stats.reclaimed
+            << ", \"hit_mean_ns\": " << res.hit.mean() << ", \"hit_p50_ns\": " << res.hit.percentile(0.5)
+            << ", \"miss_mean_ns\": " << res.miss.mean() << ", \"miss_p50_ns\": " << res.miss.percentile(0.5)
+            << ", \"saved_ns\": " << (res.miss.mean() - res.hit.mean()) * res.hit.count() << "},\n";
+        out << "  \"tiering\": {\"fast_tier_hit_ratio\": " << tiers.fastTierHitRatio()
+            << ", \"promotions\": " << tiers.promotions << ", \"promoted_bytes\": " << tiers.promotedBytes
+            << ", \"demotions\": " << tiers.demotions << ", \"demoted_bytes\": " << tiers.demotedBytes
+            << ", \"file_maps\": " << tiers.fileMaps << ", \"writebacks\": " << tiers.writebacks
+            << ", \"remaps\": " << tiers.remaps << ", \"access_restores\": " << tiers.accessRestores
+            << ", \"restore_failures\": " << tiers.restoreFailures << ", ";
+        writeLatency(out, "demote", tiers.demoteNs);
+        out << ", ";
+        writeLatency(out, "promote", tiers.promoteNs);
+        out << "},\n";
+        out << "  \"compression\": {\"ratio\": " << comp.ratio()
+            << ", \"resident_bytes_saved\": " << comp.residentBytesSaved()
+            << ", \"compress_cpu_s_per_gb\": " << comp.compressSecondsPerGB()
+            << ", \"decompress_cpu_s_per_gb\": " << comp.decompressSecondsPerGB()
+            << ", \"compressed_pages\": " << comp.compressedPages << ", \"zero_pages\": " << comp.zeroPages
+            << ", \"stored_bytes\": " << comp.storedBytes << ", \"slab_bytes\": " << comp.slabBytes
+            << ", \"pages_compressed\": " << comp.pagesCompressed << ", \"pages_rejected\": " << comp.pagesRejected
+            << ", \"pages_restored\": " << comp.pagesRestored << ", \"pages_failed\": " << comp.pagesFailed << "},\n";
+        if (recorder) {
+            uint64_t records = recorder->recordCount(), bytes = recorder->bytesWritten();
+            out << "  \"trace\": {\"path\": \"" << opts.recordPath << "\", \"records\": " << records
+                << ", \"bytes\": " << bytes << ", \"bytes_per_record\": " << (records ? double(bytes) / records : 0.0)
+                << "},\n";
+        }
+        out << "  \"manager_stats\": " << managerStats << ",\n";
+        out << "  \"page_faults\": {\"minor\": " << faults.minor << ", \"major\": " << faults.major << "},\n";
+        out << "  \"allocation_failures\": {\"tier\": " << tierFailures << ", \"secure\": " << secureFailures << "},\n";
+        out << "  \"dropped_log_events\": " << EventLog::instance().droppedCount() << "\n";
+        out << "}\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opts;
+    if (!parseOptions(argc, argv, opts)) {
+        usage(argv[0]);
+        return 1;
+    }
+    // Measure the managers, not the console
+    EventLog::instance().setLevel(LogLevel::OFF);
+
+    std::unique_ptr<TraceRecorder> recorder;
+    if (!opts.recordPath.empty()) {
+        recorder = std::make_unique<TraceRecorder>(opts.recordPath);
+        if (!recorder->ok()) {
+            std::cerr << "cannot write " << opts.recordPath << "\n";
+            return 1;
+        }
+    }
+
+    auto table = std::make_shared<ProcessTable>();
+    AdaptiveScheduler scheduler(table);
+    AdaptiveMemoryManager memManager(table, opts.slowTier);
+    SecurityMemoryManager secManager(table);
+    scheduler.setTraceRecorder(recorder.get());
+    memManager.setTraceRecorder(recorder.get());
+    secManager.setTraceRecorder(recorder.get());
+    std::vector<SimProcess> processes = makeProcesses(opts.processes, opts.mix, opts.seed);
+    for (auto& proc : processes) {
+        proc.handle = scheduler.registerProcess(proc.pid, proc.name);
+        memManager.registerProcess(proc.pid);
+        secManager.registerProcess(proc.pid);
+    }
+
+    LatencyHistogram hist[NUM_APIS];
+    ReservationReport reservations;
+    uint64_t tierFailures = 0, secureFailures = 0;
+    PageFaults faultsBefore = pageFaults();
+    auto wallStart = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < opts.ticks; ++tick) {
+        for (auto& proc : processes) {
+            TickEvent e = tickEvent(proc, tick, opts.seed);
+            proc.memAllocated = e.mem;
+            timed(hist[UPDATE_USAGE_METRICS], [&] {
+                scheduler.updateUsageMetrics(proc.handle, {ApplicationEvent::OTHER, 0}, e.cpu, e.io);
+                return 0;
+            });
+            timed(hist[PREDICT_MEMORY_NEEDS], [&] {
+                memManager.predictMemoryNeeds(proc.handle, e.mem);
+                return 0;
+            });
+            if (proc.memAddress) memManager.freeMemory(proc.pid, proc.memAddress);
+            uint64_t hitsBefore = memManager.getReservationStats().hits, allocNs = 0;
+            proc.memAddress = timed(hist[ALLOCATE_MEMORY_BY_TIER], [&] {
+                return memManager.allocateMemoryByTier(proc.handle, e.mem, proc.secLevel);
+            }, &allocNs);
+            bool reserved = memManager.getReservationStats().hits != hitsBefore;
+            (reserved ? reservations.hit : reservations.miss).record(allocNs);
+            tierFailures += proc.memAddress == nullptr;
+            if (proc.memAddress) {
+                memManager.recordMemoryAccess(proc.handle, proc.memAddress, static_cast<uint32_t>(e.cpu));
+                touchPages(proc.memAddress, e.mem, proc.pid, tick);
+            }
+            if (proc.secAddress) secManager.freeSecureMemory(proc.pid, proc.secAddress);
+            size_t secSize = e.mem / 4;
+            proc.secAddress = timed(hist[ALLOCATE_SECURE_MEMORY], [&] {
+                return secManager.allocateSecureMemory(proc.handle, secSize, proc.secLevel).address;
+            });
+            if (!proc.secAddress) {
+                secureFailures++;
+                continue;
+            }
+            for (int v = 0; v < opts.validations; ++v) {
+                size_t offset = workloadHash(opts.seed, static_cast<uint64_t>(proc.pid), (uint64_t(tick) << 16) | v)
+                                % (secSize - 8 + 1);
+                timed(hist[VALIDATE_MEMORY_ACCESS], [&] {
+                    return secManager.validateMemoryAccess(proc.pid, static_cast<char*>(proc.secAddress) + offset,
+                                                           8, AccessType::READ);
+                });
+            }
+        }
+        memManager.analyzeMemoryUsage();
+        secManager.monitorMemoryAccess();
+        timed(hist[CALCULATE_PROCESS_PRIORITIES], [&] { return scheduler.calculateProcessPriorities().size(); });
+        if (opts.rebalance) {
+            timed(hist[REBALANCE_ONCE], [&] {
+                memManager.rebalanceOnce();
+                return 0;
+            });
+        }
+    }
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wallStart;
+    PageFaults faultsAfter = pageFaults();
+    PageFaults faults{faultsAfter.minor - faultsBefore.minor, faultsAfter.major - faultsBefore.major};
+    reservations.stats = memManager.getReservationStats();
+    TieringStats tiers = memManager.getTieringStats();
+    CompressionStats compression = memManager.getCompressionStats();
+    scheduler.setTraceRecorder(nullptr);
+    memManager.setTraceRecorder(nullptr);
+    secManager.setTraceRecorder(nullptr);
+    if (recorder) recorder->flush();
+    std::string managerStats = "{\"scheduler\": " + scheduler.statsSnapshot() + ", \"memory\": " +
+                               memManager.statsSnapshot() + ", \"security\": " + secManager.statsSnapshot() + "}";
+
+    if (opts.output.empty()) {
+        writeJson(std::cout, opts, wall.count(), hist, reservations, tiers, compression, faults, tierFailures,
+                  secureFailures, recorder.get(), managerStats);
+    } else {
+        std::ofstream file(opts.output);
+        writeJson(file, opts, wall.count(), hist, reservations, tiers, compression, faults, tierFailures,
+                  secureFailures, recorder.get(), managerStats);
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "buddy_arena.h"
+#include <sys/mman.h>
+#include <utility>
+
+BuddyArena::BuddyArena(size_t requested) {
+    capacity = requested / MIN_BLOCK * MIN_BLOCK;
+    if (capacity == 0) return;
+    void* mem = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) {
+        capacity = 0;
+        return;
+    }
+    base = static_cast<char*>(mem);
+    blockState.assign(capacity / MIN_BLOCK, NOT_HEAD);
+    int maxOrder = 0;
+    while (orderSize(maxOrder + 1) <= capacity) ++maxOrder;
+    freeLists.assign(maxOrder + 1, nullptr);
+    // Carve the region into the largest aligned blocks that fit
+    size_t offset = 0;
+    for (int order = maxOrder; order >= 0; --order) {
+        while (capacity - offset >= orderSize(order)) {
+            pushFree(base + offset, order);
+            offset += orderSize(order);
+        }
+    }
+}
+
+BuddyArena::~BuddyArena() {
+    if (base) munmap(base, capacity);
+}
+
+BuddyArena::BuddyArena(BuddyArena&& other) noexcept
+    : base(std::exchange(other.base, nullptr)),
+      capacity(std::exchange(other.capacity, 0)),
+      usedBytes(std::exchange(other.usedBytes, 0)),
+      blockState(std::move(other.blockState)),
+      freeLists(std::move(other.freeLists)) {}
+
+void BuddyArena::pushFree(char* block, int order) {
+    auto node = reinterpret_cast<FreeNode*>(block);
+    node->prev = nullptr;
+    node->next = freeLists[order];
+    if (node->next) node->next->prev = node;
+    freeLists[order] = node;
+    blockState[indexOf(block)] = static_cast<uint8_t>(order) | FREE_FLAG;
+}
+
+void BuddyArena::unlinkFree(char* block, int order) {
+    auto node = reinterpret_cast<FreeNode*>(block);
+    if (node->prev) node->prev->next = node->next;
+    else freeLists[order] = node->next;
+    if (node->next) node->next->prev = node->prev;
+    blockState[indexOf(block)] = NOT_HEAD;
+}
+
+void* BuddyArena::allocate(size_t size) {
+    if (!base || size == 0) return nullptr;
+    int order = 0;
+    while (orderSize(order) < size) {
+        if (++order >= static_cast<int>(freeLists.size())) return nullptr;
+    }
+    int from = order;
+    while (from < static_cast<int>(freeLists.size()) && !freeLists[from]) ++from;
+    if (from == static_cast<int>(freeLists.size())) return nullptr;
+    char* block = reinterpret_cast<char*>(freeLists[from]);
+    unlinkFree(block, from);
+    // Split down to the requested order, returning upper halves to the lists
+    while (from > order) {
+        --from;
+        pushFree(block + orderSize(from), from);
+    }
+    blockState[indexOf(block)] = static_cast<uint8_t>(order);
+    usedBytes += orderSize(order);
+    return block;
+}
+
+size_t BuddyArena::release(void* ptr) {
+    if (!contains(ptr) || (static_cast<char*>(ptr) - base) % MIN_BLOCK != 0) return 0;
+    char* block = static_cast<char*>(ptr);
+    size_t index = indexOf(block);
+    uint8_t state = blockState[index];
+    if (state == NOT_HEAD || (state & FREE_FLAG) || (index * MIN_BLOCK) % orderSize(state) != 0) return 0;
+    int order = state;
+    size_t released = orderSize(order);
+    usedBytes -= released;
+    // Coalesce with the buddy while it is a free block of the same order
+    while (order + 1 < static_cast<int>(freeLists.size())) {
+        size_t offset = static_cast<size_t>(block - base);
+        size_t buddyOffset = offset ^ orderSize(order);
+        if (buddyOffset + orderSize(order) > capacity) break;
+        if (blockState[buddyOffset / MIN_BLOCK] != (static_cast<uint8_t>(order) | FREE_FLAG)) break;
+        unlinkFree(base + buddyOffset, order);
+        blockState[index] = NOT_HEAD;
+        block = base + (offset & ~orderSize(order));
+        index = indexOf(block);
+        ++order;
+    }
+    pushFree(block, order);
+    return released;
+}
+
+size_t BuddyArena::blockSize(void* ptr) const {
+    if (!contains(ptr) || (static_cast<char*>(ptr) - base) % MIN_BLOCK != 0) return 0;
+    uint8_t state = blockState[indexOf(ptr)];
+    if (state == NOT_HEAD || (state & FREE_FLAG)) return 0;
+    return orderSize(state);
+}
+
+size_t BuddyArena::largestFreeBlock() const {
+    for (int order = static_cast<int>(freeLists.size()) - 1; order >= 0; --order) {
+        if (freeLists[order]) return orderSize(order);
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef BUDDY_ARENA_H
+#define BUDDY_ARENA_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Binary buddy allocator over one anonymous mmap'd region.
+// Blocks are power-of-two multiples of MIN_BLOCK. Free blocks are threaded on
+// per-order intrusive lists stored inside the free memory itself; a side table
+// with one byte per MIN_BLOCK records the order and state of each block head.
+// allocate/release are O(log(capacity / MIN_BLOCK)) and freed blocks are
+// merged with their buddy immediately. Not thread-safe; callers lock.
+class BuddyArena {
+public:
+    static constexpr size_t MIN_BLOCK = 256;
+
+    // Reserves `capacity` bytes (rounded down to MIN_BLOCK); pages are only
+    // backed by RAM once touched
+    explicit BuddyArena(size_t capacity);
+    ~BuddyArena();
+    BuddyArena(const BuddyArena&) = delete;
+    BuddyArena& operator=(const BuddyArena&) = delete;
+    BuddyArena(BuddyArena&& other) noexcept;
+    BuddyArena& operator=(BuddyArena&&) = delete;
+
+    // Returns nullptr when no block of the required size is free
+    void* allocate(size_t size);
+    // Release a block returned by allocate; returns its block size (0 if unknown)
+    size_t release(void* ptr);
+    // Size of the block backing ptr (0 if ptr is not a live block head)
+    size_t blockSize(void* ptr) const;
+
+    // Block size that allocate(size) hands out
+    static size_t blockSizeFor(size_t size) {
+        size_t block = MIN_BLOCK;
+        while (block < size) block <<= 1;
+        return block;
+    }
+
+    bool contains(const void* ptr) const {
+        auto p = static_cast<const char*>(ptr);
+        return base && p >= base && p < base + capacity;
+    }
+    void* data() const { return base; }
+    size_t capacityBytes() const { return capacity; }
+    size_t freeBytes() const { return capacity - usedBytes; }
+    // Largest block that could be handed out right now
+    size_t largestFreeBlock() const;
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+        FreeNode* prev;
+    };
+    static constexpr uint8_t FREE_FLAG = 0x80;
+    static constexpr uint8_t NOT_HEAD = 0xFF;
+
+    char* base = nullptr;
+    size_t capacity = 0;
+    size_t usedBytes = 0;
+    std::vector<uint8_t> blockState;   // Per MIN_BLOCK: order | FREE_FLAG, or NOT_HEAD
+    std::vector<FreeNode*> freeLists;  // One list per order
+
+    static size_t orderSize(int order) { return MIN_BLOCK << order; }
+    size_t indexOf(const void* p) const { return static_cast<size_t>(static_cast<const char*>(p) - base) / MIN_BLOCK; }
+    void pushFree(char* block, int order);
+    void unlinkFree(char* block, int order);
+};
+
+#endif // BUDDY_ARENA_H
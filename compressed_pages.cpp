@@ -0,0 +1,200 @@
+#include "compressed_pages.h"
+#include "lz_codec.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+
+namespace {
+    bool allZero(const char* page, size_t size) {
+        for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, page + i, sizeof word);
+            if (word) return false;
+        }
+        return true;
+    }
+
+    uint64_t nsSince(std::chrono::steady_clock::time_point start) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+CompressedPages::CompressedPages(void* base, size_t capacity)
+    : base(static_cast<char*>(base)), pageSize(static_cast<size_t>(sysconf(_SC_PAGESIZE))) {
+    this->capacity = capacity / pageSize * pageSize;
+    if (!base || this->capacity == 0) {
+        this->base = nullptr;
+        return;
+    }
+    slots.assign(this->capacity / pageSize, RESIDENT);
+    counters.pageBytes = pageSize;
+}
+
+bool CompressedPages::covers(const void* addr, size_t size) const {
+    auto p = static_cast<const char*>(addr);
+    if (!enabled() || size == 0 || size % pageSize != 0 || p < base) return false;
+    size_t offset = static_cast<size_t>(p - base);
+    return offset % pageSize == 0 && offset + size <= capacity;
+}
+
+size_t CompressedPages::stage(const void* addr, size_t size) {
+    if (!covers(addr, size)) return 0;
+    auto start = std::chrono::steady_clock::now();
+    size_t first = pageOf(addr);
+    size_t last = first + size / pageSize;
+    uint8_t buffer[MAX_STORED];
+    for (size_t i = first; i < last; ++i) {
+        const char* page = base + i * pageSize;
+        if (allZero(page, pageSize)) {
+            slots[i] = ZERO_PAGE;
+            continue;
+        }
+        size_t n = Compression::compress(reinterpret_cast<const uint8_t*>(page), pageSize, buffer, MAX_STORED);
+        if (n) {
+            std::lock_guard<std::mutex> lock(mtx);
+            slots[i] = slab.store(buffer, n);
+        }
+    }
+
+    size_t held = 0;
+    size_t zeros = 0;
+    for (size_t i = first; i < last; ++i) {
+        held += slots[i] != RESIDENT;
+        zeros += slots[i] == ZERO_PAGE;
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    counters.compressedPages += held;
+    counters.zeroPages += zeros;
+    counters.pagesCompressed += held;
+    counters.pagesRejected += last - first - held;
+    counters.bytesExamined += size;
+    counters.compressNs += nsSince(start);
+    return held;
+}
+
+void CompressedPages::seal(void* addr, size_t size) {
+    if (!covers(addr, size)) return;
+    size_t first = pageOf(addr);
+    size_t last = first + size / pageSize;
+    for (size_t i = first; i < last;) {
+        if (slots[i] == RESIDENT) {
+            ++i;
+            continue;
+        }
+        size_t runStart = i;
+        while (i < last && slots[i] != RESIDENT) ++i;
+        char* run = base + runStart * pageSize;
+        size_t bytes = (i - runStart) * pageSize;
+        if (mprotect(run, bytes, PROT_NONE) == 0) {
+            madvise(run, bytes, MADV_DONTNEED);
+            continue;
+        }
+        // Out of mappings to split: the pages stay resident
+        std::lock_guard<std::mutex> lock(mtx);
+        dropLocked(runStart, i);
+    }
+}
+
+void CompressedPages::cancel(const void* addr, size_t size) {
+    if (!covers(addr, size)) return;
+    size_t first = pageOf(addr);
+    std::lock_guard<std::mutex> lock(mtx);
+    dropLocked(first, first + size / pageSize);
+}
+
+void CompressedPages::dropLocked(size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+        if (slots[i] == RESIDENT) continue;
+        if (slots[i] == ZERO_PAGE) {
+            --counters.zeroPages;
+        } else {
+            slab.erase(slots[i]);
+        }
+        --counters.compressedPages;
+        slots[i] = RESIDENT;
+    }
+}
+
+bool CompressedPages::restore(void* addr, size_t size) {
+    if (!covers(addr, size)) return true;
+    auto start = std::chrono::steady_clock::now();
+    size_t first = pageOf(addr);
+    size_t last = first + size / pageSize;
+    size_t restored = 0;
+    size_t zeros = 0;
+    size_t failed = 0;
+    bool resident = true;
+    for (size_t i = first; i < last;) {
+        if (slots[i] == RESIDENT) {
+            ++i;
+            continue;
+        }
+        size_t runStart = i;
+        while (i < last && slots[i] != RESIDENT) ++i;
+        if (mprotect(base + runStart * pageSize, (i - runStart) * pageSize, PROT_READ | PROT_WRITE) != 0) {
+            resident = false;
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        for (size_t j = runStart; j < i; ++j) {
+            char* page = base + j * pageSize;
+            // Released pages read as zeros, so zero pages need no work
+            if (slots[j] == ZERO_PAGE) {
+                ++zeros;
+            } else {
+                size_t n;
+                const uint8_t* data = slab.data(slots[j], n);
+                if (!Compression::decompress(data, n, reinterpret_cast<uint8_t*>(page), pageSize)) {
+                    // Keep the copy and seal the page again rather than hand
+                    // out a partly decompressed one
+                    madvise(page, pageSize, MADV_DONTNEED);
+                    mprotect(page, pageSize, PROT_NONE);
+                    ++failed;
+                    resident = false;
+                    continue;
+                }
+                slab.erase(slots[j]);
+            }
+            slots[j] = RESIDENT;
+            ++restored;
+        }
+    }
+    if (restored || failed) {
+        std::lock_guard<std::mutex> lock(mtx);
+        counters.compressedPages -= restored;
+        counters.zeroPages -= zeros;
+        counters.pagesRestored += restored;
+        counters.pagesFailed += failed;
+        counters.decompressNs += nsSince(start);
+    }
+    return resident;
+}
+
+void CompressedPages::discard(void* addr, size_t size) {
+    if (!covers(addr, size)) return;
+    size_t first = pageOf(addr);
+    size_t last = first + size / pageSize;
+    for (size_t i = first; i < last;) {
+        if (slots[i] == RESIDENT) {
+            ++i;
+            continue;
+        }
+        size_t runStart = i;
+        while (i < last && slots[i] != RESIDENT) ++i;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            dropLocked(runStart, i);
+        }
+        mprotect(base + runStart * pageSize, (i - runStart) * pageSize, PROT_READ | PROT_WRITE);
+    }
+}
+
+CompressionStats CompressedPages::stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    CompressionStats s = counters;
+    s.storedBytes = slab.storedBytes();
+    s.slabBytes = slab.slabBytes();
+    return s;
+}
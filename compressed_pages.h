@@ -0,0 +1,102 @@
+#ifndef COMPRESSED_PAGES_H
+#define COMPRESSED_PAGES_H
+
+#include "compressed_slab.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+struct CompressionStats {
+    uint64_t pageBytes = 0;
+    uint64_t compressedPages = 0; // Held compressed now, zero pages included
+    uint64_t zeroPages = 0;       // ... of which all zero, which take no slot
+    uint64_t storedBytes = 0;     // Compressed bytes in slab slots
+    uint64_t slabBytes = 0;       // Memory held by the slab
+    uint64_t pagesCompressed = 0; // Totals since construction
+    uint64_t pagesRejected = 0;   // ... left resident because they did not shrink enough
+    uint64_t pagesRestored = 0;
+    uint64_t pagesFailed = 0;     // ... not restored: the copy did not decompress
+    uint64_t bytesExamined = 0;   // Input to compression, rejected pages included
+    uint64_t compressNs = 0;
+    uint64_t decompressNs = 0;
+
+    // Original over compressed size of the non-zero pages held now
+    double ratio() const {
+        return storedBytes ? double((compressedPages - zeroPages) * pageBytes) / double(storedBytes) : 0.0;
+    }
+    // Memory the held pages would take resident, less the slab's
+    int64_t residentBytesSaved() const {
+        return static_cast<int64_t>(compressedPages * pageBytes) - static_cast<int64_t>(slabBytes);
+    }
+    // CPU seconds per GB (ns per byte) of input
+    double compressSecondsPerGB() const { return bytesExamined ? double(compressNs) / double(bytesExamined) : 0.0; }
+    double decompressSecondsPerGB() const {
+        uint64_t bytes = pagesRestored * pageBytes;
+        return bytes ? double(decompressNs) / double(bytes) : 0.0;
+    }
+};
+
+// Compressed storage for whole-page ranges of an existing mapping (the tier
+// arena). Each page compressed is copied into a CompressedSlab slot, found
+// again through a dense page-to-slot map, and its memory is released and made
+// inaccessible, so a touch the owner did not announce faults instead of
+// reading zeros. All-zero pages take no slot at all.
+//
+// As with SwapFile, each range is switched by its owner, so the map needs no
+// lock; an internal mutex guards the shared slab and the counters.
+class CompressedPages {
+public:
+    // Pages compressing to more than this stay resident
+    static constexpr size_t MAX_STORED = 3072;
+
+    // Disabled: nothing is ever compressed
+    CompressedPages() = default;
+    // Compressed storage for [base, base + capacity); disabled if base is null
+    CompressedPages(void* base, size_t capacity);
+    CompressedPages(const CompressedPages&) = delete;
+    CompressedPages& operator=(const CompressedPages&) = delete;
+
+    bool enabled() const { return base != nullptr; }
+    // Whether [addr, addr + size) is whole pages inside the mapping
+    bool covers(const void* addr, size_t size) const;
+
+    // Demotion, in two steps. stage compresses the pages of a resident range
+    // into the slab and leaves them accessible; returns the number of pages
+    // held compressed. seal then releases and protects the staged pages, or
+    // cancel drops their copies: a write between the two steps would be lost
+    // by sealing.
+    size_t stage(const void* addr, size_t size);
+    void seal(void* addr, size_t size);
+    void cancel(const void* addr, size_t size);
+    // Promotion or first access: decompress the range back in place. False if
+    // pages stay compressed and sealed because the range could not be made
+    // accessible or a copy did not decompress; a later call tries them again.
+    bool restore(void* addr, size_t size);
+    // Drop the range's compressed pages without restoring them (the range is
+    // being freed); they read as zeros afterwards
+    void discard(void* addr, size_t size);
+
+    CompressionStats stats() const;
+
+private:
+    // Page-to-slot map values besides slab handles
+    static constexpr uint32_t RESIDENT = 0;
+    static constexpr uint32_t ZERO_PAGE = 1;
+    static_assert(CompressedSlab::FIRST_HANDLE > ZERO_PAGE, "handles must not collide with markers");
+
+    char* base = nullptr;
+    size_t capacity = 0;
+    size_t pageSize = 0;
+    std::vector<uint32_t> slots; // By page
+
+    mutable std::mutex mtx;
+    CompressedSlab slab;
+    CompressionStats counters; // Without the slab's figures
+
+    // Drop the copies of pages [first, last); caller holds mtx
+    void dropLocked(size_t first, size_t last);
+    size_t pageOf(const void* addr) const { return static_cast<size_t>(static_cast<const char*>(addr) - base) / pageSize; }
+};
+
+#endif // COMPRESSED_PAGES_H
@@ -0,0 +1,46 @@
+#include "compressed_slab.h"
+#include <cstring>
+
+uint8_t* CompressedSlab::slot(size_t cls, uint32_t index) const {
+    size_t perChunk = slotsPerChunk(cls);
+    return classes[cls].chunks[index / perChunk].get() + (index % perChunk) * slotSize(cls);
+}
+
+uint32_t CompressedSlab::store(const uint8_t* data, size_t size) {
+    if (size > MAX_ITEM) return 0;
+    size_t cls = (size + sizeof(uint16_t) + GRANULE - 1) / GRANULE - 1;
+    SizeClass& c = classes[cls];
+    uint32_t index;
+    if (!c.freeSlots.empty()) {
+        index = c.freeSlots.back();
+        c.freeSlots.pop_back();
+    } else {
+        if (c.nextSlot >= FIRST_HANDLE) return 0;
+        index = c.nextSlot++;
+        if (index / slotsPerChunk(cls) == c.chunks.size()) {
+            c.chunks.emplace_back(new uint8_t[CHUNK]);
+            allocated += CHUNK;
+        }
+    }
+    uint8_t* p = slot(cls, index);
+    uint16_t length = static_cast<uint16_t>(size);
+    std::memcpy(p, &length, sizeof length);
+    std::memcpy(p + sizeof length, data, size);
+    stored += size;
+    return static_cast<uint32_t>(cls + 1) << SLOT_BITS | index;
+}
+
+const uint8_t* CompressedSlab::data(uint32_t handle, size_t& size) const {
+    const uint8_t* p = slot((handle >> SLOT_BITS) - 1, handle & (FIRST_HANDLE - 1));
+    uint16_t length;
+    std::memcpy(&length, p, sizeof length);
+    size = length;
+    return p + sizeof length;
+}
+
+void CompressedSlab::erase(uint32_t handle) {
+    size_t size;
+    data(handle, size);
+    stored -= size;
+    classes[(handle >> SLOT_BITS) - 1].freeSlots.push_back(handle & (FIRST_HANDLE - 1));
+}
@@ -0,0 +1,54 @@
+#ifndef COMPRESSED_SLAB_H
+#define COMPRESSED_SLAB_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Compact store for compressed pages. Slots come in size classes GRANULE
+// bytes apart up to MAX_SLOT; each class carves its slots out of CHUNK-byte
+// chunks allocated on demand and reuses freed slots through a free list, so
+// an item wastes less than GRANULE bytes besides its 2-byte length. Handles
+// are 32-bit (class above SLOT_BITS, slot index below) and never below
+// FIRST_HANDLE, leaving small values free for callers' markers.
+// Not thread-safe; callers lock.
+class CompressedSlab {
+public:
+    static constexpr size_t GRANULE = 64;
+    static constexpr size_t MAX_SLOT = 4096;
+    static constexpr size_t MAX_ITEM = MAX_SLOT - sizeof(uint16_t);
+    static constexpr size_t CHUNK = 64 * 1024;
+    static constexpr int SLOT_BITS = 24;
+    static constexpr uint32_t FIRST_HANDLE = uint32_t(1) << SLOT_BITS;
+
+    // Copy size bytes into a free slot; 0 if size exceeds MAX_ITEM or the
+    // class is out of slot indices
+    uint32_t store(const uint8_t* data, size_t size);
+    // The bytes held under handle, and their count
+    const uint8_t* data(uint32_t handle, size_t& size) const;
+    void erase(uint32_t handle);
+
+    size_t storedBytes() const { return stored; }
+    // Memory held by chunks, used or not
+    size_t slabBytes() const { return allocated; }
+
+private:
+    static constexpr size_t NUM_CLASSES = MAX_SLOT / GRANULE;
+
+    struct SizeClass {
+        std::vector<std::unique_ptr<uint8_t[]>> chunks;
+        std::vector<uint32_t> freeSlots;
+        uint32_t nextSlot = 0; // Slots below have been handed out at least once
+    };
+
+    SizeClass classes[NUM_CLASSES];
+    size_t stored = 0;
+    size_t allocated = 0;
+
+    static size_t slotSize(size_t cls) { return (cls + 1) * GRANULE; }
+    static size_t slotsPerChunk(size_t cls) { return CHUNK / slotSize(cls); }
+    uint8_t* slot(size_t cls, uint32_t index) const;
+};
+
+#endif // COMPRESSED_SLAB_H
@@ -0,0 +1,31 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+namespace Cpu {
+    enum class SimdLevel { SCALAR, SSE2, AVX2 };
+
+    // Best instruction set available on this CPU (checked once)
+    inline SimdLevel detectSimdLevel() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        static const SimdLevel level = [] {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+            if (__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+            return SimdLevel::SCALAR;
+        }();
+        return level;
+#else
+        return SimdLevel::SCALAR;
+#endif
+    }
+
+    inline const char* simdLevelName(SimdLevel level) {
+        switch (level) {
+            case SimdLevel::AVX2: return "avx2";
+            case SimdLevel::SSE2: return "sse2";
+            case SimdLevel::SCALAR: default: return "scalar";
+        }
+    }
+}
+
+#endif // CPU_FEATURES_H
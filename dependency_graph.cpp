@@ -0,0 +1,72 @@
+#include "dependency_graph.h"
+#include <algorithm>
+#include <cmath>
+
+DependencyGraph::DependencyGraph(double halfLifeSeconds) : halfLife(halfLifeSeconds) {}
+
+float DependencyGraph::decayFactor(double from, double to) const {
+    if (to <= from || halfLife <= 0.0) return 1.0f;
+    return static_cast<float>(std::exp2(-(to - from) / halfLife));
+}
+
+void DependencyGraph::decayTo(Node& node, double now) const {
+    float factor = decayFactor(node.stamp, now);
+    node.stamp = std::max(node.stamp, now);
+    if (factor == 1.0f) return;
+    for (uint32_t i = 0; i < node.edgeCount; ++i) node.edges[i].weight *= factor;
+    node.totalWeight *= factor;
+}
+
+void DependencyGraph::recordTransition(pid_t prev, pid_t curr, double now) {
+    Node& node = nodes[curr];
+    decayTo(node, now);
+    node.totalWeight += 1.0f;
+    uint32_t weakest = 0;
+    for (uint32_t i = 0; i < node.edgeCount; ++i) {
+        if (node.edges[i].pid == prev) {
+            node.edges[i].weight += 1.0f;
+            return;
+        }
+        if (node.edges[i].weight < node.edges[weakest].weight) weakest = i;
+    }
+    if (node.edgeCount < MAX_FAN_OUT) {
+        node.edges[node.edgeCount++] = {prev, 1.0f};
+        return;
+    }
+    // Full: the weakest predecessor makes room and its weight leaves the total
+    node.totalWeight -= node.edges[weakest].weight;
+    node.edges[weakest] = {prev, 1.0f};
+}
+
+float DependencyGraph::incomingWeight(pid_t pid, double now) const {
+    auto it = nodes.find(pid);
+    if (it == nodes.end()) return 0.0f;
+    return it->second.totalWeight * decayFactor(it->second.stamp, now);
+}
+
+std::vector<DependencyGraph::Edge> DependencyGraph::strongestPredecessors(pid_t pid, size_t k, double now) const {
+    std::vector<Edge> result;
+    auto it = nodes.find(pid);
+    if (it == nodes.end()) return result;
+    const Node& node = it->second;
+    float factor = decayFactor(node.stamp, now);
+    result.assign(node.edges, node.edges + node.edgeCount);
+    for (auto& e : result) e.weight *= factor;
+    size_t n = std::min(k, result.size());
+    std::partial_sort(result.begin(), result.begin() + n, result.end(),
+                      [](const Edge& a, const Edge& b) { return a.weight > b.weight; });
+    result.resize(n);
+    return result;
+}
+
+void DependencyGraph::erase(pid_t pid) {
+    nodes.erase(pid);
+}
+
+void DependencyGraph::restoreNode(pid_t pid, const Edge* edges, size_t count, float totalWeight, double stamp) {
+    Node& node = nodes[pid];
+    node.edgeCount = static_cast<uint32_t>(std::min(count, MAX_FAN_OUT));
+    std::copy(edges, edges + node.edgeCount, node.edges);
+    node.totalWeight = totalWeight;
+    node.stamp = stamp;
+}
@@ -0,0 +1,61 @@
+#ifndef DEPENDENCY_GRAPH_H
+#define DEPENDENCY_GRAPH_H
+
+#include <unordered_map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+using pid_t = int;
+
+// Weighted "focus moved from A to B" graph with bounded memory.
+// Every PID keeps at most MAX_FAN_OUT deduplicated predecessor edges; the
+// weakest edge is evicted when a new predecessor arrives at a full node.
+// Edge weights decay exponentially with a configurable half-life, applied
+// lazily whenever a node is touched, and each node caches its total incoming
+// weight so that scores are O(1).
+class DependencyGraph {
+public:
+    static constexpr size_t MAX_FAN_OUT = 8;
+
+    struct Edge {
+        pid_t pid;    // Predecessor
+        float weight; // Decayed transition count
+    };
+
+    explicit DependencyGraph(double halfLifeSeconds = 600.0);
+
+    // Record a focus transition prev -> curr at time `now` (seconds)
+    void recordTransition(pid_t prev, pid_t curr, double now);
+    // Decayed total weight of all transitions into pid; O(1)
+    float incomingWeight(pid_t pid, double now) const;
+    // Up to k predecessors of pid, strongest first, with decayed weights
+    std::vector<Edge> strongestPredecessors(pid_t pid, size_t k, double now) const;
+    // Forget pid's own predecessor list (edges held by other nodes decay out)
+    void erase(pid_t pid);
+    size_t nodeCount() const { return nodes.size(); }
+    // Visit every node as fn(pid, edges, edgeCount, totalWeight, stamp), with
+    // weights as last decayed (to stamp)
+    template <typename Fn>
+    void forEachNode(Fn&& fn) const {
+        for (const auto& [pid, node] : nodes) fn(pid, node.edges, node.edgeCount, node.totalWeight, node.stamp);
+    }
+    // Replace pid's node with saved state; edges past MAX_FAN_OUT are dropped
+    void restoreNode(pid_t pid, const Edge* edges, size_t count, float totalWeight, double stamp);
+
+private:
+    struct Node {
+        Edge edges[MAX_FAN_OUT];
+        uint32_t edgeCount = 0;
+        float totalWeight = 0.0f;
+        double stamp = 0.0; // Time the weights were last decayed to
+    };
+
+    std::unordered_map<pid_t, Node> nodes;
+    double halfLife;
+
+    float decayFactor(double from, double to) const;
+    void decayTo(Node& node, double now) const;
+};
+
+#endif // DEPENDENCY_GRAPH_H
@@ -0,0 +1,214 @@
+#include "dispatcher.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace {
+    constexpr double NEVER = std::numeric_limits<double>::infinity();
+    // Work left below this counts as done (floating-point slack)
+    constexpr double EPSILON_MS = 1e-9;
+
+    // Nearest-rank percentile of sorted values
+    double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0;
+        size_t rank = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+    double mean(const std::vector<double>& values) {
+        return values.empty() ? 0 : std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    }
+
+    // Run queue heap order: lower priority, then newer, sinks
+    struct QueueOrder {
+        template <typename Q>
+        bool operator()(const Q& a, const Q& b) const {
+            return a.priority < b.priority || (a.priority == b.priority && a.seq > b.seq);
+        }
+    };
+
+    // Slice end heap order: earliest first
+    struct SliceOrder {
+        template <typename S>
+        bool operator()(const S& a, const S& b) const {
+            return a.time > b.time || (a.time == b.time && a.seq > b.seq);
+        }
+    };
+}
+
+Dispatcher::Dispatcher(AdaptiveScheduler& scheduler, const DispatcherConfig& config)
+    : scheduler(scheduler), config(config) {}
+
+DispatchReport Dispatcher::run(const std::vector<DispatchJob>& input) {
+    jobs = &input;
+    size_t n = input.size();
+    state.assign(n, JobState());
+    cpus.assign(std::max(1u, config.cpus), Cpu());
+    sliceEnds.clear();
+    lastCpu.clear();
+    finished.clear();
+    seq = 0;
+    report = DispatchReport();
+    report.jobs = n;
+    report.outcomes.resize(n);
+
+    std::vector<uint32_t> arrivals(n);
+    std::iota(arrivals.begin(), arrivals.end(), 0u);
+    std::stable_sort(arrivals.begin(), arrivals.end(),
+                     [&](uint32_t a, uint32_t b) { return input[a].arrivalMs < input[b].arrivalMs; });
+    for (size_t i = 0; i < n; ++i) state[i].remainingMs = input[i].workMs;
+
+    double now = 0;
+    double nextRefresh = 0;
+    size_t nextArrival = 0;
+    size_t done = 0;
+    while (done < n) {
+        double arrival = nextArrival < n ? input[arrivals[nextArrival]].arrivalMs : NEVER;
+        double sliceEnd = sliceEnds.empty() ? NEVER : sliceEnds.front().time;
+        now = std::max(now, std::min(arrival, sliceEnd));
+        if (config.policy == DispatchPolicy::SCHEDULER && now >= nextRefresh) {
+            refreshDecisions();
+            nextRefresh = now + config.refreshMs;
+        }
+        if (sliceEnd <= arrival) {
+            std::pop_heap(sliceEnds.begin(), sliceEnds.end(), SliceOrder());
+            unsigned c = sliceEnds.back().cpu;
+            sliceEnds.pop_back();
+            uint32_t job = cpus[c].running;
+            endSlice(c);
+            if (state[job].remainingMs <= EPSILON_MS) {
+                const DispatchJob& j = input[job];
+                report.outcomes[job] = JobOutcome{state[job].waitMs, now - j.arrivalMs};
+                if (config.reportOutcomes) {
+                    finished.push_back(SchedulingOutcome{j.process, static_cast<float>(state[job].waitMs),
+                                                         static_cast<float>(j.workMs)});
+                }
+                done++;
+            } else {
+                enqueue(job, c, now);
+            }
+        } else {
+            uint32_t job = arrivals[nextArrival++];
+            auto home = lastCpu.find(input[job].pid);
+            unsigned c = home != lastCpu.end() ? home->second : static_cast<unsigned>(input[job].pid) % cpus.size();
+            enqueue(job, c, now);
+        }
+        dispatchIdle(now);
+    }
+    if (!finished.empty()) {
+        scheduler.reportOutcomes(finished.data(), finished.size());
+        finished.clear();
+    }
+
+    report.makespanMs = now;
+    double busy = 0;
+    for (const Cpu& c : cpus) busy += c.busyMs;
+    if (now > 0) {
+        report.throughput = n / (now / 1000);
+        report.utilization = busy / (now * cpus.size());
+    }
+    std::vector<double> turnaround(n), wait(n);
+    for (size_t i = 0; i < n; ++i) {
+        turnaround[i] = report.outcomes[i].turnaroundMs;
+        wait[i] = report.outcomes[i].waitMs;
+    }
+    report.meanTurnaroundMs = mean(turnaround);
+    report.meanWaitMs = mean(wait);
+    std::sort(turnaround.begin(), turnaround.end());
+    std::sort(wait.begin(), wait.end());
+    report.p50TurnaroundMs = percentile(turnaround, 0.5);
+    report.p99TurnaroundMs = percentile(turnaround, 0.99);
+    report.p50WaitMs = percentile(wait, 0.5);
+    report.p90WaitMs = percentile(wait, 0.9);
+    report.p99WaitMs = percentile(wait, 0.99);
+    report.maxWaitMs = wait.empty() ? 0 : wait.back();
+    jobs = nullptr;
+    return std::move(report);
+}
+
+// Outcomes go to the scheduler first, so a trainer sees them before the
+// decisions that follow
+void Dispatcher::refreshDecisions() {
+    if (!finished.empty()) {
+        scheduler.reportOutcomes(finished.data(), finished.size());
+        finished.clear();
+    }
+    decisions.clear();
+    for (const auto& d : scheduler.calculateProcessPriorities()) decisions.emplace(d.process_id, d);
+    report.refreshes++;
+}
+
+int Dispatcher::priorityOf(pid_t pid) const {
+    if (config.policy == DispatchPolicy::ROUND_ROBIN) return 0;
+    auto it = decisions.find(pid);
+    return it != decisions.end() ? it->second.base_priority : 0;
+}
+
+double Dispatcher::sliceOf(pid_t pid) const {
+    if (config.policy == DispatchPolicy::ROUND_ROBIN) return config.fixedSliceMs;
+    auto it = decisions.find(pid);
+    if (it == decisions.end()) return config.fixedSliceMs;
+    return std::clamp(static_cast<double>(it->second.allocation.ms), config.minSliceMs, config.maxSliceMs);
+}
+
+void Dispatcher::enqueue(uint32_t job, unsigned c, double now) {
+    state[job].enqueuedAt = now;
+    Cpu& cpu = cpus[c];
+    cpu.queue.push_back(Queued{priorityOf((*jobs)[job].pid), seq++, job});
+    std::push_heap(cpu.queue.begin(), cpu.queue.end(), QueueOrder());
+}
+
+bool Dispatcher::pop(Cpu& cpu, uint32_t& job) {
+    if (cpu.queue.empty()) return false;
+    std::pop_heap(cpu.queue.begin(), cpu.queue.end(), QueueOrder());
+    job = cpu.queue.back().job;
+    cpu.queue.pop_back();
+    return true;
+}
+
+// Give every idle CPU its best queued job, or one stolen from the busy CPU
+// with the longest queue
+void Dispatcher::dispatchIdle(double now) {
+    for (unsigned c = 0; c < cpus.size(); ++c) {
+        if (cpus[c].running != NONE) continue;
+        uint32_t job;
+        if (pop(cpus[c], job)) {
+            startSlice(c, job, now);
+            continue;
+        }
+        if (!config.workStealing) continue;
+        Cpu* victim = nullptr;
+        for (Cpu& other : cpus) {
+            if (other.running == NONE || other.queue.empty()) continue;
+            if (!victim || other.queue.size() > victim->queue.size()) victim = &other;
+        }
+        if (victim && pop(*victim, job)) {
+            report.steals++;
+            startSlice(c, job, now);
+        }
+    }
+}
+
+void Dispatcher::startSlice(unsigned c, uint32_t job, double now) {
+    Cpu& cpu = cpus[c];
+    JobState& s = state[job];
+    double start = now;
+    if (cpu.last != job) {
+        report.contextSwitches++;
+        start += config.switchCostMs;
+    }
+    s.waitMs += start - s.enqueuedAt;
+    cpu.running = job;
+    cpu.last = job;
+    cpu.sliceMs = std::min(sliceOf((*jobs)[job].pid), s.remainingMs);
+    lastCpu[(*jobs)[job].pid] = c;
+    sliceEnds.push_back(SliceEnd{start + cpu.sliceMs, seq++, c});
+    std::push_heap(sliceEnds.begin(), sliceEnds.end(), SliceOrder());
+}
+
+void Dispatcher::endSlice(unsigned c) {
+    Cpu& cpu = cpus[c];
+    state[cpu.running].remainingMs -= cpu.sliceMs;
+    cpu.busyMs += cpu.sliceMs;
+    cpu.running = NONE;
+}
@@ -0,0 +1,116 @@
+#ifndef DISPATCHER_H
+#define DISPATCHER_H
+
+#include "adaptive_scheduler.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// One CPU burst: becomes runnable at arrivalMs and needs workMs of CPU
+struct DispatchJob {
+    ProcessHandle process;
+    pid_t pid;
+    double arrivalMs;
+    double workMs;
+};
+
+enum class DispatchPolicy {
+    SCHEDULER,  // Queue by the scheduler's base_priority, run for its TimeSlice
+    ROUND_ROBIN // Baseline: FIFO queues and a fixed slice
+};
+
+struct DispatcherConfig {
+    unsigned cpus = 8;
+    DispatchPolicy policy = DispatchPolicy::SCHEDULER;
+    bool workStealing = true;
+    double switchCostMs = 0.05;  // CPU time lost to each context switch
+    double fixedSliceMs = 10;    // Round robin's slice, and the slice of unscored processes
+    double minSliceMs = 1;       // Scheduler slices are clamped to this range
+    double maxSliceMs = 100;
+    double refreshMs = 100;      // Virtual time between calculateProcessPriorities calls
+    bool reportOutcomes = false; // Pass each finished job's wait and run time to reportOutcomes
+};
+
+// Per job, in input order
+struct JobOutcome {
+    double waitMs;       // Runnable but not running, including switch overhead
+    double turnaroundMs; // Arrival to completion
+};
+
+struct DispatchReport {
+    uint64_t jobs = 0;
+    double makespanMs = 0;       // Virtual time until the last job finished
+    double throughput = 0;       // Jobs per virtual second
+    double utilization = 0;      // Share of CPU time spent running jobs
+    double meanTurnaroundMs = 0, p50TurnaroundMs = 0, p99TurnaroundMs = 0;
+    double meanWaitMs = 0, p50WaitMs = 0, p90WaitMs = 0, p99WaitMs = 0, maxWaitMs = 0;
+    uint64_t contextSwitches = 0; // A CPU starting a different job than it last ran
+    uint64_t steals = 0;          // Jobs an idle CPU took from another's queue
+    uint64_t refreshes = 0;
+    std::vector<JobOutcome> outcomes;
+};
+
+// Executes scheduling decisions on N simulated CPUs in virtual time. Each CPU
+// has its own run queue ordered by base_priority (FIFO among equals); a
+// job arrives on the CPU its process last ran on, runs for at most its
+// TimeSlice, and goes to the back of its priority on the same CPU if
+// unfinished. A CPU with an empty queue steals the best queued job of the
+// CPU with the longest queue. Slices are not preempted. Decisions are read
+// from calculateProcessPriorities every refreshMs of virtual time, so a
+// run is deterministic for a given scheduler state.
+class Dispatcher {
+public:
+    Dispatcher(AdaptiveScheduler& scheduler, const DispatcherConfig& config = DispatcherConfig());
+    // Run every job to completion, starting from virtual time 0
+    DispatchReport run(const std::vector<DispatchJob>& jobs);
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    struct Queued {
+        int priority;
+        uint64_t seq; // Enqueue order: FIFO among equal priorities
+        uint32_t job;
+    };
+    struct Cpu {
+        std::vector<Queued> queue; // Heap: highest priority, then oldest, first
+        uint32_t running = NONE;
+        uint32_t last = NONE;
+        double sliceMs = 0;
+        double busyMs = 0;
+    };
+    struct JobState {
+        double remainingMs;
+        double enqueuedAt;
+        double waitMs = 0;
+    };
+    struct SliceEnd {
+        double time;
+        uint64_t seq;
+        unsigned cpu;
+    };
+
+    AdaptiveScheduler& scheduler;
+    const DispatcherConfig config;
+
+    // State of the current run
+    const std::vector<DispatchJob>* jobs = nullptr;
+    std::vector<JobState> state;
+    std::vector<Cpu> cpus;
+    std::vector<SliceEnd> sliceEnds; // Min-heap by time, then seq
+    std::unordered_map<pid_t, AdaptiveScheduler::SchedulingDecision> decisions;
+    std::unordered_map<pid_t, unsigned> lastCpu;
+    std::vector<SchedulingOutcome> finished; // Not yet reported
+    uint64_t seq = 0;
+    DispatchReport report;
+
+    void refreshDecisions();
+    void enqueue(uint32_t job, unsigned cpu, double now);
+    bool pop(Cpu& cpu, uint32_t& job);
+    void dispatchIdle(double now);
+    void startSlice(unsigned c, uint32_t job, double now);
+    void endSlice(unsigned c);
+    int priorityOf(pid_t pid) const;
+    double sliceOf(pid_t pid) const;
+};
+
+#endif // DISPATCHER_H
@@ -0,0 +1,135 @@
+// dispatcher_bench.cpp
+// End-to-end comparison of scheduling policies on the virtual-time dispatcher
+// (dispatcher.h). A population of interactive processes (short CPU bursts,
+// frequent interaction, IO-heavy) and batch processes (long bursts, CPU-heavy)
+// submits Poisson arrivals sized to a target load. The same jobs run under
+// round robin, under the scheduler's decisions, with and without work
+// stealing, and once more after the online trainer has learned from the
+// scheduler run's outcomes.
+//
+// Usage: dispatcher_bench [--cpus N] [--processes N] [--seconds S] [--load F] [--seed N]
+#include "dispatcher.h"
+#include "event_log.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    constexpr pid_t FIRST_PID = 1000;
+    constexpr int INTERACTIVE_SHARE = 3; // In 10 processes
+    constexpr double INTERACTIVE_WORK_MS = 2, BATCH_WORK_MS = 40;
+    constexpr double INTERACTIVE_RATE_RATIO = 5; // Burst rate of an interactive process over a batch one
+    constexpr int INTERACTIVE_UPDATES = 20, BATCH_UPDATES = 2;
+
+    bool interactive(size_t i) { return i % 10 < INTERACTIVE_SHARE; }
+
+    struct Row {
+        const char* name;
+        DispatchReport report;
+        double hostMs;
+    };
+
+    void print(const Row& row, const std::vector<DispatchJob>& jobs) {
+        const DispatchReport& r = row.report;
+        double sum[2] = {0, 0};
+        size_t count[2] = {0, 0};
+        for (size_t i = 0; i < jobs.size(); ++i) {
+            int c = interactive(static_cast<size_t>(jobs[i].pid - FIRST_PID)) ? 0 : 1;
+            sum[c] += r.outcomes[i].turnaroundMs;
+            count[c]++;
+        }
+        std::cout << std::left << std::setw(24) << row.name << std::right << std::setw(9) << r.throughput
+                  << std::setw(7) << r.utilization * 100 << std::setw(9) << r.meanTurnaroundMs << std::setw(9)
+                  << r.p99TurnaroundMs << std::setw(8) << r.p50WaitMs << std::setw(8) << r.p90WaitMs << std::setw(9)
+                  << r.p99WaitMs << std::setw(9) << r.contextSwitches << std::setw(8) << r.steals << std::setw(9)
+                  << (count[0] ? sum[0] / count[0] : 0) << std::setw(9) << (count[1] ? sum[1] / count[1] : 0)
+                  << std::setw(8) << row.hostMs << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    unsigned cpus = 8;
+    size_t processes = 2000;
+    double seconds = 60;
+    double load = 0.85;
+    uint64_t seed = 42;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--cpus" && i + 1 < argc) cpus = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (arg == "--processes" && i + 1 < argc) processes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else if (arg == "--load" && i + 1 < argc) load = std::atof(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = std::strtoull(argv[++i], nullptr, 10);
+        else {
+            std::cerr << "usage: " << argv[0] << " [--cpus N] [--processes N] [--seconds S] [--load F] [--seed N]\n";
+            return 1;
+        }
+    }
+    if (cpus == 0 || processes == 0 || seconds <= 0 || load <= 0 || load >= 1) return 1;
+    EventLog::instance().setLevel(LogLevel::OFF);
+
+    AdaptiveScheduler scheduler;
+    std::vector<ProcessHandle> handles;
+    size_t interactiveCount = 0;
+    for (size_t i = 0; i < processes; ++i) {
+        pid_t pid = FIRST_PID + static_cast<pid_t>(i);
+        handles.push_back(scheduler.registerProcess(pid, interactive(i) ? "interactive" : "batch"));
+        bool fast = interactive(i);
+        interactiveCount += fast;
+        for (int u = 0; u < (fast ? INTERACTIVE_UPDATES : BATCH_UPDATES); ++u) {
+            scheduler.updateUsageMetrics(handles.back(), {ApplicationEvent::OTHER, 0}, fast ? 10 : 90, fast ? 70 : 5);
+        }
+    }
+
+    // Batch burst rate r per ms such that offered work = load * cpus
+    double demandPerRate = interactiveCount * INTERACTIVE_RATE_RATIO * INTERACTIVE_WORK_MS +
+                           (processes - interactiveCount) * BATCH_WORK_MS;
+    double batchRate = load * cpus / demandPerRate;
+    double horizonMs = seconds * 1000;
+    std::mt19937_64 rng(seed);
+    std::vector<DispatchJob> jobs;
+    for (size_t i = 0; i < processes; ++i) {
+        bool fast = interactive(i);
+        std::exponential_distribution<double> gap(fast ? batchRate * INTERACTIVE_RATE_RATIO : batchRate);
+        std::exponential_distribution<double> work(1.0 / (fast ? INTERACTIVE_WORK_MS : BATCH_WORK_MS));
+        for (double t = gap(rng); t < horizonMs; t += gap(rng)) {
+            jobs.push_back(DispatchJob{handles[i], FIRST_PID + static_cast<pid_t>(i), t, work(rng)});
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(1) << cpus << " CPUs, " << processes << " processes ("
+              << interactiveCount << " interactive), " << jobs.size() << " bursts over " << seconds
+              << " s at load " << std::setprecision(2) << load << std::setprecision(1)
+              << "; times in virtual ms, host ms last\n\n"
+              << std::left << std::setw(24) << "policy" << std::right << std::setw(9) << "jobs/s" << std::setw(7)
+              << "util%" << std::setw(9) << "turn" << std::setw(9) << "turn99" << std::setw(8) << "wait50"
+              << std::setw(8) << "wait90" << std::setw(9) << "wait99" << std::setw(9) << "switches" << std::setw(8)
+              << "steals" << std::setw(9) << "inter" << std::setw(9) << "batch" << std::setw(8) << "host" << "\n";
+
+    auto run = [&](const char* name, DispatchPolicy policy, bool stealing, bool report) {
+        DispatcherConfig config;
+        config.cpus = cpus;
+        config.policy = policy;
+        config.workStealing = stealing;
+        config.reportOutcomes = report;
+        Dispatcher dispatcher(scheduler, config);
+        auto start = std::chrono::steady_clock::now();
+        Row row{name, dispatcher.run(jobs), 0};
+        row.hostMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        print(row, jobs);
+    };
+    run("round robin", DispatchPolicy::ROUND_ROBIN, true, false);
+    run("round robin, no steal", DispatchPolicy::ROUND_ROBIN, false, false);
+    run("scheduler, no steal", DispatchPolicy::SCHEDULER, false, false);
+    run("scheduler", DispatchPolicy::SCHEDULER, true, true);
+    scheduler.trainOnce();
+    ML::TrainerStats t = scheduler.trainingStats();
+    run("scheduler, trained", DispatchPolicy::SCHEDULER, true, false);
+    std::cout << std::setprecision(2) << "\ntrained on " << t.samples << " outcomes, mean slowdown "
+              << t.meanSlowdown << ", model v" << t.version << "\n";
+    return 0;
+}
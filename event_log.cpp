@@ -0,0 +1,170 @@
+#include "event_log.h"
+#include <chrono>
+#include <iostream>
+
+namespace {
+    constexpr auto WRITER_INTERVAL = std::chrono::milliseconds(20);
+
+    uint64_t nowNs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+}
+
+// Owns the calling thread's ring; marks it abandoned on thread exit so the
+// writer can release it once drained
+struct ThreadBufferHandle {
+    std::shared_ptr<EventLog::ThreadBuffer> buffer;
+    ~ThreadBufferHandle() {
+        if (buffer) buffer->abandoned.store(true, std::memory_order_release);
+    }
+};
+
+EventLog& EventLog::instance() {
+    static EventLog log;
+    return log;
+}
+
+EventLog::EventLog() : output(&std::cout) {
+    for (auto& s : sampling) s.store(1, std::memory_order_relaxed);
+    writer = std::thread([this] { writerLoop(); });
+}
+
+EventLog::~EventLog() {
+    {
+        std::lock_guard<std::mutex> lock(writerMtx);
+        stopping = true;
+    }
+    writerCv.notify_all();
+    writer.join();
+}
+
+void EventLog::setSampling(LogEvent event, uint32_t oneInN) {
+    sampling[static_cast<size_t>(event)].store(oneInN == 0 ? 1 : oneInN, std::memory_order_relaxed);
+}
+
+void EventLog::setOutput(std::ostream* out) {
+    std::lock_guard<std::mutex> lock(outputMtx);
+    output = out;
+}
+
+EventLog::ThreadBuffer& EventLog::localBuffer() {
+    thread_local ThreadBufferHandle handle;
+    if (!handle.buffer) {
+        handle.buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(registryMtx);
+        buffers.push_back(handle.buffer);
+    }
+    return *handle.buffer;
+}
+
+void EventLog::enqueue(LogLevel level, LogEvent event, pid_t pid, int64_t a, int64_t b) {
+    ThreadBuffer& buffer = localBuffer();
+    size_t e = static_cast<size_t>(event);
+    uint32_t oneInN = sampling[e].load(std::memory_order_relaxed);
+    if (oneInN > 1 && buffer.sampleCounters[e]++ % oneInN != 0) return;
+    if (!buffer.ring.push({nowNs(), a, b, pid, event, level})) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void EventLog::flush() {
+    std::unique_lock<std::mutex> lock(writerMtx);
+    uint64_t ticket = ++flushRequested;
+    writerCv.notify_all();
+    writerCv.wait(lock, [&] { return flushCompleted >= ticket || stopping; });
+}
+
+void EventLog::writerLoop() {
+    std::string text;
+    std::unique_lock<std::mutex> lock(writerMtx);
+    for (;;) {
+        writerCv.wait_for(lock, WRITER_INTERVAL, [&] { return stopping || flushRequested > flushCompleted; });
+        bool stop = stopping;
+        uint64_t ticket = flushRequested;
+        lock.unlock();
+        // Keep draining until the rings are empty so a flush covers everything before it
+        while (drainAll(text)) {}
+        lock.lock();
+        flushCompleted = ticket;
+        writerCv.notify_all();
+        if (stop) return;
+    }
+}
+
+// Drain every ring in batches and write the formatted text; returns true if
+// anything was drained. The registry is only locked to copy the ring list
+// and to drop abandoned rings, so a thread's first log() never waits on I/O.
+bool EventLog::drainAll(std::string& text) {
+    LogRecord batch[DRAIN_BATCH];
+    bool any = false;
+    {
+        std::lock_guard<std::mutex> lock(registryMtx);
+        draining = buffers;
+    }
+    text.clear();
+    finished.clear();
+    for (const auto& buffer : draining) {
+        // Read the flag before draining so a record pushed just before exit is not lost
+        bool abandoned = buffer->abandoned.load(std::memory_order_acquire);
+        size_t n;
+        while ((n = buffer->ring.popBulk(batch, DRAIN_BATCH)) > 0) {
+            any = true;
+            for (size_t j = 0; j < n; ++j) format(batch[j], text);
+        }
+        if (abandoned) finished.push_back(buffer.get());
+    }
+    draining.clear();
+    if (any) {
+        std::lock_guard<std::mutex> lock(outputMtx);
+        if (output) {
+            output->write(text.data(), static_cast<std::streamsize>(text.size()));
+            output->flush();
+        }
+    }
+    if (!finished.empty()) {
+        std::lock_guard<std::mutex> lock(registryMtx);
+        for (ThreadBuffer* done : finished) {
+            for (size_t i = 0; i < buffers.size(); ++i) {
+                if (buffers[i].get() != done) continue;
+                buffers[i] = std::move(buffers.back());
+                buffers.pop_back();
+                break;
+            }
+        }
+    }
+    return any;
+}
+
+void EventLog::format(const LogRecord& r, std::string& text) {
+    std::string pid = std::to_string(r.pid);
+    switch (r.event) {
+        case LogEvent::DEPENDENCY:
+            text += "Dependency: " + std::to_string(r.a) + " -> " + pid;
+            break;
+        case LogEvent::TIER_ALLOCATION:
+            text += "Allocated " + std::to_string(r.a) + " bytes to PID: " + pid + " in tier " + std::to_string(r.b);
+            break;
+        case LogEvent::ALLOCATION_FAILED:
+            text += "Allocation of " + std::to_string(r.a) + " bytes failed for PID: " + pid + " (all tiers exhausted)";
+            break;
+        case LogEvent::PRE_ALLOCATION:
+            text += "Pre-allocated memory for PID: " + pid;
+            break;
+        case LogEvent::TIER_REBALANCED:
+            text += "Rebalanced tiers: promoted " + std::to_string(r.a) + " bytes, demoted " + std::to_string(r.b) + " bytes";
+            break;
+        case LogEvent::SECURE_ALLOCATION:
+            text += "Allocated secure memory for PID: " + pid;
+            break;
+        case LogEvent::SECURITY_BREACH:
+            text += "SECURITY BREACH! PID: " + pid + ", Severity: " + std::to_string(r.a);
+            break;
+        case LogEvent::SUSPICIOUS_ACTIVITY:
+            text += "Suspicious activity. PID: " + pid + ", Severity: " + std::to_string(r.a);
+            break;
+        default:
+            return;
+    }
+    text += '\n';
+}
@@ -0,0 +1,111 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "spsc_ring.h"
+
+using pid_t = int;
+
+enum class LogLevel : uint8_t { DEBUG, INFO, WARN, ERROR, OFF };
+
+// Structured events emitted by the managers; the text for each is produced
+// only on the writer thread
+enum class LogEvent : uint16_t {
+    DEPENDENCY,           // pid = current, a = previous pid
+    TIER_ALLOCATION,      // a = bytes, b = tier
+    ALLOCATION_FAILED,    // a = bytes
+    PRE_ALLOCATION,       // a = bytes
+    TIER_REBALANCED,      // a = bytes promoted, b = bytes demoted
+    SECURE_ALLOCATION,    // a = bytes
+    SECURITY_BREACH,      // a = severity
+    SUSPICIOUS_ACTIVITY,  // a = severity
+    COUNT
+};
+
+// Fixed-size binary record; formatting is deferred to the writer
+struct LogRecord {
+    uint64_t timestampNs;
+    int64_t a;
+    int64_t b;
+    pid_t pid;
+    LogEvent event;
+    LogLevel level;
+};
+
+// Asynchronous event sink.
+// Each producing thread gets its own lock-free SPSC ring; log() is a level
+// check, a sampling check and a ring push, and never blocks or touches I/O.
+// A background writer thread drains all rings, formats the records and writes
+// them to the output stream in batches. When a ring is full the record is
+// dropped and counted.
+class EventLog {
+public:
+    static EventLog& instance();
+    ~EventLog();
+
+    // Records below this level are discarded at the call site
+    void setLevel(LogLevel level) { minLevel.store(static_cast<uint8_t>(level), std::memory_order_relaxed); }
+    // Keep only one in every oneInN records of this event (1 keeps all)
+    void setSampling(LogEvent event, uint32_t oneInN);
+    // Destination for formatted output (nullptr discards); default std::cout
+    void setOutput(std::ostream* out);
+
+    bool enabled(LogLevel level) const {
+        return static_cast<uint8_t>(level) >= minLevel.load(std::memory_order_relaxed);
+    }
+    void log(LogLevel level, LogEvent event, pid_t pid, int64_t a = 0, int64_t b = 0) {
+        if (enabled(level)) enqueue(level, event, pid, a, b);
+    }
+    // Block until everything logged before this call has been written
+    void flush();
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t RING_CAPACITY = 16384;
+    static constexpr size_t DRAIN_BATCH = 256;
+
+    struct ThreadBuffer {
+        SpscRing<LogRecord> ring{RING_CAPACITY};
+        uint32_t sampleCounters[static_cast<size_t>(LogEvent::COUNT)] = {};
+        std::atomic<bool> abandoned{false}; // Owning thread has exited
+    };
+    friend struct ThreadBufferHandle;
+
+    EventLog();
+    void enqueue(LogLevel level, LogEvent event, pid_t pid, int64_t a, int64_t b);
+    ThreadBuffer& localBuffer();
+    void writerLoop();
+    bool drainAll(std::string& text);
+    static void format(const LogRecord& r, std::string& text);
+
+    std::atomic<uint8_t> minLevel{static_cast<uint8_t>(LogLevel::INFO)};
+    std::atomic<uint32_t> sampling[static_cast<size_t>(LogEvent::COUNT)];
+    std::atomic<uint64_t> dropped{0};
+
+    // Taken by a thread's first log() to register its ring; never held
+    // across draining or I/O
+    std::mutex registryMtx; // Guards buffers
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::mutex outputMtx; // Guards output; held while writing to it
+    std::ostream* output;
+    // Writer thread only: the rings being drained and those to unregister
+    std::vector<std::shared_ptr<ThreadBuffer>> draining;
+    std::vector<ThreadBuffer*> finished;
+
+    std::mutex writerMtx;
+    std::condition_variable writerCv;
+    uint64_t flushRequested = 0;
+    uint64_t flushCompleted = 0;
+    bool stopping = false;
+    std::thread writer;
+};
+
+#endif // EVENT_LOG_H
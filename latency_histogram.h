@@ -0,0 +1,91 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-size log-linear latency histogram (nanoseconds).
+// Each power of two is split into SUB_BUCKETS linear buckets, so any recorded
+// value is reported within ~1/SUB_BUCKETS (6%) of its true value while the
+// whole histogram stays a few KiB regardless of how many samples it holds.
+// record() is O(1) and allocation-free. Not thread-safe; merge per-thread copies.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int MAJOR_BUCKETS = 64 - SUB_BITS + 1;
+    static constexpr size_t NUM_BUCKETS = static_cast<size_t>(MAJOR_BUCKETS) * SUB_BUCKETS;
+
+    void record(uint64_t ns) {
+        counts[bucketOf(ns)]++;
+        total++;
+        sum += ns;
+        maxValue = std::max(maxValue, ns);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < NUM_BUCKETS; ++i) counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        maxValue = std::max(maxValue, other.maxValue);
+    }
+
+    // Fold in samples counted elsewhere with bucketOf(): bucketCounts[i] in
+    // bucket i, summing to sumValues, none above maxSample
+    template <typename Count>
+    void mergeCounts(const Count* bucketCounts, uint64_t sumValues, uint64_t maxSample) {
+        for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+            uint64_t n = bucketCounts[i];
+            counts[i] += n;
+            total += n;
+        }
+        sum += sumValues;
+        maxValue = std::max(maxValue, maxSample);
+    }
+
+    void reset() { *this = LatencyHistogram(); }
+
+    uint64_t count() const { return total; }
+    uint64_t sumNs() const { return sum; }
+    uint64_t max() const { return maxValue; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+
+    // Upper bound of the bucket holding the p-quantile (p in [0, 1])
+    uint64_t percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(p * (total - 1)) + 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(bucketUpper(i), maxValue);
+        }
+        return maxValue;
+    }
+
+    // Values below SUB_BUCKETS map 1:1; above, the top SUB_BITS + 1 bits pick the bucket
+    static size_t bucketOf(uint64_t v) {
+        if (v < SUB_BUCKETS) return static_cast<size_t>(v);
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - SUB_BITS;
+        size_t major = static_cast<size_t>(shift + 1);
+        size_t sub = static_cast<size_t>((v >> shift) & (SUB_BUCKETS - 1));
+        return major * SUB_BUCKETS + sub;
+    }
+
+private:
+    uint64_t counts[NUM_BUCKETS] = {};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t maxValue = 0;
+
+    static uint64_t bucketUpper(size_t index) {
+        size_t major = index / SUB_BUCKETS;
+        uint64_t sub = index % SUB_BUCKETS;
+        if (major == 0) return sub;
+        int shift = static_cast<int>(major) - 1;
+        return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+    }
+};
+
+#endif // LATENCY_HISTOGRAM_H
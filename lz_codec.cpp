@@ -0,0 +1,143 @@
+#include "lz_codec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    constexpr size_t MIN_MATCH = 4;
+    // The last match must start this far from the end, and the last bytes
+    // are always literals; both are LZ4 format rules
+    constexpr size_t MF_LIMIT = 12;
+    constexpr size_t LAST_LITERALS = 5;
+    constexpr int HASH_BITS = 10;
+    constexpr size_t MAX_OFFSET = 65535;
+    // Misses before the search stride grows by one byte
+    constexpr int SKIP_SHIFT = 5;
+
+    uint32_t read32(const uint8_t* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof v);
+        return v;
+    }
+
+    uint32_t hashOf(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    // Extra length bytes after a 4-bit field of 15
+    void writeLength(uint8_t*& op, size_t len) {
+        if (len < 15) return;
+        for (len -= 15; len >= 255; len -= 255) *op++ = 255;
+        *op++ = static_cast<uint8_t>(len);
+    }
+
+    bool readLength(const uint8_t*& ip, const uint8_t* end, size_t& len) {
+        uint8_t b;
+        do {
+            if (ip >= end) return false;
+            b = *ip++;
+            len += b;
+        } while (b == 255);
+        return true;
+    }
+
+    // One sequence: literals, then a match of MIN_MATCH + matchLen bytes at
+    // `offset` back (none for the final sequence). False if it does not fit.
+    bool emit(uint8_t*& op, const uint8_t* oend, const uint8_t* literals, size_t litLen,
+              size_t offset, size_t matchLen, bool last) {
+        size_t worst = 1 + litLen / 255 + 1 + litLen + (last ? 0 : 2 + matchLen / 255 + 1);
+        if (worst > static_cast<size_t>(oend - op)) return false;
+        uint8_t* token = op++;
+        *token = static_cast<uint8_t>(std::min<size_t>(litLen, 15) << 4);
+        writeLength(op, litLen);
+        if (litLen) std::memcpy(op, literals, litLen);
+        op += litLen;
+        if (last) return true;
+        *token |= static_cast<uint8_t>(std::min<size_t>(matchLen, 15));
+        *op++ = static_cast<uint8_t>(offset);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+        writeLength(op, matchLen);
+        return true;
+    }
+}
+
+namespace Compression {
+    size_t compress(const uint8_t* src, size_t n, uint8_t* dst, size_t capacity) {
+        if (n > MAX_INPUT) return 0;
+        const uint8_t* ip = src;
+        const uint8_t* anchor = src;
+        const uint8_t* end = src + n;
+        uint8_t* op = dst;
+        const uint8_t* oend = dst + capacity;
+        if (n > MF_LIMIT) {
+            // Positions fit 16 bits within MAX_INPUT
+            uint16_t table[size_t(1) << HASH_BITS] = {};
+            const uint8_t* matchLimit = end - LAST_LITERALS;
+            const uint8_t* ipLimit = end - MF_LIMIT;
+            int misses = 0;
+            for (++ip; ip <= ipLimit;) {
+                uint32_t sequence = read32(ip);
+                uint32_t h = hashOf(sequence);
+                const uint8_t* ref = src + table[h];
+                table[h] = static_cast<uint16_t>(ip - src);
+                if (ref >= ip || static_cast<size_t>(ip - ref) > MAX_OFFSET || read32(ref) != sequence) {
+                    ip += 1 + (misses++ >> SKIP_SHIFT);
+                    continue;
+                }
+                misses = 0;
+                while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                    --ip;
+                    --ref;
+                }
+                const uint8_t* matchEnd = ip + MIN_MATCH;
+                const uint8_t* refEnd = ref + MIN_MATCH;
+                while (matchEnd < matchLimit && *matchEnd == *refEnd) {
+                    ++matchEnd;
+                    ++refEnd;
+                }
+                if (!emit(op, oend, anchor, static_cast<size_t>(ip - anchor), static_cast<size_t>(ip - ref),
+                          static_cast<size_t>(matchEnd - ip) - MIN_MATCH, false)) {
+                    return 0;
+                }
+                ip = anchor = matchEnd;
+            }
+        }
+        if (!emit(op, oend, anchor, static_cast<size_t>(end - anchor), 0, 0, true)) return 0;
+        return static_cast<size_t>(op - dst);
+    }
+
+    bool decompress(const uint8_t* src, size_t n, uint8_t* dst, size_t size) {
+        const uint8_t* ip = src;
+        const uint8_t* iend = src + n;
+        uint8_t* op = dst;
+        uint8_t* oend = dst + size;
+        while (ip < iend) {
+            uint8_t token = *ip++;
+            size_t litLen = token >> 4;
+            if (litLen == 15 && !readLength(ip, iend, litLen)) return false;
+            if (litLen > static_cast<size_t>(iend - ip) || litLen > static_cast<size_t>(oend - op)) return false;
+            if (litLen) std::memcpy(op, ip, litLen);
+            ip += litLen;
+            op += litLen;
+            if (ip == iend) break; // The final sequence has no match
+            if (iend - ip < 2) return false;
+            size_t offset = ip[0] | size_t(ip[1]) << 8;
+            ip += 2;
+            size_t len = token & 15;
+            if (len == 15 && !readLength(ip, iend, len)) return false;
+            len += MIN_MATCH;
+            if (offset == 0 || offset > static_cast<size_t>(op - dst) || len > static_cast<size_t>(oend - op)) {
+                return false;
+            }
+            // An overlapping match repeats the last `offset` bytes; each copy
+            // doubles the stretch that can be copied in one go
+            for (size_t period = offset; len > 0;) {
+                size_t chunk = std::min(period, len);
+                std::memcpy(op, op - period, chunk);
+                op += chunk;
+                len -= chunk;
+                period += chunk;
+            }
+        }
+        return op == oend;
+    }
+}
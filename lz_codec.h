@@ -0,0 +1,22 @@
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Compression {
+    // Largest input compress() accepts: the format's 16-bit match window
+    constexpr size_t MAX_INPUT = 64 * 1024;
+
+    // LZ4 block format compressor: greedy matching over a small hash table of
+    // 4-byte sequences, skipping ahead faster through incompressible data.
+    // Returns the compressed size, or 0 if it would exceed `capacity` (the
+    // data is not worth storing compressed) or n > MAX_INPUT.
+    size_t compress(const uint8_t* src, size_t n, uint8_t* dst, size_t capacity);
+
+    // Decode an LZ4 block that expands to exactly `size` bytes. Every read
+    // and write is bounds-checked; false on malformed input.
+    bool decompress(const uint8_t* src, size_t n, uint8_t* dst, size_t size);
+}
+
+#endif // LZ_CODEC_H
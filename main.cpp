@@ -1,18 +1,29 @@
 #include "adaptive_scheduler.h"
 #include "adaptive_memory_manager.h"
 #include "security_memory_manager.h"
+#include "event_log.h"
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 int main() {
     AdaptiveScheduler scheduler;
     AdaptiveMemoryManager memManager;
     SecurityMemoryManager secManager;
     
-    // Simulate process usage
+    // Register two processes with every module
     pid_t pid1 = 1001, pid2 = 1002;
+    for (pid_t pid : {pid1, pid2}) {
+        scheduler.registerProcess(pid, "app_" + std::to_string(pid));
+        memManager.registerProcess(pid);
+        secManager.registerProcess(pid);
+    }
+
+    // Simulate process usage
     ApplicationEvent evt{ApplicationEvent::FOCUS_CHANGE, pid1};
     scheduler.updateUsageMetrics(pid2, evt);
     auto decisions = scheduler.calculateProcessPriorities();
+    EventLog::instance().flush();
     std::cout << "\nProcess Scheduling Decisions:\n";
     for (const auto& d : decisions) {
         std::cout << "PID: " << d.process_id << ", Priority: " << d.base_priority
@@ -28,8 +39,24 @@ int main() {
     auto region = secManager.allocateSecureMemory(pid1, 2048, SecurityLevel::HIGH);
     secManager.monitorMemoryAccess();
     bool access = secManager.validateMemoryAccess(pid1, region.address, region.size, AccessType::READ);
+    EventLog::instance().flush();
     std::cout << "\nMemory access for PID " << pid1 << (access ? ": allowed" : ": denied") << std::endl;
 
+    // HIGH regions are handed out encrypted; the validated access above
+    // decrypted the zeroed memory for the owner
+    std::vector<uint8_t> pattern(region.size);
+    bool zeroed = std::memcmp(region.address, pattern.data(), pattern.size()) == 0;
+
+    // Encrypt the owner's data at rest and decrypt it back unchanged
+    for (size_t i = 0; i < pattern.size(); ++i) pattern[i] = static_cast<uint8_t>(i * 31 + 7);
+    std::memcpy(region.address, pattern.data(), pattern.size());
+    bool encrypted = secManager.encryptMemory(pid1, region.address) &&
+                     std::memcmp(region.address, pattern.data(), pattern.size()) != 0;
+    bool roundTrip = zeroed && encrypted && secManager.decryptMemory(pid1, region.address) &&
+                     std::memcmp(region.address, pattern.data(), pattern.size()) == 0;
+    std::cout << "Encryption round trip: " << (roundTrip ? "ok" : "FAILED") << std::endl;
+    if (!roundTrip) return 1;
+
     std::cout << "\nDemo completed. All modules operational.\n";
     return 0;
 }
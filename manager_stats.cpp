@@ -0,0 +1,174 @@
+#include "manager_stats.h"
+#include <sstream>
+#include <vector>
+
+#ifdef MANAGER_STATS_TSC
+namespace {
+    struct Epoch {
+        uint64_t ticks;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    const Epoch& epoch() {
+        static const Epoch e{Stats::now(), std::chrono::steady_clock::now()};
+        return e;
+    }
+}
+#endif
+
+double Stats::nsPerTick() {
+#ifdef MANAGER_STATS_TSC
+    const Epoch& e = epoch();
+    const auto minimum = std::chrono::milliseconds(10);
+    while (std::chrono::steady_clock::now() - e.time < minimum) {
+    }
+    uint64_t ticks = Stats::now() - e.ticks;
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - e.time).count();
+    return ticks ? ns / ticks : 1.0;
+#else
+    return 1.0;
+#endif
+}
+
+#if MANAGER_STATS
+
+namespace {
+    // Metric names and label values as Prometheus wants them
+    void writeLabels(std::ostream& out, const char* manager, const char* method, const char* quantile) {
+        out << "{manager=\"" << manager << "\"";
+        if (method) out << ",method=\"" << method << "\"";
+        if (quantile) out << ",quantile=\"" << quantile << "\"";
+        out << "}";
+    }
+
+    void writeSummary(std::ostream& out, const char* name, const char* manager, const char* method,
+                      const LatencyHistogram& h, double ns) {
+        static const double QUANTILES[] = {0.5, 0.99, 0.999};
+        static const char* const QUANTILE_NAMES[] = {"0.5", "0.99", "0.999"};
+        for (size_t q = 0; q < 3; ++q) {
+            out << name;
+            writeLabels(out, manager, method, QUANTILE_NAMES[q]);
+            out << " " << h.percentile(QUANTILES[q]) * ns << "\n";
+        }
+        out << name << "_sum";
+        writeLabels(out, manager, method, nullptr);
+        out << " " << h.sumNs() * ns << "\n" << name << "_count";
+        writeLabels(out, manager, method, nullptr);
+        out << " " << h.count() << "\n";
+    }
+
+    void writeJsonLatency(std::ostream& out, const LatencyHistogram& h, double ns) {
+        out << "\"count\": " << h.count() << ", \"mean_ns\": " << h.mean() * ns
+            << ", \"p50_ns\": " << h.percentile(0.5) * ns << ", \"p99_ns\": " << h.percentile(0.99) * ns
+            << ", \"p999_ns\": " << h.percentile(0.999) * ns << ", \"max_ns\": " << h.max() * ns;
+    }
+
+    std::atomic<uint64_t> nextStatsId{1};
+
+    // Blocks this thread used last, by ManagerStats id
+    constexpr size_t CACHE_WAYS = 4;
+    struct CachedBlock {
+        uint64_t id;
+        CounterHistogram* block;
+    };
+    thread_local CachedBlock blockCache[CACHE_WAYS];
+    thread_local size_t blockCacheNext;
+}
+
+ManagerStats::ManagerStats(const char* manager, const char* const* methodNames, size_t methodCount)
+    : manager(manager), methodNames(methodNames), methodCount(methodCount),
+      id(nextStatsId.fetch_add(1, std::memory_order_relaxed)) {
+#ifdef MANAGER_STATS_TSC
+    epoch(); // Start the tick calibration early
+#endif
+}
+
+CounterHistogram* ManagerStats::threadBlock() {
+    for (const CachedBlock& c : blockCache) {
+        if (c.id == id) return c.block;
+    }
+    CounterHistogram* block = createThreadBlock();
+    blockCache[blockCacheNext++ % CACHE_WAYS] = CachedBlock{id, block};
+    return block;
+}
+
+CounterHistogram* ManagerStats::createThreadBlock() {
+    // A thread id may be reused once its thread has exited; the block carries on
+    std::lock_guard<std::mutex> lock(blocksMtx);
+    auto& block = blocks[std::this_thread::get_id()];
+    if (!block) block.reset(new CounterHistogram[methodCount]);
+    return block.get();
+}
+
+std::string ManagerStats::snapshot(StatsFormat format) {
+    double ns = Stats::nsPerTick();
+    std::vector<LatencyHistogram> methods(methodCount);
+    size_t threads;
+    {
+        std::lock_guard<std::mutex> lock(blocksMtx);
+        threads = blocks.size();
+        for (const auto& entry : blocks) {
+            for (size_t m = 0; m < methodCount; ++m) entry.second[m].addTo(methods[m]);
+        }
+    }
+    LatencyHistogram wait, hold;
+    lockCounters.wait.addTo(wait);
+    lockCounters.hold.addTo(hold);
+    uint64_t acquisitions = lockCounters.acquisitions.load(std::memory_order_relaxed);
+    uint64_t contended = lockCounters.contended.load(std::memory_order_relaxed);
+
+    std::ostringstream out;
+    out.precision(1);
+    out << std::fixed;
+    if (format == StatsFormat::JSON) {
+        out << "{\"manager\": \"" << manager << "\", \"enabled\": " << (enabled() ? "true" : "false")
+            << ", \"threads\": " << threads << ", \"methods\": {";
+        bool first = true;
+        for (size_t m = 0; m < methodCount; ++m) {
+            if (methods[m].count() == 0) continue;
+            out << (first ? "" : ", ") << "\"" << methodNames[m] << "\": {";
+            writeJsonLatency(out, methods[m], ns);
+            out << "}";
+            first = false;
+        }
+        out << "}, \"lock\": {\"acquisitions\": " << acquisitions << ", \"contended\": " << contended
+            << ", \"wait_ns\": " << wait.sumNs() * ns << ", \"hold_ns\": " << hold.sumNs() * ns << ", \"wait\": {";
+        writeJsonLatency(out, wait, ns);
+        out << "}, \"hold\": {";
+        writeJsonLatency(out, hold, ns);
+        out << "}}}";
+        return out.str();
+    }
+
+    std::string prefix = std::string("osproj_") + manager;
+    std::string latency = prefix + "_method_latency_ns";
+    out << "# HELP " << latency << " Latency of " << manager << " manager calls\n"
+        << "# TYPE " << latency << " summary\n";
+    for (size_t m = 0; m < methodCount; ++m) {
+        if (methods[m].count()) writeSummary(out, latency.c_str(), manager, methodNames[m], methods[m], ns);
+    }
+    std::string lockName = prefix + "_lock";
+    out << "# TYPE " << lockName << "_acquisitions_total counter\n" << lockName << "_acquisitions_total";
+    writeLabels(out, manager, nullptr, nullptr);
+    out << " " << acquisitions << "\n# TYPE " << lockName << "_contended_total counter\n"
+        << lockName << "_contended_total";
+    writeLabels(out, manager, nullptr, nullptr);
+    out << " " << contended << "\n# HELP " << lockName << "_wait_ns Wait for the manager mutex when contended\n"
+        << "# TYPE " << lockName << "_wait_ns summary\n";
+    writeSummary(out, (lockName + "_wait_ns").c_str(), manager, nullptr, wait, ns);
+    out << "# HELP " << lockName << "_hold_ns Time the manager mutex is held\n"
+        << "# TYPE " << lockName << "_hold_ns summary\n";
+    writeSummary(out, (lockName + "_hold_ns").c_str(), manager, nullptr, hold, ns);
+    return out.str();
+}
+
+#else
+
+std::string ManagerStats::snapshot(StatsFormat format) {
+    if (format == StatsFormat::JSON) {
+        return std::string("{\"manager\": \"") + manager + "\", \"enabled\": false, \"compiled_out\": true}";
+    }
+    return std::string("# ") + manager + " manager statistics compiled out (MANAGER_STATS=0)\n";
+}
+
+#endif // MANAGER_STATS
@@ -0,0 +1,199 @@
+#ifndef MANAGER_STATS_H
+#define MANAGER_STATS_H
+
+#include "cache_line.h"
+#include "latency_histogram.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Hot-path instrumentation of the three managers: a latency histogram per
+// public method and thread, and wait and hold times of each manager's mtx.
+// Timing reads the TSC on x86 (steady_clock elsewhere); counts are written
+// by one thread each with plain relaxed stores and only summed when read.
+// Build with -DMANAGER_STATS=0 (in every translation unit) to compile it all
+// out: timers and the mutex wrapper become empty, and snapshots say so.
+#ifndef MANAGER_STATS
+#define MANAGER_STATS 1
+#endif
+
+#if MANAGER_STATS && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MANAGER_STATS_TSC 1
+#include <x86intrin.h>
+#endif
+
+enum class StatsFormat { JSON, PROMETHEUS };
+
+namespace Stats {
+    // Timestamp in ticks (TSC cycles, or nanoseconds without a TSC)
+    inline uint64_t now() {
+#ifdef MANAGER_STATS_TSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+    // Tick length, measured against steady_clock since the first call (at
+    // least 10 ms, spinning if need be)
+    double nsPerTick();
+}
+
+// LatencyHistogram's buckets as counters written by a single thread and
+// readable from any
+class alignas(CACHE_LINE_SIZE) CounterHistogram {
+public:
+    void record(uint64_t ticks) {
+        bump(counts[LatencyHistogram::bucketOf(ticks)], 1);
+        bump(sum, ticks);
+        if (ticks > max.load(std::memory_order_relaxed)) max.store(ticks, std::memory_order_relaxed);
+    }
+    void addTo(LatencyHistogram& h) const {
+        h.mergeCounts(counts, sum.load(std::memory_order_relaxed), max.load(std::memory_order_relaxed));
+    }
+
+private:
+    std::atomic<uint64_t> counts[LatencyHistogram::NUM_BUCKETS] = {};
+    std::atomic<uint64_t> sum{0}, max{0};
+
+    // Single writer: no read-modify-write needed
+    static void bump(std::atomic<uint64_t>& c, uint64_t n) {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+#if MANAGER_STATS
+
+// Statistics of one manager. Each thread records into its own block, found
+// through a small thread-local cache; blocks are only summed by snapshot().
+class ManagerStats {
+public:
+    // methodNames must outlive the stats
+    ManagerStats(const char* manager, const char* const* methodNames, size_t methodCount);
+    ManagerStats(const ManagerStats&) = delete;
+    ManagerStats& operator=(const ManagerStats&) = delete;
+
+    void setEnabled(bool on) { active.store(on, std::memory_order_relaxed); }
+    bool enabled() const { return active.load(std::memory_order_relaxed); }
+    // This thread's histogram of a method
+    CounterHistogram& method(size_t index) { return threadBlock()[index]; }
+    // Lock counters, written by the holder of the manager's mtx
+    struct alignas(CACHE_LINE_SIZE) LockCounters {
+        std::atomic<uint64_t> acquisitions{0}, contended{0};
+        CounterHistogram wait; // Contended acquisitions only
+        CounterHistogram hold;
+    };
+    LockCounters& lock() { return lockCounters; }
+    // Everything so far, in nanoseconds
+    std::string snapshot(StatsFormat format);
+
+private:
+    const char* const manager;
+    const char* const* const methodNames;
+    const size_t methodCount;
+    const uint64_t id; // Unique per instance, so a stale thread cache never matches
+    std::atomic<bool> active{true};
+    LockCounters lockCounters;
+    std::mutex blocksMtx; // Guards blocks
+    std::unordered_map<std::thread::id, std::unique_ptr<CounterHistogram[]>> blocks;
+
+    CounterHistogram* threadBlock();
+    CounterHistogram* createThreadBlock();
+};
+
+// Times a call from construction to destruction into a method's histogram
+class ScopedTimer {
+public:
+    ScopedTimer(ManagerStats& stats, size_t method) : stats(stats), method(method) {
+        if (stats.enabled()) start = Stats::now();
+    }
+    ~ScopedTimer() {
+        if (start) stats.method(method).record(Stats::now() - start);
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    ManagerStats& stats;
+    const size_t method;
+    uint64_t start = 0;
+};
+
+// std::mutex that counts acquisitions, the wait of contended ones and every
+// hold into its manager's LockCounters. The counters are updated while held.
+class StatsMutex {
+public:
+    explicit StatsMutex(ManagerStats& stats) : counters(stats.lock()), stats(stats) {}
+    void lock() {
+        uint64_t waited = 0;
+        if (!m.try_lock()) {
+            uint64_t t0 = Stats::now();
+            m.lock();
+            waited = Stats::now() - t0;
+        }
+        acquired(waited);
+    }
+    bool try_lock() {
+        if (!m.try_lock()) return false;
+        acquired(0);
+        return true;
+    }
+    void unlock() {
+        if (heldSince) counters.hold.record(Stats::now() - heldSince);
+        m.unlock();
+    }
+
+private:
+    std::mutex m;
+    ManagerStats::LockCounters& counters;
+    ManagerStats& stats;
+    uint64_t heldSince = 0; // Written by the holder only
+
+    void acquired(uint64_t waited) {
+        if (!stats.enabled()) {
+            heldSince = 0;
+            return;
+        }
+        heldSince = Stats::now();
+        counters.acquisitions.store(counters.acquisitions.load(std::memory_order_relaxed) + 1,
+                                    std::memory_order_relaxed);
+        if (waited) {
+            counters.contended.store(counters.contended.load(std::memory_order_relaxed) + 1,
+                                     std::memory_order_relaxed);
+            counters.wait.record(waited);
+        }
+    }
+};
+
+#else
+
+class ManagerStats {
+public:
+    ManagerStats(const char* manager, const char*const*, size_t) : manager(manager) {}
+    void setEnabled(bool) {}
+    bool enabled() const { return false; }
+    std::string snapshot(StatsFormat format);
+
+private:
+    const char* const manager;
+};
+
+class ScopedTimer {
+public:
+    ScopedTimer(ManagerStats&, size_t) {}
+};
+
+class StatsMutex : public std::mutex {
+public:
+    explicit StatsMutex(ManagerStats&) {}
+};
+
+#endif // MANAGER_STATS
+
+#endif // MANAGER_STATS_H
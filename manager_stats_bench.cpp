@@ -0,0 +1,141 @@
+// manager_stats_bench.cpp
+// Cost of the managers' built-in instrumentation (manager_stats.h): a bare
+// ScopedTimer, and cheap manager calls with statistics enabled and disabled
+// at runtime. Build with -DMANAGER_STATS=0 for the compiled-out baseline.
+// Then runs the calls on several threads and prints the resulting snapshot.
+//
+// Usage: manager_stats_bench [--calls N] [--threads N] [--prometheus]
+#include "adaptive_scheduler.h"
+#include "adaptive_memory_manager.h"
+#include "security_memory_manager.h"
+#include "event_log.h"
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr pid_t FIRST_PID = 1000;
+    constexpr int PROCESSES = 64;
+
+    template <typename Fn>
+    double nsPerCall(size_t calls, Fn&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < calls; ++i) fn(i);
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / calls;
+    }
+
+    // Best of three, to keep scheduler noise out of small differences
+    template <typename Fn>
+    double bestNsPerCall(size_t calls, Fn&& fn) {
+        double best = nsPerCall(calls, fn);
+        for (int r = 1; r < 3; ++r) best = std::min(best, nsPerCall(calls, fn));
+        return best;
+    }
+
+    struct Managers {
+        std::shared_ptr<ProcessTable> table = std::make_shared<ProcessTable>();
+        AdaptiveScheduler scheduler{table};
+        AdaptiveMemoryManager memory{table, SlowTierMode::MEMORY};
+        SecurityMemoryManager security{table};
+        std::vector<ProcessHandle> handles;
+        int probe = 0; // Address outside any secure region
+
+        Managers() {
+            for (int i = 0; i < PROCESSES; ++i) {
+                handles.push_back(scheduler.registerProcess(FIRST_PID + i, "bench"));
+                memory.registerProcess(FIRST_PID + i);
+                security.registerProcess(FIRST_PID + i);
+            }
+        }
+        void setEnabled(bool on) {
+            scheduler.setStatsEnabled(on);
+            memory.setStatsEnabled(on);
+            security.setStatsEnabled(on);
+        }
+    };
+
+    void runCalls(Managers& m, size_t calls, size_t offset) {
+        for (size_t i = 0; i < calls; ++i) {
+            ProcessHandle h = m.handles[(i + offset) % PROCESSES];
+            auto type = i % 64 == 0 ? ApplicationEvent::FOCUS_CHANGE : ApplicationEvent::OTHER;
+            m.scheduler.updateUsageMetrics(h, {type, FIRST_PID}, int(i % 100), 0);
+            m.security.validateMemoryAccess(FIRST_PID, &m.probe, sizeof m.probe, AccessType::READ);
+            if (i % 1024 == 0) m.scheduler.topK(3);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t calls = 2000000;
+    unsigned threads = 4;
+    bool prometheus = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--prometheus") prometheus = true;
+        else if (arg == "--calls" && i + 1 < argc) calls = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--threads" && i + 1 < argc) threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        else {
+            std::cerr << "usage: " << argv[0] << " [--calls N] [--threads N] [--prometheus]\n";
+            return 1;
+        }
+    }
+    if (calls == 0 || threads == 0) return 1;
+    EventLog::instance().setLevel(LogLevel::OFF);
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "statistics: " << (MANAGER_STATS ? "compiled in" : "compiled out (MANAGER_STATS=0)") << "\n\n";
+
+    static const char* const NAMES[] = {"call"};
+    ManagerStats stats("bench", NAMES, 1);
+    volatile size_t sink = 0;
+    double bare = bestNsPerCall(calls, [&](size_t i) { sink = sink + i; });
+    double timed = bestNsPerCall(calls, [&](size_t i) {
+        ScopedTimer timer(stats, 0);
+        sink = sink + i;
+    });
+    stats.setEnabled(false);
+    double idle = bestNsPerCall(calls, [&](size_t i) {
+        ScopedTimer timer(stats, 0);
+        sink = sink + i;
+    });
+    std::cout << "ScopedTimer: " << timed - bare << " ns enabled, " << idle - bare << " ns disabled\n";
+
+    Managers m;
+    struct Call {
+        const char* name;
+        std::function<void(size_t)> fn;
+    };
+    std::vector<Call> cheap = {
+        {"updateUsageMetrics", [&](size_t i) {
+             m.scheduler.updateUsageMetrics(m.handles[i % PROCESSES], {ApplicationEvent::OTHER, 0}, 1, 1);
+         }},
+        {"validateMemoryAccess", [&](size_t) {
+             m.security.validateMemoryAccess(FIRST_PID, &m.probe, sizeof m.probe, AccessType::READ);
+         }},
+        {"getStrongestPredecessors", [&](size_t) { m.scheduler.getStrongestPredecessors(FIRST_PID, 1); }},
+    };
+    std::cout << "\n" << std::left << std::setw(26) << "call" << std::right << std::setw(12) << "disabled ns"
+              << std::setw(12) << "enabled ns" << std::setw(10) << "delta" << "\n";
+    for (const Call& c : cheap) {
+        m.setEnabled(false);
+        double off = bestNsPerCall(calls, c.fn);
+        m.setEnabled(true);
+        double on = bestNsPerCall(calls, c.fn);
+        std::cout << std::left << std::setw(26) << c.name << std::right << std::setw(12) << off << std::setw(12) << on
+                  << std::setw(10) << on - off << "\n";
+    }
+
+    // A fresh set of managers, driven from several threads, then read back
+    Managers shared;
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) workers.emplace_back([&, t] { runCalls(shared, calls / threads, t * 7); });
+    for (auto& w : workers) w.join();
+    StatsFormat format = prometheus ? StatsFormat::PROMETHEUS : StatsFormat::JSON;
+    std::cout << "\n" << threads << " threads:\n" << shared.scheduler.statsSnapshot(format) << "\n"
+              << shared.security.statsSnapshot(format) << "\n";
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include "memory_cipher.h"
+#include <random>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRYPTO_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace Crypto {
+
+namespace {
+    constexpr uint32_t SIGMA[4] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574}; // "expand 32-byte k"
+    constexpr size_t BLOCK = 64;
+
+    inline uint32_t rotl(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+    inline void quarterRound(uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d) {
+        a += b; d = rotl(d ^ a, 16);
+        c += d; b = rotl(b ^ c, 12);
+        a += b; d = rotl(d ^ a, 8);
+        c += d; b = rotl(b ^ c, 7);
+    }
+
+    void initState(uint32_t state[16], const Key& key, uint32_t counter, const Nonce& nonce) {
+        std::memcpy(state, SIGMA, sizeof(SIGMA));
+        std::memcpy(state + 4, key.words, sizeof(key.words));
+        state[12] = counter;
+        std::memcpy(state + 13, nonce.words, sizeof(nonce.words));
+    }
+
+    void blockWords(const uint32_t state[16], uint32_t out[16]) {
+        uint32_t x[16];
+        std::memcpy(x, state, sizeof(x));
+        for (int i = 0; i < 10; ++i) {
+            quarterRound(x[0], x[4], x[8], x[12]);
+            quarterRound(x[1], x[5], x[9], x[13]);
+            quarterRound(x[2], x[6], x[10], x[14]);
+            quarterRound(x[3], x[7], x[11], x[15]);
+            quarterRound(x[0], x[5], x[10], x[15]);
+            quarterRound(x[1], x[6], x[11], x[12]);
+            quarterRound(x[2], x[7], x[8], x[13]);
+            quarterRound(x[3], x[4], x[9], x[14]);
+        }
+        for (int i = 0; i < 16; ++i) out[i] = x[i] + state[i];
+    }
+
+    // Handles whatever the vector kernels leave over; advances state[12]
+    void xorScalar(uint8_t* data, size_t len, uint32_t state[16]) {
+        uint32_t words[16];
+        uint8_t stream[BLOCK];
+        while (len > 0) {
+            blockWords(state, words);
+            for (int i = 0; i < 16; ++i) {
+                // Keystream bytes are little-endian words
+                stream[4 * i] = static_cast<uint8_t>(words[i]);
+                stream[4 * i + 1] = static_cast<uint8_t>(words[i] >> 8);
+                stream[4 * i + 2] = static_cast<uint8_t>(words[i] >> 16);
+                stream[4 * i + 3] = static_cast<uint8_t>(words[i] >> 24);
+            }
+            size_t n = len < BLOCK ? len : BLOCK;
+            for (size_t i = 0; i < n; ++i) data[i] ^= stream[i];
+            data += n;
+            len -= n;
+            state[12]++;
+        }
+    }
+
+#ifdef CRYPTO_X86_SIMD
+    // The vector kernels keep one state word per register with one block per
+    // lane, run the rounds on all lanes at once, then transpose back to bytes.
+
+#define CHACHA_ROTL128(v, n) _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+#define CHACHA_QR128(a, b, c, d) \
+    a = _mm_add_epi32(a, b); d = CHACHA_ROTL128(_mm_xor_si128(d, a), 16); \
+    c = _mm_add_epi32(c, d); b = CHACHA_ROTL128(_mm_xor_si128(b, c), 12); \
+    a = _mm_add_epi32(a, b); d = CHACHA_ROTL128(_mm_xor_si128(d, a), 8);  \
+    c = _mm_add_epi32(c, d); b = CHACHA_ROTL128(_mm_xor_si128(b, c), 7)
+
+    __attribute__((target("sse2")))
+    void transpose4(__m128i& a, __m128i& b, __m128i& c, __m128i& d) {
+        __m128i t0 = _mm_unpacklo_epi32(a, b), t1 = _mm_unpacklo_epi32(c, d);
+        __m128i t2 = _mm_unpackhi_epi32(a, b), t3 = _mm_unpackhi_epi32(c, d);
+        a = _mm_unpacklo_epi64(t0, t1);
+        b = _mm_unpackhi_epi64(t0, t1);
+        c = _mm_unpacklo_epi64(t2, t3);
+        d = _mm_unpackhi_epi64(t2, t3);
+    }
+
+    __attribute__((target("sse2")))
+    size_t xorSSE2(uint8_t* data, size_t len, uint32_t state[16]) {
+        const size_t step = 4 * BLOCK;
+        size_t done = 0;
+        for (; len - done >= step; done += step) {
+            __m128i s[16], x[16];
+            for (int i = 0; i < 16; ++i) s[i] = _mm_set1_epi32(static_cast<int>(state[i]));
+            s[12] = _mm_add_epi32(s[12], _mm_set_epi32(3, 2, 1, 0));
+            for (int i = 0; i < 16; ++i) x[i] = s[i];
+            for (int r = 0; r < 10; ++r) {
+                CHACHA_QR128(x[0], x[4], x[8], x[12]);
+                CHACHA_QR128(x[1], x[5], x[9], x[13]);
+                CHACHA_QR128(x[2], x[6], x[10], x[14]);
+                CHACHA_QR128(x[3], x[7], x[11], x[15]);
+                CHACHA_QR128(x[0], x[5], x[10], x[15]);
+                CHACHA_QR128(x[1], x[6], x[11], x[12]);
+                CHACHA_QR128(x[2], x[7], x[8], x[13]);
+                CHACHA_QR128(x[3], x[4], x[9], x[14]);
+            }
+            for (int i = 0; i < 16; ++i) x[i] = _mm_add_epi32(x[i], s[i]);
+            for (int g = 0; g < 4; ++g) transpose4(x[4 * g], x[4 * g + 1], x[4 * g + 2], x[4 * g + 3]);
+            // x[4g + b] now holds words 4g..4g+3 of block b
+            uint8_t* out = data + done;
+            for (int b = 0; b < 4; ++b) {
+                for (int g = 0; g < 4; ++g) {
+                    auto p = reinterpret_cast<__m128i*>(out + b * BLOCK + g * 16);
+                    _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), x[4 * g + b]));
+                }
+            }
+            state[12] += 4;
+        }
+        return done;
+    }
+
+#define CHACHA_ROTL256(v, n) _mm256_or_si256(_mm256_slli_epi32(v, n), _mm256_srli_epi32(v, 32 - (n)))
+#define CHACHA_QR256(a, b, c, d) \
+    a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot16); \
+    c = _mm256_add_epi32(c, d); b = CHACHA_ROTL256(_mm256_xor_si256(b, c), 12);         \
+    a = _mm256_add_epi32(a, b); d = _mm256_shuffle_epi8(_mm256_xor_si256(d, a), rot8);  \
+    c = _mm256_add_epi32(c, d); b = CHACHA_ROTL256(_mm256_xor_si256(b, c), 7)
+
+    __attribute__((target("avx2")))
+    void transpose4x2(__m256i& a, __m256i& b, __m256i& c, __m256i& d) {
+        __m256i t0 = _mm256_unpacklo_epi32(a, b), t1 = _mm256_unpacklo_epi32(c, d);
+        __m256i t2 = _mm256_unpackhi_epi32(a, b), t3 = _mm256_unpackhi_epi32(c, d);
+        a = _mm256_unpacklo_epi64(t0, t1);
+        b = _mm256_unpackhi_epi64(t0, t1);
+        c = _mm256_unpacklo_epi64(t2, t3);
+        d = _mm256_unpackhi_epi64(t2, t3);
+    }
+
+    __attribute__((target("avx2")))
+    size_t xorAVX2(uint8_t* data, size_t len, uint32_t state[16]) {
+        const size_t step = 8 * BLOCK;
+        const __m256i rot16 = _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+                                              13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2);
+        const __m256i rot8 = _mm256_set_epi8(14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3,
+                                             14, 13, 12, 15, 10, 9, 8, 11, 6, 5, 4, 7, 2, 1, 0, 3);
+        size_t done = 0;
+        for (; len - done >= step; done += step) {
+            __m256i s[16], x[16];
+            for (int i = 0; i < 16; ++i) s[i] = _mm256_set1_epi32(static_cast<int>(state[i]));
+            s[12] = _mm256_add_epi32(s[12], _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+            for (int i = 0; i < 16; ++i) x[i] = s[i];
+            for (int r = 0; r < 10; ++r) {
+                CHACHA_QR256(x[0], x[4], x[8], x[12]);
+                CHACHA_QR256(x[1], x[5], x[9], x[13]);
+                CHACHA_QR256(x[2], x[6], x[10], x[14]);
+                CHACHA_QR256(x[3], x[7], x[11], x[15]);
+                CHACHA_QR256(x[0], x[5], x[10], x[15]);
+                CHACHA_QR256(x[1], x[6], x[11], x[12]);
+                CHACHA_QR256(x[2], x[7], x[8], x[13]);
+                CHACHA_QR256(x[3], x[4], x[9], x[14]);
+            }
+            for (int i = 0; i < 16; ++i) x[i] = _mm256_add_epi32(x[i], s[i]);
+            for (int g = 0; g < 4; ++g) transpose4x2(x[4 * g], x[4 * g + 1], x[4 * g + 2], x[4 * g + 3]);
+            // x[4g + b] holds words 4g..4g+3 of block b (low lane) and block b+4 (high lane)
+            uint8_t* out = data + done;
+            for (int b = 0; b < 4; ++b) {
+                __m256i lo01 = _mm256_permute2x128_si256(x[b], x[4 + b], 0x20);
+                __m256i lo23 = _mm256_permute2x128_si256(x[8 + b], x[12 + b], 0x20);
+                __m256i hi01 = _mm256_permute2x128_si256(x[b], x[4 + b], 0x31);
+                __m256i hi23 = _mm256_permute2x128_si256(x[8 + b], x[12 + b], 0x31);
+                const __m256i streams[4] = {lo01, lo23, hi01, hi23};
+                uint8_t* blocks[4] = {out + b * BLOCK, out + b * BLOCK + 32,
+                                      out + (b + 4) * BLOCK, out + (b + 4) * BLOCK + 32};
+                for (int k = 0; k < 4; ++k) {
+                    auto p = reinterpret_cast<__m256i*>(blocks[k]);
+                    _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), streams[k]));
+                }
+            }
+            state[12] += 8;
+        }
+        return done;
+    }
+#endif
+}
+
+void chacha20Block(const Key& key, uint32_t counter, const Nonce& nonce, uint8_t out[64]) {
+    std::memset(out, 0, BLOCK);
+    uint32_t state[16];
+    initState(state, key, counter, nonce);
+    xorScalar(out, BLOCK, state);
+}
+
+void chacha20Xor(uint8_t* data, size_t len, const Key& key, const Nonce& nonce, uint32_t counter) {
+    chacha20Xor(data, len, key, nonce, counter, Cpu::detectSimdLevel());
+}
+
+void chacha20Xor(uint8_t* data, size_t len, const Key& key, const Nonce& nonce, uint32_t counter,
+                 Cpu::SimdLevel level) {
+    uint32_t state[16];
+    initState(state, key, counter, nonce);
+    if (level > Cpu::detectSimdLevel()) level = Cpu::detectSimdLevel();
+    size_t done = 0;
+    switch (level) {
+#ifdef CRYPTO_X86_SIMD
+        case Cpu::SimdLevel::AVX2:
+            done = xorAVX2(data, len, state);
+            done += xorSSE2(data + done, len - done, state);
+            break;
+        case Cpu::SimdLevel::SSE2:
+            done = xorSSE2(data, len, state);
+            break;
+#endif
+        default:
+            break;
+    }
+    xorScalar(data + done, len - done, state);
+}
+
+Key randomKey() {
+    std::random_device rd;
+    Key key;
+    for (auto& w : key.words) w = rd();
+    return key;
+}
+
+} // namespace Crypto
@@ -0,0 +1,31 @@
+#ifndef MEMORY_CIPHER_H
+#define MEMORY_CIPHER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "cpu_features.h"
+
+namespace Crypto {
+    struct Key {
+        uint32_t words[8];
+    };
+    struct Nonce {
+        uint32_t words[3];
+    };
+
+    // ChaCha20 (RFC 8439) keystream block for (key, counter, nonce)
+    void chacha20Block(const Key& key, uint32_t counter, const Nonce& nonce, uint8_t out[64]);
+
+    // XOR len bytes at data with the ChaCha20 keystream starting at block
+    // `counter`; encryption and decryption are the same operation. Uses the
+    // widest kernel the CPU supports: 8 blocks per step with AVX2, 4 with SSE2.
+    void chacha20Xor(uint8_t* data, size_t len, const Key& key, const Nonce& nonce, uint32_t counter = 0);
+    // Same, forcing a specific kernel (falls back if unsupported)
+    void chacha20Xor(uint8_t* data, size_t len, const Key& key, const Nonce& nonce, uint32_t counter,
+                     Cpu::SimdLevel level);
+
+    // Fresh key from the system's random device
+    Key randomKey();
+}
+
+#endif // MEMORY_CIPHER_H
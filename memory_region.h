@@ -0,0 +1,24 @@
+#ifndef MEMORY_REGION_H
+#define MEMORY_REGION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+using pid_t = int;
+
+// Shared by the memory and security managers so both can be used in one program
+enum class SecurityLevel { LOW, MEDIUM, HIGH };
+
+enum class AccessType : uint8_t { READ, WRITE, EXECUTE };
+
+struct MemoryRegion {
+    pid_t pid = 0;
+    size_t size = 0;
+    std::time_t allocTime = 0;
+    SecurityLevel secLevel = SecurityLevel::LOW;
+    void* address = nullptr;
+    uint64_t keyId = 0; // Nonce of the encryption covering the contents (0 = plaintext)
+};
+
+#endif // MEMORY_REGION_H
@@ -0,0 +1,200 @@
+#include "online_model.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ML {
+
+namespace {
+    // Smoothing of the mean slowdown and the loss once past their warm-up
+    constexpr double EWMA_ALPHA = 0.01;
+    constexpr float MIN_RATIO = 0.5f, MAX_RATIO = 2.0f;
+    constexpr float MIN_PERFORMANCE = 0.5f;
+    // Run times below this count as this, so slowdowns stay finite
+    constexpr float MIN_RUN_MS = 1.0f;
+
+    // Each thread starts probing the reader slots at its own offset
+    size_t readerHint() {
+        static std::atomic<size_t> nextHint{0};
+        thread_local size_t hint = nextHint.fetch_add(1, std::memory_order_relaxed);
+        return hint;
+    }
+
+    float score(const PredictionModel& model, const float* features) {
+        float s = model.bias;
+        for (int f = 0; f < NUM_FEATURES; ++f) s += model.weights[f] * features[f];
+        return s;
+    }
+}
+
+ModelPublisher::ModelPublisher(const ModelVersion& initial) : current(new ModelVersion(initial)) {}
+
+ModelPublisher::~ModelPublisher() {
+    delete current.load();
+    for (auto& r : retired) delete r.second;
+}
+
+// The slot is pinned with the epoch before the pointer is loaded, both
+// sequentially consistent: a publisher that then finds the slot empty
+// swapped the pointer first, so this reader loads the new version.
+ModelPublisher::Reader ModelPublisher::read() {
+    for (size_t i = readerHint(), probes = 0;; ++i, ++probes) {
+        if (probes == MAX_READERS) {
+            std::this_thread::yield();
+            probes = 0;
+        }
+        std::atomic<uint64_t>& slot = readers[i % MAX_READERS].epoch;
+        uint64_t idle = 0;
+        if (slot.compare_exchange_strong(idle, epoch.load())) return Reader(&slot, current.load());
+    }
+}
+
+uint64_t ModelPublisher::publish(const ModelVersion& next) {
+    std::lock_guard<std::mutex> lock(publishMtx);
+    ModelVersion* version = new ModelVersion(next);
+    version->version = nextVersion++;
+    const ModelVersion* old = current.exchange(version);
+    // Readers pinned at this epoch or before may still hold old
+    retired.emplace_back(epoch.fetch_add(1), old);
+    reclaim();
+    return version->version;
+}
+
+void ModelPublisher::reclaim() {
+    uint64_t oldestPinned = UINT64_MAX;
+    for (const ReaderSlot& r : readers) {
+        uint64_t e = r.epoch.load();
+        if (e != 0) oldestPinned = std::min(oldestPinned, e);
+    }
+    auto freed = std::remove_if(retired.begin(), retired.end(), [&](const std::pair<uint64_t, const ModelVersion*>& r) {
+        if (r.first >= oldestPinned) return false;
+        delete r.second;
+        return true;
+    });
+    retired.erase(freed, retired.end());
+}
+
+OnlineTrainer::OnlineTrainer(ModelPublisher& publisher, const TrainerConfig& config)
+    : publisher(publisher), config(config), baseline(publisher.read()->model) {}
+
+OnlineTrainer::~OnlineTrainer() {
+    stop();
+}
+
+size_t OnlineTrainer::submit(const TrainingSample* samples, size_t count) {
+    std::lock_guard<std::mutex> lock(queueMtx);
+    size_t accepted = std::min(count, config.maxPending - std::min(config.maxPending, pending.size()));
+    pending.insert(pending.end(), samples, samples + accepted);
+    dropped += count - accepted;
+    return accepted;
+}
+
+void OnlineTrainer::start(std::chrono::milliseconds interval) {
+    stop();
+    std::lock_guard<std::mutex> lock(threadMtx);
+    stopping = false;
+    thread = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(threadMtx);
+        while (!threadCv.wait_for(lock, interval, [&] { return stopping; })) {
+            lock.unlock();
+            trainOnce();
+            lock.lock();
+        }
+    });
+}
+
+void OnlineTrainer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(threadMtx);
+        if (!thread.joinable()) return;
+        stopping = true;
+    }
+    threadCv.notify_all();
+    thread.join();
+}
+
+TrainerStats OnlineTrainer::stats() {
+    std::lock_guard<std::mutex> trainLock(trainMtx);
+    TrainerStats s = counters;
+    std::lock_guard<std::mutex> queueLock(queueMtx);
+    s.dropped = dropped;
+    return s;
+}
+
+// 1 / standard deviation of feature f; 0 while it has not varied
+float OnlineTrainer::scale(int f) const {
+    if (counters.samples < 2) return 0;
+    double sd = std::sqrt(m2[f] / double(counters.samples - 1));
+    return sd > 1e-6 ? static_cast<float>(1.0 / sd) : 0.0f;
+}
+
+size_t OnlineTrainer::trainOnce() {
+    std::lock_guard<std::mutex> lock(trainMtx);
+    {
+        std::lock_guard<std::mutex> queueLock(queueMtx);
+        batch.swap(pending);
+    }
+    size_t trained = batch.size();
+    if (trained == 0) return 0;
+    {
+        // Training continues from the version the samples were most likely scored with
+        ModelPublisher::Reader model = publisher.read();
+        for (const TrainingSample& s : batch) {
+            uint64_t n = ++counters.samples;
+            for (int f = 0; f < NUM_FEATURES; ++f) {
+                double delta = s.features[f] - mean[f];
+                mean[f] += delta / double(n);
+                m2[f] += delta * (s.features[f] - mean[f]);
+            }
+            double slowdown = (s.waitMs + std::max(s.runMs, MIN_RUN_MS)) / std::max(s.runMs, MIN_RUN_MS);
+            counters.meanSlowdown += (slowdown - counters.meanSlowdown) * std::max(EWMA_ALPHA, 1.0 / double(n));
+            if (n < config.minSamples) continue;
+            if (!initialised) {
+                // Continue from the published model: w_raw = w_std * scale
+                float raw = model->model.bias;
+                for (int f = 0; f < NUM_FEATURES; ++f) {
+                    float k = scale(f);
+                    weights[f] = k > 0 ? model->model.weights[f] / k : 0.0f;
+                    raw += model->model.weights[f] * static_cast<float>(mean[f]);
+                }
+                bias = raw;
+                initialised = true;
+            }
+            float ratio = std::clamp(static_cast<float>(slowdown / counters.meanSlowdown), MIN_RATIO, MAX_RATIO);
+            float target = std::clamp(score(baseline, s.features) * ratio, 0.0f, config.maxImportance);
+            float z[NUM_FEATURES];
+            float y = bias;
+            float norm = 1; // The bias input
+            for (int f = 0; f < NUM_FEATURES; ++f) {
+                z[f] = (s.features[f] - static_cast<float>(mean[f])) * scale(f);
+                y += weights[f] * z[f];
+                norm += z[f] * z[f];
+            }
+            float err = y - target;
+            counters.loss += (double(err) * err - counters.loss) * EWMA_ALPHA;
+            // Normalised step: drifting features (interaction counts only
+            // grow) can stand far outside the running spread
+            float step = config.learningRate / norm;
+            for (int f = 0; f < NUM_FEATURES; ++f) {
+                weights[f] -= step * (err * z[f] + config.l2 * weights[f]);
+            }
+            bias -= step * err;
+        }
+    }
+    batch.clear();
+    if (!initialised) return trained;
+
+    // Fold the standardisation into raw-feature weights
+    ModelVersion next;
+    next.model.bias = bias;
+    for (int f = 0; f < NUM_FEATURES; ++f) {
+        next.model.weights[f] = weights[f] * scale(f);
+        next.model.bias -= next.model.weights[f] * static_cast<float>(mean[f]);
+    }
+    next.performanceFactor = std::clamp(static_cast<float>(config.targetSlowdown / counters.meanSlowdown),
+                                        MIN_PERFORMANCE, 1.0f);
+    counters.version = publisher.publish(next);
+    counters.published++;
+    return trained;
+}
+
+}
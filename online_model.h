@@ -0,0 +1,161 @@
+#ifndef ONLINE_MODEL_H
+#define ONLINE_MODEL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "cache_line.h"
+#include "prediction_model.h"
+
+namespace ML {
+    // A model as handed to the scoring path; never modified once published
+    struct ModelVersion {
+        PredictionModel model;
+        // Scales time slices: 1 while outcomes meet the slowdown target,
+        // down to 0.5 as the system falls behind it
+        float performanceFactor = 1.0f;
+        uint64_t version = 0; // 0: the built-in default model
+    };
+
+    // Holds the current ModelVersion for readers that never block. publish()
+    // swaps in a new version through an atomic pointer; the old one is freed
+    // once no reader that could have loaded it is still pinned (epoch-based
+    // reclamation). Readers pin one of MAX_READERS slots with a CAS and spin
+    // only if every slot is taken at once.
+    class ModelPublisher {
+    public:
+        static constexpr size_t MAX_READERS = 64;
+
+        explicit ModelPublisher(const ModelVersion& initial = ModelVersion());
+        ~ModelPublisher();
+        ModelPublisher(const ModelPublisher&) = delete;
+        ModelPublisher& operator=(const ModelPublisher&) = delete;
+
+        // Pins the version current at construction until destroyed
+        class Reader {
+        public:
+            Reader(Reader&& other) noexcept : slot(other.slot), current(other.current) { other.slot = nullptr; }
+            Reader(const Reader&) = delete;
+            Reader& operator=(const Reader&) = delete;
+            ~Reader() {
+                if (slot) slot->store(0, std::memory_order_release);
+            }
+            const ModelVersion& operator*() const { return *current; }
+            const ModelVersion* operator->() const { return current; }
+
+        private:
+            friend class ModelPublisher;
+            Reader(std::atomic<uint64_t>* slot, const ModelVersion* current) : slot(slot), current(current) {}
+            std::atomic<uint64_t>* slot;
+            const ModelVersion* current;
+        };
+
+        Reader read();
+        // Publish a copy of next (its version is overwritten with the next
+        // number) and free the versions no reader can still see
+        uint64_t publish(const ModelVersion& next);
+
+    private:
+        struct alignas(CACHE_LINE_SIZE) ReaderSlot {
+            std::atomic<uint64_t> epoch{0}; // 0: not reading
+        };
+        std::atomic<const ModelVersion*> current;
+        std::atomic<uint64_t> epoch{1};
+        ReaderSlot readers[MAX_READERS];
+
+        std::mutex publishMtx; // Serialises publishers; guards everything below
+        std::vector<std::pair<uint64_t, const ModelVersion*>> retired; // With the epoch they were replaced in
+        uint64_t nextVersion = 1;
+
+        void reclaim();
+    };
+
+    // Knobs of the online trainer
+    struct TrainerConfig {
+        float learningRate = 0.01f;
+        float l2 = 1e-4f;
+        size_t minSamples = 256;      // Samples seen before the first publication
+        size_t maxPending = 1 << 16;  // Samples queued between passes; more are dropped
+        float targetSlowdown = 2.0f;  // (wait + run) / run considered on target
+        float maxImportance = 100.0f; // Training targets are clamped to [0, maxImportance]
+    };
+
+    // One scheduling outcome: the features the process was scored with, how
+    // long it waited for the CPU and how long it then ran
+    struct TrainingSample {
+        float features[NUM_FEATURES];
+        float waitMs;
+        float runMs;
+    };
+
+    struct TrainerStats {
+        uint64_t samples = 0;  // Trained on
+        uint64_t dropped = 0;  // Rejected by a full queue
+        uint64_t published = 0;
+        uint64_t version = 0;  // Currently published
+        double meanSlowdown = 1;
+        double loss = 0;       // Moving average of the squared training error
+    };
+
+    // Learns the scheduler's linear importance model online. Each sample's
+    // target is the importance the publisher's initial model gives it, scaled
+    // by how its slowdown compares with the mean (clamped to 0.5..2):
+    // processes that waited long relative to their run time should have
+    // ranked higher, which favours short interactive bursts the way
+    // shortest-job-first does. Features are standardised with running means
+    // and variances and fitted by normalised SGD with L2 decay; published
+    // weights fold the scaling back in, so the batch scoring kernels apply
+    // them to raw features.
+    // submit() only appends to a queue under a short lock; training runs on
+    // the background thread (or trainOnce()) and publishes through publisher.
+    class OnlineTrainer {
+    public:
+        OnlineTrainer(ModelPublisher& publisher, const TrainerConfig& config = TrainerConfig());
+        ~OnlineTrainer();
+        OnlineTrainer(const OnlineTrainer&) = delete;
+        OnlineTrainer& operator=(const OnlineTrainer&) = delete;
+
+        // Queue samples; returns how many were accepted
+        size_t submit(const TrainingSample* samples, size_t count);
+        // Train every interval on a background thread until stop() or destruction
+        void start(std::chrono::milliseconds interval);
+        void stop();
+        // Train on the queued samples on the calling thread; returns how many
+        size_t trainOnce();
+        TrainerStats stats();
+
+    private:
+        ModelPublisher& publisher;
+        const TrainerConfig config;
+        const PredictionModel baseline; // Targets are scaled from its scores
+
+        std::mutex queueMtx; // Guards pending and dropped
+        std::vector<TrainingSample> pending;
+        uint64_t dropped = 0;
+
+        std::mutex trainMtx; // Serialises passes; guards everything below
+        std::vector<TrainingSample> batch;
+        double mean[NUM_FEATURES] = {};
+        double m2[NUM_FEATURES] = {}; // Sum of squared deviations (Welford)
+        // On standardised features; taken from the published model once
+        // minSamples have given the means and variances to convert it with
+        float weights[NUM_FEATURES] = {};
+        float bias = 0;
+        bool initialised = false;
+        TrainerStats counters;
+
+        std::mutex threadMtx; // Guards the thread's lifetime
+        std::condition_variable threadCv;
+        bool stopping = false;
+        std::thread thread;
+
+        float scale(int f) const;
+    };
+}
+
+#endif // ONLINE_MODEL_H
@@ -0,0 +1,127 @@
+// online_model_bench.cpp
+// The scheduler's online priority model (online_model.h): the cost of
+// pinning the published model, and topK latency while a producer feeds
+// usage updates and outcomes, with the trainer off and then publishing every
+// interval. Outcomes are synthetic: IO-heavy processes run in short bursts
+// and wait as long as the rest, so their slowdown is higher and the learned
+// IO weight should turn positive.
+//
+// Usage: online_model_bench [--processes N] [--seconds S] [--interval MS]
+#include "adaptive_scheduler.h"
+#include "event_log.h"
+#include "latency_histogram.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr pid_t FIRST_PID = 1000;
+    constexpr size_t UPDATE_BATCH = 256;
+    constexpr size_t TOP_K = 10;
+
+    struct Phase {
+        LatencyHistogram topK;
+        uint64_t outcomes = 0;
+    };
+
+    int ioOf(size_t i) { return static_cast<int>(i % 101); }
+
+    Phase run(AdaptiveScheduler& scheduler, const std::vector<ProcessHandle>& handles, double seconds) {
+        Phase phase;
+        std::atomic<bool> done{false};
+        std::thread producer([&] {
+            std::mt19937 rng(7);
+            std::uniform_int_distribution<size_t> pick(0, handles.size() - 1);
+            std::vector<UsageUpdate> updates(UPDATE_BATCH);
+            std::vector<SchedulingOutcome> outcomes(UPDATE_BATCH);
+            while (!done.load(std::memory_order_relaxed)) {
+                for (size_t j = 0; j < UPDATE_BATCH; ++j) {
+                    size_t i = pick(rng);
+                    int io = ioOf(i);
+                    updates[j] = UsageUpdate{handles[i], {ApplicationEvent::OTHER, 0}, 100 - io, io};
+                    // 20 ms waits for everyone; runs from 10 ms down to 1 ms with IO
+                    outcomes[j] = SchedulingOutcome{handles[i], 20.0f, 10.0f - 9.0f * io / 100};
+                }
+                scheduler.updateUsageMetricsBatch(updates.data(), updates.size());
+                scheduler.reportOutcomes(outcomes.data(), outcomes.size());
+                phase.outcomes += UPDATE_BATCH;
+                std::this_thread::yield();
+            }
+        });
+        auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+        while (std::chrono::steady_clock::now() < end) {
+            auto start = std::chrono::steady_clock::now();
+            scheduler.topK(TOP_K);
+            phase.topK.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+            std::this_thread::yield();
+        }
+        done = true;
+        producer.join();
+        return phase;
+    }
+
+    void report(const char* name, const Phase& p) {
+        std::cout << std::left << std::setw(10) << name << std::right << std::setw(10) << p.topK.count()
+                  << std::setw(10) << p.topK.percentile(0.5) / 1000.0 << std::setw(10)
+                  << p.topK.percentile(0.99) / 1000.0 << std::setw(12) << p.topK.max() / 1000.0 << std::setw(12)
+                  << p.outcomes << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t processes = 20000;
+    double seconds = 3;
+    int intervalMs = 100;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--processes" && i + 1 < argc) processes = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else if (arg == "--interval" && i + 1 < argc) intervalMs = std::atoi(argv[++i]);
+        else {
+            std::cerr << "usage: " << argv[0] << " [--processes N] [--seconds S] [--interval MS]\n";
+            return 1;
+        }
+    }
+    if (processes == 0 || seconds <= 0 || intervalMs <= 0) return 1;
+    EventLog::instance().setLevel(LogLevel::OFF);
+    std::cout << std::fixed << std::setprecision(2);
+
+    ML::ModelPublisher publisher;
+    const size_t pins = 10000000;
+    auto start = std::chrono::steady_clock::now();
+    volatile float sink = 0;
+    for (size_t i = 0; i < pins; ++i) sink = sink + publisher.read()->performanceFactor;
+    std::cout << "pin + read + unpin: "
+              << std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / pins
+              << " ns\n\n";
+
+    AdaptiveScheduler scheduler;
+    std::vector<ProcessHandle> handles;
+    for (size_t i = 0; i < processes; ++i) handles.push_back(scheduler.registerProcess(FIRST_PID + pid_t(i), "bench"));
+    scheduler.topK(TOP_K); // Give every process a feature row
+
+    std::cout << processes << " processes, topK(" << TOP_K << ") latency in us\n"
+              << std::left << std::setw(10) << "training" << std::right << std::setw(10) << "calls" << std::setw(10)
+              << "p50" << std::setw(10) << "p99" << std::setw(12) << "max" << std::setw(12) << "outcomes" << "\n";
+    report("off", run(scheduler, handles, seconds / 2));
+    scheduler.startTraining(std::chrono::milliseconds(intervalMs));
+    report("on", run(scheduler, handles, seconds / 2));
+    scheduler.stopTraining();
+
+    ML::TrainerStats t = scheduler.trainingStats();
+    ML::ModelVersion model = scheduler.currentModel();
+    std::cout << "\ntrained on " << t.samples << " outcomes (" << t.dropped << " dropped), " << t.published
+              << " versions published, mean slowdown " << t.meanSlowdown << ", loss " << t.loss
+              << "\nmodel v" << model.version << ": bias " << model.model.bias;
+    static const char* const FEATURES[] = {"interactions", "recency", "dependency", "time of day", "cpu", "io"};
+    for (int f = 0; f < ML::NUM_FEATURES; ++f) std::cout << ", " << FEATURES[f] << " " << model.model.weights[f];
+    std::cout << std::setprecision(3) << "\nperformance factor " << model.performanceFactor << "\n";
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "prediction_model.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ML_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace ML {
+
+size_t FeatureMatrix::addRow(pid_t pid) {
+    for (auto& column : columns) column.push_back(0.0f);
+    pids.push_back(pid);
+    return pids.size() - 1;
+}
+
+pid_t FeatureMatrix::removeRow(size_t row) {
+    size_t last = pids.size() - 1;
+    pid_t moved = -1;
+    if (row != last) {
+        for (auto& column : columns) column[row] = column[last];
+        pids[row] = pids[last];
+        moved = pids[row];
+    }
+    for (auto& column : columns) column.pop_back();
+    pids.pop_back();
+    return moved;
+}
+
+namespace {
+    // Columns with a non-zero weight; zero-weighted columns are never read
+    struct ActiveColumns {
+        const float* data[NUM_FEATURES];
+        float weight[NUM_FEATURES];
+        int count = 0;
+    };
+
+    ActiveColumns activeColumns(const PredictionModel& model, const FeatureMatrix& features) {
+        ActiveColumns active;
+        for (int f = 0; f < NUM_FEATURES; ++f) {
+            if (model.weights[f] == 0.0f) continue;
+            active.data[active.count] = features.column(static_cast<Feature>(f));
+            active.weight[active.count] = model.weights[f];
+            active.count++;
+        }
+        return active;
+    }
+
+    void scoreScalar(const ActiveColumns& active, float bias, size_t begin, size_t end, float* out) {
+        for (size_t i = begin; i < end; ++i) out[i] = bias;
+        for (int c = 0; c < active.count; ++c) {
+            const float* col = active.data[c];
+            float w = active.weight[c];
+            for (size_t i = begin; i < end; ++i) out[i] += w * col[i];
+        }
+    }
+
+#ifdef ML_X86_SIMD
+    __attribute__((target("sse2")))
+    void scoreSSE2(const ActiveColumns& active, float bias, size_t rows, float* out) {
+        size_t vecEnd = rows & ~size_t(3);
+        __m128 b = _mm_set1_ps(bias);
+        for (size_t i = 0; i < vecEnd; i += 4) _mm_storeu_ps(out + i, b);
+        for (int c = 0; c < active.count; ++c) {
+            const float* col = active.data[c];
+            __m128 w = _mm_set1_ps(active.weight[c]);
+            for (size_t i = 0; i < vecEnd; i += 4) {
+                __m128 acc = _mm_loadu_ps(out + i);
+                _mm_storeu_ps(out + i, _mm_add_ps(acc, _mm_mul_ps(w, _mm_loadu_ps(col + i))));
+            }
+        }
+        scoreScalar(active, bias, vecEnd, rows, out);
+    }
+
+    __attribute__((target("avx2,fma")))
+    void scoreAVX2(const ActiveColumns& active, float bias, size_t rows, float* out) {
+        // One pass over the rows: accumulate every column in registers, store once
+        size_t vecEnd = rows & ~size_t(7);
+        __m256 b = _mm256_set1_ps(bias);
+        __m256 w[NUM_FEATURES];
+        for (int c = 0; c < active.count; ++c) w[c] = _mm256_set1_ps(active.weight[c]);
+        for (size_t i = 0; i < vecEnd; i += 8) {
+            __m256 acc = b;
+            for (int c = 0; c < active.count; ++c) {
+                acc = _mm256_fmadd_ps(w[c], _mm256_loadu_ps(active.data[c] + i), acc);
+            }
+            _mm256_storeu_ps(out + i, acc);
+        }
+        scoreScalar(active, bias, vecEnd, rows, out);
+    }
+#endif
+}
+
+float PredictionModel::predict(const std::vector<float>& features) const {
+    float score = bias;
+    for (size_t f = 0; f < features.size() && f < NUM_FEATURES; ++f) score += weights[f] * features[f];
+    return score;
+}
+
+float PredictionModel::predictRow(const FeatureMatrix& features, size_t row) const {
+    float score = bias;
+    for (int f = 0; f < NUM_FEATURES; ++f) score += weights[f] * features.columns[f][row];
+    return score;
+}
+
+void PredictionModel::predictBatch(const FeatureMatrix& features, float* out) const {
+    predictBatch(features, out, detectSimdLevel());
+}
+
+void PredictionModel::predictBatch(const FeatureMatrix& features, float* out, SimdLevel level) const {
+    ActiveColumns active = activeColumns(*this, features);
+    size_t rows = features.rows();
+    if (level > detectSimdLevel()) level = detectSimdLevel();
+    switch (level) {
+#ifdef ML_X86_SIMD
+        case SimdLevel::AVX2: scoreAVX2(active, bias, rows, out); return;
+        case SimdLevel::SSE2: scoreSSE2(active, bias, rows, out); return;
+#endif
+        default: scoreScalar(active, bias, 0, rows, out); return;
+    }
+}
+
+} // namespace ML
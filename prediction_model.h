@@ -0,0 +1,47 @@
+#ifndef PREDICTION_MODEL_H
+#define PREDICTION_MODEL_H
+
+#include <vector>
+#include <cstddef>
+#include "cpu_features.h"
+
+using pid_t = int;
+
+namespace ML {
+    // Scheduler features, one contiguous column each (structure of arrays)
+    enum Feature { INTERACTION_COUNT, RECENCY, DEPENDENCY, TIME_OF_DAY, CPU_USAGE, IO_USAGE, NUM_FEATURES };
+
+    struct FeatureMatrix {
+        std::vector<float> columns[NUM_FEATURES];
+        std::vector<pid_t> pids; // Owner of each row
+
+        size_t rows() const { return pids.size(); }
+        // Append a zeroed row for pid; returns its index
+        size_t addRow(pid_t pid);
+        // Swap-remove a row; returns the PID that moved into it (or -1 if none)
+        pid_t removeRow(size_t row);
+        float& at(Feature f, size_t row) { return columns[f][row]; }
+        const float* column(Feature f) const { return columns[f].data(); }
+    };
+
+    using Cpu::SimdLevel;
+    using Cpu::detectSimdLevel;
+    using Cpu::simdLevelName;
+
+    // Linear importance model: bias + sum(weights[f] * feature[f])
+    struct PredictionModel {
+        float weights[NUM_FEATURES] = {0.1f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+        float bias = 1.0f;
+
+        // Score one feature vector (features beyond NUM_FEATURES are ignored)
+        float predict(const std::vector<float>& features) const;
+        // Score a single row of a feature matrix without allocating
+        float predictRow(const FeatureMatrix& features, size_t row) const;
+        // Score every row into out[0..rows) using the best available kernel
+        void predictBatch(const FeatureMatrix& features, float* out) const;
+        // Same, forcing a specific kernel (falls back to scalar if unsupported)
+        void predictBatch(const FeatureMatrix& features, float* out, SimdLevel level) const;
+    };
+}
+
+#endif // PREDICTION_MODEL_H
@@ -0,0 +1,71 @@
+// prediction_model_bench.cpp
+// Microbenchmark: per-process scoring (a fresh std::vector<float> per PID, as the
+// scheduler used to do) versus predictBatch over the SoA feature matrix with each
+// available kernel.
+#include "prediction_model.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+
+constexpr int REPEATS = 20;
+
+template <typename Fn>
+double nsPerProcess(size_t rows, Fn&& fn) {
+    fn(); // warm up
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < REPEATS; ++r) fn();
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / REPEATS / rows;
+}
+
+int main() {
+    ML::PredictionModel model;
+    // Use every feature so each kernel reads the full matrix
+    const float weights[ML::NUM_FEATURES] = {0.1f, -0.01f, 0.5f, 0.2f, 0.02f, 0.03f};
+    for (int f = 0; f < ML::NUM_FEATURES; ++f) model.weights[f] = weights[f];
+
+    std::cout << "Scoring cost (ns/process), best kernel on this CPU: "
+              << ML::simdLevelName(ML::detectSimdLevel()) << "\n\n";
+    std::cout << std::setw(10) << "processes" << std::setw(14) << "per-process"
+              << std::setw(10) << "scalar" << std::setw(10) << "sse2" << std::setw(10) << "avx2" << "\n";
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(0.0f, 100.0f);
+    for (size_t rows : {1000, 10000, 100000, 1000000}) {
+        ML::FeatureMatrix features;
+        for (size_t i = 0; i < rows; ++i) {
+            size_t row = features.addRow(static_cast<pid_t>(i));
+            for (int f = 0; f < ML::NUM_FEATURES; ++f) features.at(static_cast<ML::Feature>(f), row) = dist(rng);
+        }
+        std::vector<float> out(rows);
+        volatile float sink = 0.0f;
+
+        double perProcess = nsPerProcess(rows, [&] {
+            for (size_t i = 0; i < rows; ++i) {
+                out[i] = model.predict({
+                    features.at(ML::INTERACTION_COUNT, i), features.at(ML::RECENCY, i),
+                    features.at(ML::DEPENDENCY, i), features.at(ML::TIME_OF_DAY, i),
+                    features.at(ML::CPU_USAGE, i), features.at(ML::IO_USAGE, i)
+                });
+            }
+            sink = sink + out[rows / 2];
+        });
+        std::cout << std::fixed << std::setprecision(3)
+                  << std::setw(10) << rows << std::setw(14) << perProcess;
+        for (ML::SimdLevel level : {ML::SimdLevel::SCALAR, ML::SimdLevel::SSE2, ML::SimdLevel::AVX2}) {
+            if (level > ML::detectSimdLevel()) {
+                std::cout << std::setw(10) << "n/a";
+                continue;
+            }
+            double batch = nsPerProcess(rows, [&] {
+                model.predictBatch(features, out.data(), level);
+                sink = sink + out[rows / 2];
+            });
+            std::cout << std::setw(10) << batch;
+        }
+        std::cout << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+#ifndef PRIORITY_INDEX_H
+#define PRIORITY_INDEX_H
+
+#include <unordered_map>
+#include <vector>
+#include <queue>
+#include <cstddef>
+#include <cstdint>
+
+using pid_t = int;
+
+// Addressable binary max-heap keyed by PID.
+// Each PID has at most one entry; its position is tracked so that a changed
+// key can be sifted in place (O(log n)) instead of rebuilding the whole order.
+// Payload is carried alongside the key (e.g. a cached scheduling decision).
+template <typename Payload>
+class PriorityIndex {
+public:
+    PriorityIndex() = default;
+    // The cursor refers back into the heap, so the index is not copyable
+    PriorityIndex(const PriorityIndex&) = delete;
+    PriorityIndex& operator=(const PriorityIndex&) = delete;
+
+    // Insert a PID or update its key/payload in place. A new PID or a
+    // changed key invalidates the cursor.
+    void upsert(pid_t pid, float key, const Payload& payload) {
+        if (set(pid, key, payload)) cursorValid = false;
+    }
+
+    // Same as upsert, but the cursor keeps its place: entries it handed out
+    // stay handed out, and the rest come out in their new order
+    void reorder(pid_t pid, float key, const Payload& payload) {
+        if (set(pid, key, payload)) cursorStale = true;
+    }
+
+    // Remove a PID if present
+    void erase(pid_t pid) {
+        auto it = position.find(pid);
+        if (it == position.end()) return;
+        cursorValid = false;
+        size_t i = it->second;
+        position.erase(it);
+        size_t last = heap.size() - 1;
+        if (i != last) {
+            heap[i] = heap[last];
+            position[heap[i].pid] = i;
+        }
+        heap.pop_back();
+        if (i < heap.size()) {
+            siftUp(i);
+            siftDown(i);
+        }
+    }
+
+    bool contains(pid_t pid) const { return position.count(pid) != 0; }
+    size_t size() const { return heap.size(); }
+    bool empty() const { return heap.empty(); }
+
+    // The n highest-keyed payloads in descending order, without disturbing
+    // the heap. Walks a frontier of candidate heap slots: O(n log n).
+    std::vector<Payload> topK(size_t n) const {
+        std::vector<Payload> result;
+        if (heap.empty() || n == 0) return result;
+        result.reserve(n < heap.size() ? n : heap.size());
+        Frontier frontier{FrontierOrder{&heap}};
+        frontier.push(0);
+        while (!frontier.empty() && result.size() < n) {
+            size_t i = frontier.top();
+            frontier.pop();
+            result.push_back(heap[i].payload);
+            expand(frontier, i);
+        }
+        return result;
+    }
+
+    // Cursor over the heap in descending key order. Restarted by reset();
+    // each call to next() costs O(log k) for the k-th entry handed out, plus
+    // O(k) once after a reorder. upsert (of a new PID or a changed key) and
+    // erase invalidate the cursor until the next reset().
+    void reset() {
+        cursor = Frontier{FrontierOrder{&heap}};
+        if (!heap.empty()) cursor.push(0);
+        cursorValid = true;
+        cursorStale = false;
+        ++cursorRound;
+    }
+    bool cursorActive() const { return cursorValid; }
+    bool next(Payload& out) {
+        if (!cursorValid) return false;
+        if (cursorStale) rebuildCursor();
+        // After a reorder, handed out entries may sit below others
+        while (!cursor.empty()) {
+            size_t i = cursor.top();
+            cursor.pop();
+            expand(cursor, i);
+            if (heap[i].handedIn == cursorRound) continue;
+            heap[i].handedIn = cursorRound;
+            out = heap[i].payload;
+            return true;
+        }
+        return false;
+    }
+
+    // All payloads in heap order (unsorted)
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (const auto& e : heap) fn(e.payload);
+    }
+
+private:
+    struct Entry {
+        pid_t pid;
+        float key;
+        Payload payload;
+        uint64_t handedIn = 0; // Cursor round that handed it out
+    };
+    struct FrontierOrder {
+        const std::vector<Entry>* entries;
+        bool operator()(size_t a, size_t b) const { return (*entries)[a].key < (*entries)[b].key; }
+    };
+    using Frontier = std::priority_queue<size_t, std::vector<size_t>, FrontierOrder>;
+
+    std::vector<Entry> heap;
+    std::unordered_map<pid_t, size_t> position;
+    Frontier cursor{FrontierOrder{&heap}};
+    bool cursorValid = false;
+    bool cursorStale = false; // Heap reordered under the cursor's frontier
+    uint64_t cursorRound = 0;
+
+    // Returns whether the order may have changed
+    bool set(pid_t pid, float key, const Payload& payload) {
+        auto it = position.find(pid);
+        if (it == position.end()) {
+            heap.push_back({pid, key, payload});
+            position[pid] = heap.size() - 1;
+            siftUp(heap.size() - 1);
+            return true;
+        }
+        size_t i = it->second;
+        float oldKey = heap[i].key;
+        heap[i].key = key;
+        heap[i].payload = payload;
+        if (key == oldKey) return false;
+        if (key > oldKey) siftUp(i); else siftDown(i);
+        return true;
+    }
+    // The frontier again: the entries not handed out this round whose
+    // ancestors all were
+    void rebuildCursor() {
+        std::vector<size_t> frontier, stack;
+        if (!heap.empty()) stack.push_back(0);
+        while (!stack.empty()) {
+            size_t i = stack.back();
+            stack.pop_back();
+            if (heap[i].handedIn != cursorRound) {
+                frontier.push_back(i);
+                continue;
+            }
+            size_t l = 2 * i + 1, r = 2 * i + 2;
+            if (l < heap.size()) stack.push_back(l);
+            if (r < heap.size()) stack.push_back(r);
+        }
+        cursor = Frontier{FrontierOrder{&heap}, std::move(frontier)};
+        cursorStale = false;
+    }
+
+    void expand(Frontier& frontier, size_t i) const {
+        size_t l = 2 * i + 1, r = 2 * i + 2;
+        if (l < heap.size()) frontier.push(l);
+        if (r < heap.size()) frontier.push(r);
+    }
+    void place(size_t i, Entry e) {
+        heap[i] = e;
+        position[e.pid] = i;
+    }
+    void siftUp(size_t i) {
+        Entry e = heap[i];
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (heap[parent].key >= e.key) break;
+            place(i, heap[parent]);
+            i = parent;
+        }
+        place(i, e);
+    }
+    void siftDown(size_t i) {
+        Entry e = heap[i];
+        size_t n = heap.size();
+        while (true) {
+            size_t child = 2 * i + 1;
+            if (child >= n) break;
+            if (child + 1 < n && heap[child + 1].key > heap[child].key) ++child;
+            if (heap[child].key <= e.key) break;
+            place(i, heap[child]);
+            i = child;
+        }
+        place(i, e);
+    }
+};
+
+#endif // PRIORITY_INDEX_H
@@ -0,0 +1,300 @@
+#include "proc_sampler.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+    // Descriptors left for the rest of the process when the budget comes
+    // from RLIMIT_NOFILE
+    constexpr size_t FD_HEADROOM_DIVISOR = 4;
+    // Largest /proc/[pid]/stat, io and statm contents read
+    constexpr size_t READ_BUFFER = 1024;
+
+    double threadCpuSeconds() {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+    }
+
+    size_t defaultOpenFiles() {
+        rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return 0;
+        if (limit.rlim_cur < limit.rlim_max) {
+            rlimit raised{limit.rlim_max, limit.rlim_max};
+            if (setrlimit(RLIMIT_NOFILE, &raised) == 0) limit = raised;
+        }
+        if (limit.rlim_cur == RLIM_INFINITY) return SIZE_MAX;
+        return static_cast<size_t>(limit.rlim_cur - limit.rlim_cur / FD_HEADROOM_DIVISOR);
+    }
+
+    // Unsigned decimal at p; advances p past it
+    uint64_t parseNumber(const char*& p, const char* end) {
+        uint64_t value = 0;
+        while (p < end && *p >= '0' && *p <= '9') value = value * 10 + uint64_t(*p++ - '0');
+        return value;
+    }
+
+    void skipField(const char*& p, const char* end) {
+        while (p < end && *p != ' ') ++p;
+        while (p < end && *p == ' ') ++p;
+    }
+
+    struct StatFields {
+        std::string name;
+        uint64_t cpuTicks;  // utime + stime
+        uint64_t startTime;
+    };
+
+    // /proc/[pid]/stat: "pid (comm) state ppid ...". comm may hold spaces and
+    // parentheses, so fields are counted from the last ')'.
+    bool parseStat(const char* buf, size_t n, StatFields& out) {
+        const char* end = buf + n;
+        const char* open = static_cast<const char*>(std::memchr(buf, '(', n));
+        const char* close = nullptr;
+        for (const char* p = end; p > buf; --p) {
+            if (p[-1] == ')') {
+                close = p - 1;
+                break;
+            }
+        }
+        if (!open || !close || close < open) return false;
+        out.name.assign(open + 1, close);
+        const char* p = close + 2; // Field 3, the state
+        // utime and stime are fields 14 and 15, starttime is field 22
+        for (int field = 3; field < 14; ++field) skipField(p, end);
+        uint64_t utime = parseNumber(p, end);
+        skipField(p, end);
+        uint64_t stime = parseNumber(p, end);
+        for (int field = 15; field < 22; ++field) skipField(p, end);
+        out.startTime = parseNumber(p, end);
+        out.cpuTicks = utime + stime;
+        return p <= end;
+    }
+
+    // /proc/[pid]/io starts "rchar: N\nwchar: N\n"
+    uint64_t parseIoBytes(const char* buf, size_t n) {
+        const char* end = buf + n;
+        uint64_t total = 0;
+        const char* p = buf;
+        for (int line = 0; line < 2 && p < end; ++line) {
+            while (p < end && (*p < '0' || *p > '9')) ++p;
+            total += parseNumber(p, end);
+        }
+        return total;
+    }
+
+    // /proc/[pid]/statm: "size resident shared ..." in pages
+    uint64_t parseResidentPages(const char* buf, size_t n) {
+        const char* p = buf;
+        const char* end = buf + n;
+        skipField(p, end);
+        return parseNumber(p, end);
+    }
+}
+
+ProcSampler::ProcSampler(AdaptiveScheduler& scheduler, AdaptiveMemoryManager& memory,
+                         const ProcSamplerConfig& config)
+    : scheduler(scheduler), memory(memory), config(config),
+      ticksPerSecond(static_cast<double>(sysconf(_SC_CLK_TCK))),
+      pageSize(static_cast<size_t>(sysconf(_SC_PAGESIZE))),
+      maxOpenFiles(config.maxOpenFiles ? config.maxOpenFiles : defaultOpenFiles()) {}
+
+ProcSampler::~ProcSampler() {
+    stop();
+    std::lock_guard<std::mutex> lock(sampleMtx);
+    for (Tracked& t : tracked) {
+        closeFile(t.statFd);
+        closeFile(t.ioFd);
+        closeFile(t.statmFd);
+    }
+}
+
+void ProcSampler::start(std::chrono::milliseconds interval) {
+    stop();
+    std::lock_guard<std::mutex> lock(threadMtx);
+    stopping = false;
+    thread = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(threadMtx);
+        do {
+            lock.unlock();
+            sampleOnce();
+            lock.lock();
+        } while (!threadCv.wait_for(lock, interval, [&] { return stopping; }));
+    });
+}
+
+void ProcSampler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(threadMtx);
+        if (!thread.joinable()) return;
+        stopping = true;
+    }
+    threadCv.notify_all();
+    thread.join();
+}
+
+ProcSamplerStats ProcSampler::stats() {
+    std::lock_guard<std::mutex> lock(sampleMtx);
+    ProcSamplerStats s = counters;
+    s.tracked = tracked.size();
+    s.openFiles = openFiles;
+    return s;
+}
+
+void ProcSampler::sampleOnce() {
+    std::lock_guard<std::mutex> lock(sampleMtx);
+    double cpuStart = threadCpuSeconds();
+    auto now = std::chrono::steady_clock::now();
+    double interval = std::chrono::duration<double>(now - lastSample).count();
+    bool rates = counters.samples > 0 && interval > 0;
+    lastSample = now;
+    if (!listProcesses()) return;
+
+    // Merge the listing into the tracked processes; both are sorted by PID
+    merged.clear();
+    updates.clear();
+    samples.clear();
+    size_t i = 0;
+    for (pid_t pid : listed) {
+        for (; i < tracked.size() && tracked[i].pid < pid; ++i) death(tracked[i]);
+        Tracked t;
+        if (i < tracked.size() && tracked[i].pid == pid) t = tracked[i++];
+        else t.pid = pid;
+
+        char buf[READ_BUFFER];
+        StatFields stat;
+        ssize_t n = read(pid, t.statFd, "stat", buf, sizeof buf);
+        if (n <= 0 || !parseStat(buf, static_cast<size_t>(n), stat)) {
+            death(t); // Exited since the listing
+            continue;
+        }
+        if (t.handle.valid() && stat.startTime != t.startTime) {
+            // The PID was reused: a different process with fresh state
+            int statFd = std::exchange(t.statFd, NO_FD);
+            death(t);
+            t = Tracked();
+            t.pid = pid;
+            t.statFd = statFd;
+        }
+        if (!t.handle.valid()) {
+            t.startTime = stat.startTime;
+            birth(t, stat.name);
+            if (!t.handle.valid()) {
+                death(t);
+                continue;
+            }
+        }
+        uint64_t ioBytes = t.ioBytes;
+        if (t.ioFd != UNREADABLE) {
+            n = read(pid, t.ioFd, "io", buf, sizeof buf);
+            if (n > 0) ioBytes = parseIoBytes(buf, static_cast<size_t>(n));
+        }
+        n = read(pid, t.statmFd, "statm", buf, sizeof buf);
+        uint64_t residentPages = n > 0 ? parseResidentPages(buf, static_cast<size_t>(n)) : 0;
+
+        if (t.seen && rates) {
+            double cpu = (stat.cpuTicks - std::min(stat.cpuTicks, t.cpuTicks)) / ticksPerSecond / interval * 100;
+            double io = (ioBytes - std::min(ioBytes, t.ioBytes)) / interval / config.ioFullScale * 100;
+            updates.push_back(UsageUpdate{t.handle, {ApplicationEvent::OTHER, 0},
+                                          static_cast<int>(std::min(cpu, 100.0) + 0.5),
+                                          static_cast<int>(std::min(io, 100.0) + 0.5)});
+        }
+        samples.push_back(MemoryUsageSample{t.handle, residentPages * pageSize});
+        t.cpuTicks = stat.cpuTicks;
+        t.ioBytes = ioBytes;
+        t.seen = true;
+        merged.push_back(t);
+    }
+    for (; i < tracked.size(); ++i) death(tracked[i]);
+    tracked.swap(merged);
+    double cpuScanned = threadCpuSeconds();
+
+    scheduler.updateUsageMetricsBatch(updates.data(), updates.size());
+    memory.predictMemoryNeedsBatch(samples.data(), samples.size());
+    double cpuEnd = threadCpuSeconds();
+    counters.samples++;
+    counters.scanCpuSeconds += cpuScanned - cpuStart;
+    counters.pushCpuSeconds += cpuEnd - cpuScanned;
+    counters.lastSampleSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - now).count();
+}
+
+// The numeric entries of procRoot, ascending
+bool ProcSampler::listProcesses() {
+    DIR* dir = opendir(config.procRoot.c_str());
+    if (!dir) return false;
+    listed.clear();
+    while (dirent* entry = readdir(dir)) {
+        const char* name = entry->d_name;
+        if (*name < '1' || *name > '9') continue;
+        char* end;
+        long pid = std::strtol(name, &end, 10);
+        if (*end == '\0') listed.push_back(static_cast<pid_t>(pid));
+    }
+    closedir(dir);
+    // Already ascending in practice; sorting a sorted list is cheap
+    std::sort(listed.begin(), listed.end());
+    return true;
+}
+
+void ProcSampler::birth(Tracked& t, const std::string& name) {
+    t.handle = scheduler.registerProcess(t.pid, name);
+    memory.registerProcess(t.pid);
+    counters.births++;
+}
+
+// Unregister a process that is gone and close its files
+void ProcSampler::death(Tracked& t) {
+    if (t.handle.valid()) {
+        scheduler.unregisterProcess(t.pid);
+        memory.unregisterProcess(t.pid);
+        counters.deaths++;
+        t.handle = ProcessHandle();
+    }
+    closeFile(t.statFd);
+    closeFile(t.ioFd);
+    closeFile(t.statmFd);
+}
+
+// pread the whole (small) file into buf; opens it first if need be, keeping
+// the descriptor while the budget allows. Returns bytes read, or -1.
+ssize_t ProcSampler::read(pid_t pid, int& fd, const char* file, char* buf, size_t size) {
+    if (fd >= 0) {
+        ssize_t n = pread(fd, buf, size - 1, 0);
+        if (n >= 0) return n;
+        closeFile(fd); // ESRCH: the process has exited
+        return -1;
+    }
+    char path[256];
+    std::snprintf(path, sizeof path, "%s/%d/%s", config.procRoot.c_str(), pid, file);
+    // io checks permission at read as well as open (pid 1 in a container)
+    int opened = open(path, O_RDONLY | O_CLOEXEC);
+    ssize_t n = opened < 0 ? -1 : pread(opened, buf, size - 1, 0);
+    if (n < 0 && (errno == EACCES || errno == EPERM)) fd = UNREADABLE;
+    if (n >= 0 && openFiles < maxOpenFiles) {
+        fd = opened;
+        openFiles++;
+        return n;
+    }
+    if (opened >= 0) {
+        close(opened);
+        if (n >= 0) counters.reopens++;
+    }
+    return n;
+}
+
+void ProcSampler::closeFile(int& fd) {
+    if (fd >= 0) {
+        close(fd);
+        openFiles--;
+    }
+    fd = NO_FD;
+}
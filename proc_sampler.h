@@ -0,0 +1,105 @@
+#ifndef PROC_SAMPLER_H
+#define PROC_SAMPLER_H
+
+#include "adaptive_scheduler.h"
+#include "adaptive_memory_manager.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+// Knobs of the /proc sampler
+struct ProcSamplerConfig {
+    std::string procRoot = "/proc";
+    // Descriptors kept open across samples (three per process at most); past
+    // this, files are opened for each read. 0: three quarters of the soft
+    // RLIMIT_NOFILE, after raising it to the hard limit.
+    size_t maxOpenFiles = 0;
+    // IO rate (read plus written bytes per second) reported as ioUsage 100
+    double ioFullScale = 10.0 * 1024 * 1024;
+};
+
+// Counters since construction
+struct ProcSamplerStats {
+    uint64_t samples = 0;
+    uint64_t births = 0;        // Processes registered
+    uint64_t deaths = 0;        // ... and unregistered again
+    uint64_t tracked = 0;       // Processes tracked now
+    uint64_t openFiles = 0;     // Descriptors held now
+    uint64_t reopens = 0;       // Reads that had to open their file
+    double scanCpuSeconds = 0;  // Sampling thread CPU spent reading /proc
+    double pushCpuSeconds = 0;  // ... and in the managers' batch calls
+    double lastSampleSeconds = 0; // Wall time of the latest sample
+};
+
+// Feeds the host's real processes into the managers. Each sample lists
+// /proc, registers new processes with the scheduler and the memory manager
+// and unregisters the ones that are gone (a reused PID counts as both), then
+// reads /proc/[pid]/stat, io and statm with one pread each into descriptors
+// kept open between samples. CPU and IO rates over the interval and the
+// resident set size go to updateUsageMetricsBatch and
+// predictMemoryNeedsBatch in one call each. The managers should share one
+// ProcessTable.
+class ProcSampler {
+public:
+    ProcSampler(AdaptiveScheduler& scheduler, AdaptiveMemoryManager& memory,
+                const ProcSamplerConfig& config = ProcSamplerConfig());
+    ~ProcSampler();
+    ProcSampler(const ProcSampler&) = delete;
+    ProcSampler& operator=(const ProcSampler&) = delete;
+
+    // Sample every interval on a background thread until stop() or destruction
+    void start(std::chrono::milliseconds interval);
+    void stop();
+    // Sample on the calling thread now. The first sample of a process only
+    // registers it and reports its memory; rates start with the second.
+    void sampleOnce();
+    ProcSamplerStats stats();
+
+private:
+    static constexpr int NO_FD = -1;
+    static constexpr int UNREADABLE = -2; // Open failed for lack of permission; not retried
+    struct Tracked {
+        pid_t pid = 0;
+        ProcessHandle handle;    // Invalid until registered
+        uint64_t startTime = 0;  // Clock ticks after boot; tells a reused PID apart
+        int statFd = NO_FD, ioFd = NO_FD, statmFd = NO_FD;
+        uint64_t cpuTicks = 0;   // utime + stime
+        uint64_t ioBytes = 0;    // rchar + wchar
+        bool seen = false;       // Has a previous reading to take deltas from
+    };
+
+    AdaptiveScheduler& scheduler;
+    AdaptiveMemoryManager& memory;
+    const ProcSamplerConfig config;
+    const double ticksPerSecond;
+    const size_t pageSize;
+    size_t maxOpenFiles;
+
+    std::mutex sampleMtx; // Serialises samples; guards everything below
+    std::vector<Tracked> tracked; // By PID
+    std::vector<pid_t> listed;
+    std::vector<Tracked> merged;
+    std::vector<UsageUpdate> updates;
+    std::vector<MemoryUsageSample> samples;
+    std::chrono::steady_clock::time_point lastSample;
+    size_t openFiles = 0;
+    ProcSamplerStats counters;
+
+    std::mutex threadMtx; // Guards the thread's lifetime
+    std::condition_variable threadCv;
+    bool stopping = false;
+    std::thread thread;
+
+    bool listProcesses();
+    void birth(Tracked& t, const std::string& name);
+    void death(Tracked& t);
+    ssize_t read(pid_t pid, int& fd, const char* file, char* buf, size_t size);
+    void closeFile(int& fd);
+};
+
+#endif // PROC_SAMPLER_H
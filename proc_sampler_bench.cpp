@@ -0,0 +1,103 @@
+// proc_sampler_bench.cpp
+// Cost of feeding the host's processes into the managers (proc_sampler.h).
+// Forks idle children to grow the process count, samples /proc on a
+// background thread, kills half the children midway so deaths are seen, and
+// reports the sampler's CPU time as a share of one CPU, also per 10k
+// processes.
+//
+// Usage: proc_sampler_bench [--spawn N] [--interval MS] [--seconds S]
+#include "proc_sampler.h"
+#include "event_log.h"
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    std::vector<pid_t> spawn(size_t count) {
+        std::vector<pid_t> children;
+        for (size_t i = 0; i < count; ++i) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                pause();
+                _exit(0);
+            }
+            if (pid < 0) break;
+            children.push_back(pid);
+        }
+        return children;
+    }
+
+    void reap(const std::vector<pid_t>& children, size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i) kill(children[i], SIGKILL);
+        for (size_t i = from; i < to; ++i) waitpid(children[i], nullptr, 0);
+    }
+
+    void report(const char* phase, const ProcSamplerStats& s, const ProcSamplerStats& before, double wall) {
+        double cpu = s.scanCpuSeconds + s.pushCpuSeconds - before.scanCpuSeconds - before.pushCpuSeconds;
+        double percent = cpu / wall * 100;
+        std::cout << phase << ": " << s.tracked << " processes, " << s.samples - before.samples << " samples, "
+                  << percent << "% CPU (" << percent * 10000 / std::max<uint64_t>(s.tracked, 1)
+                  << "% per 10k processes), last sample " << s.lastSampleSeconds * 1000 << " ms\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t spawnCount = 2000;
+    int intervalMs = 100;
+    double seconds = 4;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--spawn" && i + 1 < argc) spawnCount = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--interval" && i + 1 < argc) intervalMs = std::atoi(argv[++i]);
+        else if (arg == "--seconds" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else {
+            std::cerr << "usage: " << argv[0] << " [--spawn N] [--interval MS] [--seconds S]\n";
+            return 1;
+        }
+    }
+    if (intervalMs <= 0 || seconds <= 0) return 1;
+    // Children first, so they do not inherit the managers' threads and memory
+    std::vector<pid_t> children = spawn(spawnCount);
+    EventLog::instance().setLevel(LogLevel::OFF);
+    std::cout << std::fixed << std::setprecision(2) << "spawned " << children.size() << " children\n";
+
+    auto table = std::make_shared<ProcessTable>();
+    AdaptiveScheduler scheduler(table);
+    AdaptiveMemoryManager memory(table, SlowTierMode::MEMORY);
+    ProcSampler sampler(scheduler, memory);
+    auto half = std::chrono::duration<double>(seconds / 2);
+
+    auto start = std::chrono::steady_clock::now();
+    sampler.start(std::chrono::milliseconds(intervalMs));
+    std::this_thread::sleep_for(half);
+    ProcSamplerStats first = sampler.stats();
+    report("all children", first, ProcSamplerStats(),
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    reap(children, children.size() / 2, children.size());
+    children.resize(children.size() / 2);
+    auto middle = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(half);
+    sampler.stop();
+    ProcSamplerStats second = sampler.stats();
+    report("half killed", second, first,
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - middle).count());
+
+    std::cout << "births " << second.births << ", deaths " << second.deaths << ", descriptors "
+              << second.openFiles << ", reopens " << second.reopens << "\n"
+              << "scan " << second.scanCpuSeconds * 1000 << " ms, push " << second.pushCpuSeconds * 1000
+              << " ms CPU in total\n\ntop processes:\n";
+    for (const auto& d : scheduler.topK(5)) {
+        std::cout << "  pid " << d.process_id << " priority " << d.base_priority << " importance "
+                  << d.importance_factor << "\n";
+    }
+    reap(children, 0, children.size());
+    return 0;
+}
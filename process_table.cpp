@@ -0,0 +1,89 @@
+#include "process_table.h"
+
+ProcessHandle ProcessTable::acquire(pid_t pid) {
+    std::lock_guard<std::mutex> lock(registryMtx);
+    ProcessHandle existing = lookup(pid);
+    if (existing.valid()) {
+        slots[existing.slot].refs++;
+        return existing;
+    }
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = highWater.load(std::memory_order_relaxed);
+        if (!slots.ensure(size_t(slot) + 1)) return ProcessHandle();
+    }
+    Slot& s = slots[slot];
+    s.refs = 1;
+    s.pid.store(pid, std::memory_order_relaxed);
+    uint32_t gen = s.generation.load(std::memory_order_relaxed) + 1;
+    s.generation.store(gen, std::memory_order_release);
+    // Publish the slot only once it is fully initialised
+    if (slot == highWater.load(std::memory_order_relaxed)) highWater.store(slot + 1, std::memory_order_release);
+    index.insert(pid, slot);
+    live.fetch_add(1, std::memory_order_relaxed);
+    return ProcessHandle{slot, gen};
+}
+
+void ProcessTable::acquireBatch(const pid_t* pids, const uint32_t* refs, size_t count, ProcessHandle* out) {
+    std::lock_guard<std::mutex> lock(registryMtx);
+    // Slots are assigned first and published to the index in one batch
+    std::vector<size_t> added;
+    uint32_t high = highWater.load(std::memory_order_relaxed);
+    // Into an empty table (a restore at startup) nothing needs looking up
+    bool empty = live.load(std::memory_order_relaxed) == 0;
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = ProcessHandle();
+        if (refs[i] == 0) continue;
+        ProcessHandle existing = empty ? ProcessHandle() : lookup(pids[i]);
+        if (existing.valid()) {
+            slots[existing.slot].refs += refs[i];
+            out[i] = existing;
+            continue;
+        }
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            if (!slots.ensure(size_t(high) + 1)) continue;
+            slot = high++;
+        }
+        Slot& s = slots[slot];
+        s.refs = refs[i];
+        s.pid.store(pids[i], std::memory_order_relaxed);
+        uint32_t gen = s.generation.load(std::memory_order_relaxed) + 1;
+        s.generation.store(gen, std::memory_order_release);
+        out[i] = ProcessHandle{slot, gen};
+        added.push_back(i);
+    }
+    highWater.store(high, std::memory_order_release);
+    index.updateBatch(added.size(), [&](size_t k) { return pids[added[k]]; },
+                      [&](size_t k, uint32_t& slot) { slot = out[added[k]].slot; });
+    live.fetch_add(added.size(), std::memory_order_relaxed);
+}
+
+bool ProcessTable::release(pid_t pid) {
+    std::lock_guard<std::mutex> lock(registryMtx);
+    ProcessHandle h = lookup(pid);
+    if (!h.valid()) return false;
+    Slot& s = slots[h.slot];
+    if (--s.refs > 0) return true;
+    index.erase(pid);
+    // Stale handles now fail isLive(); the even generation marks the slot free
+    s.generation.store(h.generation + 1, std::memory_order_release);
+    freeSlots.push_back(h.slot);
+    live.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+ProcessHandle ProcessTable::lookup(pid_t pid) {
+    uint32_t slot = 0;
+    if (!index.find(pid, [&](uint32_t s) { slot = s; })) return ProcessHandle();
+    uint32_t gen = generationOf(slot);
+    // Raced with release(): the slot is free, or already recycled for another PID
+    if (!(gen & 1) || pidOf(slot) != pid) return ProcessHandle();
+    return ProcessHandle{slot, gen};
+}
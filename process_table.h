@@ -0,0 +1,122 @@
+#ifndef PROCESS_TABLE_H
+#define PROCESS_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "sharded_store.h"
+
+// Stable reference to a registered process: its dense slot index plus the
+// slot's generation at registration. Unregistering bumps the generation, so a
+// handle to a reused slot is recognised as stale instead of aliasing the new
+// owner.
+struct ProcessHandle {
+    uint32_t slot = 0;
+    uint32_t generation = 0; // 0 never refers to a live process
+    bool valid() const { return generation != 0; }
+};
+
+// Growable array whose elements never move: storage is added in fixed chunks
+// behind a preallocated directory, so readers can index any slot below
+// capacity() while another thread grows it.
+template <typename T, size_t ChunkBits = 12, size_t MaxChunks = 4096>
+class ChunkedArray {
+public:
+    static constexpr size_t CHUNK_SIZE = size_t(1) << ChunkBits;
+    static constexpr size_t MAX_SIZE = CHUNK_SIZE * MaxChunks;
+
+    ChunkedArray() = default;
+    ~ChunkedArray() {
+        for (auto& chunk : chunks) delete[] chunk.load(std::memory_order_relaxed);
+    }
+    ChunkedArray(const ChunkedArray&) = delete;
+    ChunkedArray& operator=(const ChunkedArray&) = delete;
+
+    // Element i; requires i < capacity()
+    T& operator[](size_t i) {
+        return chunks[i >> ChunkBits].load(std::memory_order_acquire)[i & (CHUNK_SIZE - 1)];
+    }
+    const T& operator[](size_t i) const {
+        return chunks[i >> ChunkBits].load(std::memory_order_acquire)[i & (CHUNK_SIZE - 1)];
+    }
+
+    // Make elements [0, n) addressable; thread-safe. False if n > MAX_SIZE.
+    bool ensure(size_t n) {
+        if (n <= capacity()) return true;
+        if (n > MAX_SIZE) return false;
+        std::lock_guard<std::mutex> lock(growMtx);
+        size_t have = allocated.load(std::memory_order_relaxed);
+        for (; have * CHUNK_SIZE < n; ++have) chunks[have].store(new T[CHUNK_SIZE](), std::memory_order_release);
+        allocated.store(have, std::memory_order_release);
+        return true;
+    }
+    size_t capacity() const { return allocated.load(std::memory_order_acquire) * CHUNK_SIZE; }
+
+private:
+    std::atomic<T*> chunks[MaxChunks] = {};
+    std::atomic<size_t> allocated{0};
+    std::mutex growMtx;
+};
+
+// Registry of live processes shared by the scheduler and the memory and
+// security managers. Each registered PID owns one dense slot; per-process
+// state lives in slot-indexed arrays (SlotStore) rather than PID-keyed hash
+// maps, and callers holding a ProcessHandle skip hashing altogether.
+// Registrations are reference counted, so every manager can register and
+// unregister the same process independently; the slot is recycled (and its
+// generation bumped) when the last registration goes.
+// lookup(), isLive() and forEach() are safe against concurrent
+// registration; acquire()/release() serialise on one mutex.
+class ProcessTable {
+public:
+    // Register pid, or add a reference if it already is; returns its handle.
+    // Invalid handle if the table is full.
+    ProcessHandle acquire(pid_t pid);
+    // acquire() for count processes at once, taking refs[i] references to
+    // pids[i] (none if 0), under one lock and one pass over the index. out[i]
+    // is invalid if refs[i] is 0 or the table is full.
+    void acquireBatch(const pid_t* pids, const uint32_t* refs, size_t count, ProcessHandle* out);
+    // Drop one reference; false if pid is not registered
+    bool release(pid_t pid);
+    // Handle of a registered pid (one sharded hash lookup); invalid otherwise
+    ProcessHandle lookup(pid_t pid);
+
+    bool isLive(ProcessHandle h) const {
+        return h.valid() && h.slot < slotCount() &&
+               slots[h.slot].generation.load(std::memory_order_acquire) == h.generation;
+    }
+    // Generation of a slot; odd while live
+    uint32_t generationOf(uint32_t slot) const { return slots[slot].generation.load(std::memory_order_acquire); }
+    pid_t pidOf(uint32_t slot) const { return slots[slot].pid.load(std::memory_order_relaxed); }
+    // Slots handed out so far; every live slot lies below
+    uint32_t slotCount() const { return highWater.load(std::memory_order_acquire); }
+    size_t size() const { return live.load(std::memory_order_relaxed); }
+
+    // Visit live processes as fn(pid, handle) in slot order: a linear walk
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        uint32_t n = slotCount();
+        for (uint32_t s = 0; s < n; ++s) {
+            uint32_t gen = generationOf(s);
+            if (gen & 1) fn(pidOf(s), ProcessHandle{s, gen});
+        }
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> generation{0}; // Odd while live, even while free
+        std::atomic<pid_t> pid{0};
+        uint32_t refs = 0; // Guarded by registryMtx
+    };
+
+    ShardedStore<uint32_t> index; // PID -> slot
+    ChunkedArray<Slot> slots;
+    std::atomic<uint32_t> highWater{0};
+    std::atomic<size_t> live{0};
+    std::mutex registryMtx; // Guards refs, freeSlots and slot (re)assignment
+    std::vector<uint32_t> freeSlots;
+};
+
+#endif // PROCESS_TABLE_H
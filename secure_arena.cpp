@@ -0,0 +1,155 @@
+#include "secure_arena.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    // Below this many bytes clearing in place is cheaper than a syscall
+    constexpr size_t MADVISE_THRESHOLD = 16 * 1024;
+    constexpr size_t BLOCK_ALIGN = 16;
+}
+
+size_t SecureArena::pageSize() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+namespace {
+    size_t defaultGuardBudget() {
+        size_t maxMaps = 65530; // Linux default
+        if (FILE* f = std::fopen("/proc/sys/vm/max_map_count", "r")) {
+            unsigned long value;
+            if (std::fscanf(f, "%lu", &value) == 1) maxMaps = value;
+            std::fclose(f);
+        }
+        return maxMaps / 4;
+    }
+}
+
+SecureArena::SecureArena() : page(pageSize()), guardBudget(defaultGuardBudget()) {
+    for (int c = 0; c < PLAIN_CLASSES; ++c) {
+        plain[c].slotSize = plain[c].stride = MIN_CLASS << c;
+    }
+    for (int c = 0; c < GUARDED_CLASSES; ++c) {
+        guardedPools[c].slotSize = page << c;
+        guardedPools[c].stride = (page << c) + page;
+        guardedPools[c].guarded = true;
+    }
+}
+
+SecureArena::~SecureArena() {
+    for (const auto& [base, bytes] : slabs) munmap(base, bytes);
+}
+
+size_t SecureArena::mappedBytes() {
+    std::lock_guard<std::mutex> lock(slabMtx);
+    size_t total = 0;
+    for (const auto& slab : slabs) total += slab.second;
+    return total;
+}
+
+SecureArena::Pool* SecureArena::poolFor(size_t size, bool guarded) {
+    Pool* pools = guarded ? guardedPools : plain;
+    int count = guarded ? GUARDED_CLASSES : PLAIN_CLASSES;
+    for (int c = 0; c < count; ++c) {
+        if (size <= pools[c].slotSize) return &pools[c];
+    }
+    return nullptr;
+}
+
+void* SecureArena::mapSlab(size_t bytes) {
+    void* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return nullptr;
+    std::lock_guard<std::mutex> lock(slabMtx);
+    slabs.emplace_back(mem, bytes);
+    return mem;
+}
+
+// Carve a fresh slab into slots; guarded slabs start with a guard page and
+// have one after every slot. Called with the pool locked.
+bool SecureArena::refill(Pool& pool) {
+    size_t lead = pool.guarded ? page : 0;
+    size_t slots = (SLAB_SIZE - lead) / pool.stride;
+    if (slots == 0) slots = 1;
+    size_t bytes = lead + slots * pool.stride;
+    char* base = static_cast<char*>(mapSlab(bytes));
+    if (!base) return false;
+    if (pool.guarded) protectGuard(base);
+    for (size_t i = 0; i < slots && pool.guarded; ++i) protectGuard(base + lead + i * pool.stride + pool.slotSize);
+    for (size_t i = slots; i-- > 0;) {
+        char* slot = base + lead + i * pool.stride;
+        auto node = reinterpret_cast<FreeNode*>(slot);
+        node->next = pool.head;
+        pool.head = node;
+    }
+    return true;
+}
+
+void* SecureArena::blockInSlot(void* slot, size_t slotSize, size_t size) {
+    return static_cast<char*>(slot) + slotSize - roundUp(size, BLOCK_ALIGN);
+}
+
+void* SecureArena::slotOfBlock(void* block, size_t slotSize, size_t size) {
+    return static_cast<char*>(block) + roundUp(size, BLOCK_ALIGN) - slotSize;
+}
+
+void* SecureArena::allocate(size_t size, bool guarded) {
+    if (size == 0) size = 1;
+    Pool* pool = poolFor(size, guarded);
+    if (!pool) {
+        // Oversized: a private mapping, with a trailing guard page if requested
+        size_t bytes = roundUp(size, page);
+        size_t total = bytes + (guarded ? page : 0);
+        void* mem = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) return nullptr;
+        if (!guarded) return mem;
+        protectGuard(static_cast<char*>(mem) + bytes);
+        return blockInSlot(mem, bytes, size);
+    }
+    FreeNode* node;
+    {
+        std::lock_guard<std::mutex> lock(pool->mtx);
+        if (!pool->head && !refill(*pool)) return nullptr;
+        node = pool->head;
+        pool->head = node->next;
+    }
+    // Slots are wiped on release; only the link word needs clearing
+    node->next = nullptr;
+    return guarded ? blockInSlot(node, pool->slotSize, size) : node;
+}
+
+void SecureArena::release(void* ptr, size_t size, bool guarded) {
+    if (!ptr) return;
+    if (size == 0) size = 1;
+    Pool* pool = poolFor(size, guarded);
+    if (!pool) {
+        size_t bytes = roundUp(size, page);
+        void* base = guarded ? slotOfBlock(ptr, bytes, size) : ptr;
+        munmap(base, bytes + (guarded ? page : 0));
+        return;
+    }
+    void* slot = guarded ? slotOfBlock(ptr, pool->slotSize, size) : ptr;
+    wipe(slot, pool->slotSize);
+    auto node = static_cast<FreeNode*>(slot);
+    std::lock_guard<std::mutex> lock(pool->mtx);
+    node->next = pool->head;
+    pool->head = node;
+}
+
+bool SecureArena::protectGuard(void* guardPage) {
+    size_t left = guardBudget.load(std::memory_order_relaxed);
+    do {
+        if (left == 0) return false;
+    } while (!guardBudget.compare_exchange_weak(left, left - 1, std::memory_order_relaxed));
+    return mprotect(guardPage, page, PROT_NONE) == 0;
+}
+
+void SecureArena::wipe(void* slot, size_t bytes) {
+    if (bytes >= MADVISE_THRESHOLD && madvise(slot, bytes, MADV_DONTNEED) == 0) return;
+    std::memset(slot, 0, bytes);
+    // Keep the compiler from eliding a wipe of memory it considers dead
+#if defined(__GNUC__)
+    asm volatile("" : : "r"(slot) : "memory");
+#endif
+}
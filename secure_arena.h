@@ -0,0 +1,76 @@
+#ifndef SECURE_ARENA_H
+#define SECURE_ARENA_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "cache_line.h"
+
+// Pooled allocator for secure regions, carved out of mmap'd slabs.
+// Requests are served from per-size-class freelists, so the steady-state cost
+// is a lock on the class's pool plus a pop. Guarded blocks come from separate
+// page-granular pools in which every slot is followed by a PROT_NONE page and
+// the block is placed flush against it, so running off the end faults. Memory
+// is wiped on release: small slots are cleared in place, page-sized ones are
+// handed back with MADV_DONTNEED (which also zeroes them). Requests larger
+// than the biggest class get their own mapping.
+//
+// Every guard page splits a kernel mapping in two, and the number of mappings
+// per process is capped (vm.max_map_count). Guard pages are therefore drawn
+// from a budget of a quarter of that cap; once it is spent, new guarded slots
+// keep their layout but the trailing page stays accessible.
+class SecureArena {
+public:
+    static constexpr size_t MIN_CLASS = 64;
+    static constexpr int PLAIN_CLASSES = 11;   // 64 B .. 64 KiB
+    static constexpr int GUARDED_CLASSES = 5;  // 1 .. 16 pages
+    static constexpr size_t SLAB_SIZE = 1 << 20;
+
+    SecureArena();
+    ~SecureArena();
+    SecureArena(const SecureArena&) = delete;
+    SecureArena& operator=(const SecureArena&) = delete;
+
+    // Zero-filled block of at least size bytes, 16-byte aligned; nullptr on failure
+    void* allocate(size_t size, bool guarded);
+    // Wipe and return a block; size and guarded must match the allocation
+    void release(void* ptr, size_t size, bool guarded);
+
+    size_t mappedBytes();
+    // Guard pages that can still be installed
+    size_t guardPagesLeft() const { return guardBudget.load(std::memory_order_relaxed); }
+    static size_t pageSize();
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+    struct alignas(CACHE_LINE_SIZE) Pool {
+        std::mutex mtx;
+        FreeNode* head = nullptr;
+        size_t slotSize = 0;   // Usable bytes per slot
+        size_t stride = 0;     // Distance between slots (slot + guard page)
+        bool guarded = false;
+    };
+
+    Pool plain[PLAIN_CLASSES];
+    Pool guardedPools[GUARDED_CLASSES];
+    std::mutex slabMtx; // Guards slabs
+    std::vector<std::pair<void*, size_t>> slabs;
+    const size_t page;
+    std::atomic<size_t> guardBudget;
+
+    Pool* poolFor(size_t size, bool guarded);
+    bool refill(Pool& pool);
+    void* mapSlab(size_t bytes);
+    void wipe(void* slot, size_t bytes);
+    bool protectGuard(void* guardPage);
+    // Guarded blocks sit at the end of their slot; convert between the two
+    static void* blockInSlot(void* slot, size_t slotSize, size_t size);
+    static void* slotOfBlock(void* block, size_t slotSize, size_t size);
+    static size_t roundUp(size_t n, size_t to) { return (n + to - 1) / to * to; }
+};
+
+#endif // SECURE_ARENA_H
@@ -0,0 +1,65 @@
+// secure_arena_bench.cpp
+// Cost of a secure allocate/free pair at the simulation's sizes (mem/4, i.e.
+// 85 B - 4 KiB): malloc/free, SecureArena plain and guarded pools, and the
+// full SecurityMemoryManager::allocateSecureMemory/freeSecureMemory path.
+#include "secure_arena.h"
+#include "security_memory_manager.h"
+#include "event_log.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+
+constexpr int LIVE_BLOCKS = 4096;
+constexpr int OPS = 2000000;
+
+// Keep LIVE_BLOCKS blocks alive and replace a random one per op; returns ns/op
+template <typename Alloc, typename Free>
+double nsPerPair(const std::vector<size_t>& sizes, Alloc&& alloc, Free&& release) {
+    std::vector<void*> live(LIVE_BLOCKS);
+    std::vector<size_t> liveSize(LIVE_BLOCKS);
+    for (int i = 0; i < LIVE_BLOCKS; ++i) live[i] = alloc(liveSize[i] = sizes[i]);
+    std::mt19937 rng(5);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < OPS; ++i) {
+        size_t slot = rng() % LIVE_BLOCKS;
+        release(live[slot], liveSize[slot]);
+        size_t size = sizes[i % sizes.size()];
+        live[slot] = alloc(liveSize[slot] = size);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    for (int i = 0; i < LIVE_BLOCKS; ++i) release(live[i], liveSize[i]);
+    return elapsed.count() / OPS;
+}
+
+int main() {
+    EventLog::instance().setLevel(LogLevel::OFF);
+    std::mt19937 rng(9);
+    std::uniform_int_distribution<size_t> memDist(1024, 16384);
+    std::vector<size_t> sizes(1 << 16);
+    for (auto& s : sizes) s = memDist(rng) / 4;
+
+    std::cout << "Allocate + free pair (ns), " << LIVE_BLOCKS << " live blocks of 256 B - 4 KiB\n\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::setw(18) << "malloc/free"
+              << std::setw(10) << nsPerPair(sizes, [](size_t s) { return std::malloc(s); },
+                                            [](void* p, size_t) { std::free(p); }) << "\n";
+    SecureArena arena;
+    for (bool guarded : {false, true}) {
+        std::cout << std::setw(18) << (guarded ? "arena (guarded)" : "arena")
+                  << std::setw(10) << nsPerPair(sizes, [&](size_t s) { return arena.allocate(s, guarded); },
+                                                [&](void* p, size_t s) { arena.release(p, s, guarded); }) << "\n";
+    }
+    for (SecurityLevel level : {SecurityLevel::LOW, SecurityLevel::HIGH}) {
+        SecurityMemoryManager manager;
+        manager.registerProcess(1);
+        std::cout << std::setw(18) << (level == SecurityLevel::HIGH ? "manager (HIGH)" : "manager (LOW)")
+                  << std::setw(10) << nsPerPair(sizes,
+                         [&](size_t s) { return manager.allocateSecureMemory(1, s, level).address; },
+                         [&](void* p, size_t) { manager.freeSecureMemory(1, p); }) << "\n";
+    }
+    std::cout << "\narena mapped: " << arena.mappedBytes() / 1024 << " KiB\n";
+    return 0;
+}
@@ -1,76 +1,334 @@
 #include "security_memory_manager.h"
-#include <iostream>
+#include "event_log.h"
 #include <algorithm>
+#include <random>
 
-SecurityMemoryManager::SecurityMemoryManager() {}
+SecurityMemoryManager::SecurityMemoryManager(bool guardHighRegions)
+    : SecurityMemoryManager(std::make_shared<ProcessTable>(), guardHighRegions) {}
 
-void SecurityMemoryManager::registerProcess(pid_t pid) {
-    std::lock_guard<std::mutex> lock(mtx);
-    processSecurityProfiles[pid] = SecurityProfile();
+SecurityMemoryManager::SecurityMemoryManager(std::shared_ptr<ProcessTable> table, bool guardHighRegions)
+    : table(std::move(table)), processSecurityProfiles(*this->table), guardHighRegions(guardHighRegions),
+      masterKey(Crypto::randomKey()), nonceSalt(std::random_device{}()) {}
+
+ProcessHandle SecurityMemoryManager::registerProcess(pid_t pid) {
+    ScopedTimer timer(callStats, TIME_REGISTER);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::SEC_REGISTER, pid);
+    // Registering again keeps the live profile and its regions, and gives
+    // back the extra table reference
+    ProcessHandle h = table->acquire(pid);
+    if (!processSecurityProfiles.insertIfAbsent(h, SecurityProfile())) table->release(pid);
+    return h;
 }
 
 void SecurityMemoryManager::unregisterProcess(pid_t pid) {
-    std::lock_guard<std::mutex> lock(mtx);
-    processSecurityProfiles.erase(pid);
+    ScopedTimer timer(callStats, TIME_UNREGISTER);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::SEC_UNREGISTER, pid);
+    ProcessHandle h = table->lookup(pid);
+    std::unordered_set<void*> regions;
+    bool registered = processSecurityProfiles.find(h, [&](SecurityProfile& profile) {
+        // Regions mid-cipher are released by their pass
+        for (void* address : profile.ciphering) profile.regions.erase(address);
+        regions.swap(profile.regions);
+    });
+    if (!registered) return;
+    processSecurityProfiles.erase(h);
+    table->release(pid);
+    {
+        std::lock_guard<StatsMutex> lock(mtx);
+        anomalyDetector.forgetProcess(pid);
+    }
+    for (void* address : regions) {
+        MemoryRegion region;
+        if (regionIndex.find(address, region)) releaseRegion(region);
+    }
 }
 
 MemoryRegion SecurityMemoryManager::allocateSecureMemory(pid_t pid, size_t size, SecurityLevel reqLevel) {
-    std::lock_guard<std::mutex> lock(mtx);
-    auto& secProfile = processSecurityProfiles[pid];
-    MemoryProtectionLevel protLevel = determineProtectionLevel(reqLevel, secProfile.trustScore);
+    return allocateSecureMemory(table->lookup(pid), size, reqLevel);
+}
+
+MemoryRegion SecurityMemoryManager::allocateSecureMemory(ProcessHandle process, size_t size, SecurityLevel reqLevel) {
+    ScopedTimer timer(callStats, TIME_ALLOCATE);
+    int trustScore = 0;
+    if (!processSecurityProfiles.find(process, [&](SecurityProfile& profile) { trustScore = profile.trustScore; })) {
+        return MemoryRegion();
+    }
+    pid_t pid = table->pidOf(process.slot);
+    MemoryRegion region = buildRegion(pid, size, reqLevel, trustScore);
+    TraceRecorder* t = trace.load(std::memory_order_acquire);
+    if (!region.address) {
+        if (t) t->record(TraceOp::ALLOCATE_SECURE, pid, nullptr, static_cast<int64_t>(size), static_cast<int64_t>(reqLevel));
+        return region;
+    }
+    bool registered = processSecurityProfiles.find(process, [&](SecurityProfile& profile) {
+        profile.regions.insert(region.address);
+    });
+    if (!registered) {
+        // Unregistered meanwhile; nobody would ever free the region
+        arena.release(region.address, region.size, isGuarded(region.secLevel));
+        return MemoryRegion();
+    }
+    {
+        std::lock_guard<StatsMutex> lock(mtx);
+        anomalyDetector.registerRegionForMonitoring(pid, region);
+    }
+    regionIndex.insert(region);
+    if (t) t->record(TraceOp::ALLOCATE_SECURE, pid, region.address, static_cast<int64_t>(size), static_cast<int64_t>(reqLevel));
+    EventLog::instance().log(LogLevel::INFO, LogEvent::SECURE_ALLOCATION, pid, static_cast<int64_t>(size));
+    return region;
+}
+
+namespace {
+    // Per-item state carried between the phases of a batch
+    struct BatchScratch {
+        MemoryRegion previous; // Null address: nothing to free
+        pid_t pid;             // -1 for a stale handle
+        int trustScore;
+        bool registered;       // Profile seen in the current phase
+    };
+    thread_local std::vector<BatchScratch> batchScratch;
+}
+
+void SecurityMemoryManager::allocateSecureMemoryBatch(const SecureRequest* requests, size_t count, MemoryRegion* results) {
+    ScopedTimer timer(callStats, TIME_ALLOCATE_BATCH);
+    TraceRecorder* t = trace.load(std::memory_order_acquire);
+    batchScratch.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        BatchScratch& s = batchScratch[i];
+        ProcessHandle h = requests[i].process;
+        s.pid = table->isLive(h) ? table->pidOf(h.slot) : -1;
+        // Frees are recorded before they happen, allocations after
+        if (t && s.pid >= 0 && requests[i].previous) t->record(TraceOp::FREE_SECURE, s.pid, requests[i].previous);
+        s.registered = false;
+        s.previous = MemoryRegion();
+        void* address = requests[i].previous;
+        if (address && s.pid >= 0 &&
+            (!regionIndex.find(address, s.previous) || s.previous.address != address || s.previous.pid != s.pid)) {
+            s.previous = MemoryRegion();
+        }
+        results[i] = MemoryRegion();
+    }
+    auto handleOf = [&](size_t i) { return requests[i].process; };
+    processSecurityProfiles.findBatch(count, handleOf, [&](size_t i, SecurityProfile& profile) {
+        BatchScratch& s = batchScratch[i];
+        s.registered = true;
+        s.trustScore = profile.trustScore;
+        // A previous region mid-cipher is released by its pass
+        if (s.previous.address &&
+            (profile.regions.erase(s.previous.address) == 0 || profile.ciphering.count(s.previous.address))) {
+            s.previous = MemoryRegion();
+        }
+    });
+    for (size_t i = 0; i < count; ++i) {
+        BatchScratch& s = batchScratch[i];
+        if (!s.registered) continue;
+        if (s.previous.address) releaseRegion(s.previous);
+        results[i] = buildRegion(s.pid, requests[i].size, requests[i].secLevel, s.trustScore);
+        s.registered = false;
+    }
+    processSecurityProfiles.findBatch(count, handleOf, [&](size_t i, SecurityProfile& profile) {
+        if (!results[i].address) return;
+        profile.regions.insert(results[i].address);
+        batchScratch[i].registered = true;
+    });
+    for (size_t i = 0; i < count; ++i) {
+        // Unregistered meanwhile; nobody would ever free the region
+        if (results[i].address && !batchScratch[i].registered) {
+            arena.release(results[i].address, results[i].size, isGuarded(results[i].secLevel));
+            results[i] = MemoryRegion();
+        }
+    }
+    {
+        std::lock_guard<StatsMutex> lock(mtx);
+        for (size_t i = 0; i < count; ++i) {
+            if (results[i].address) anomalyDetector.registerRegionForMonitoring(batchScratch[i].pid, results[i]);
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (!results[i].address) continue;
+        regionIndex.insert(results[i]);
+        EventLog::instance().log(LogLevel::INFO, LogEvent::SECURE_ALLOCATION, batchScratch[i].pid,
+                                 static_cast<int64_t>(requests[i].size));
+    }
+    if (!t) return;
+    for (size_t i = 0; i < count; ++i) {
+        if (batchScratch[i].pid < 0) continue;
+        t->record(TraceOp::ALLOCATE_SECURE, batchScratch[i].pid, results[i].address,
+                  static_cast<int64_t>(requests[i].size), static_cast<int64_t>(requests[i].secLevel));
+    }
+}
+
+// Allocate and protect a region; the caller records it in the profile,
+// the detector and the index
+MemoryRegion SecurityMemoryManager::buildRegion(pid_t pid, size_t size, SecurityLevel reqLevel, int trustScore) {
+    MemoryProtectionLevel protLevel = determineProtectionLevel(reqLevel, trustScore);
+    // Exactly one backing block per region: enclaves replace the plain allocation
+    bool enclave = protLevel == MemoryProtectionLevel::FULLY_SECURED ||
+                   (protLevel == MemoryProtectionLevel::HARDWARE_ISOLATED && hardwareSupportsIsolation());
     MemoryRegion region;
-    region.address = memoryAllocator_allocate(size);
-    region.size = size;
-    region.secLevel = reqLevel;
-    switch (protLevel) {
-        case MemoryProtectionLevel::ENCRYPTED:
-            applyMemoryEncryption(region);
-            break;
-        case MemoryProtectionLevel::HARDWARE_ISOLATED:
-            if (hardwareSupportsIsolation()) {
-                region = createHardwareSecureEnclave(size);
-            } else {
-                applyMemoryEncryption(region);
-            }
-            break;
-        case MemoryProtectionLevel::FULLY_SECURED:
-            region = createHardwareSecureEnclave(size);
-            applyMemoryEncryption(region);
-            applyAccessPatternObfuscation(region);
-            break;
-        default:
-            break;
-    }
-    anomalyDetector.registerRegionForMonitoring(pid, region);
-    std::cout << "Allocated secure memory for PID: " << pid << std::endl;
+    if (enclave) {
+        region = createHardwareSecureEnclave(size);
+    } else {
+        region.allocTime = std::time(nullptr);
+        region.address = memoryAllocator_allocate(size, reqLevel);
+        region.size = size;
+        region.secLevel = reqLevel;
+    }
+    region.pid = pid;
+    if (!region.address) return region;
+    // MEDIUM and HIGH regions are handed out encrypted at rest (the zeroed
+    // memory under a fresh keystream); the owner's first validated access
+    // decrypts them. Nothing else can see the region yet.
+    if (region.secLevel != SecurityLevel::LOW) applyMemoryEncryption(region);
+    if (protLevel == MemoryProtectionLevel::FULLY_SECURED) applyAccessPatternObfuscation(region);
     return region;
 }
 
 void SecurityMemoryManager::monitorMemoryAccess() {
-    std::lock_guard<std::mutex> lock(mtx);
+    ScopedTimer timer(callStats, TIME_MONITOR);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::MONITOR_ACCESS, 0);
+    std::lock_guard<StatsMutex> lock(mtx);
     auto anomalies = anomalyDetector.detectAnomalies();
     for (const auto& anomaly : anomalies) {
         if (anomaly.severity > CRITICAL_THRESHOLD) {
             handleSecurityBreach(anomaly);
         } else {
             logSuspiciousActivity(anomaly);
-            auto& secProfile = processSecurityProfiles[anomaly.pid];
-            secProfile.trustScore -= anomaly.severity;
+            processSecurityProfiles.find(anomaly.pid, [&](SecurityProfile& profile) {
+                profile.trustScore -= anomaly.severity;
+            });
         }
     }
 }
 
+bool SecurityMemoryManager::freeSecureMemory(pid_t pid, void* address) {
+    ScopedTimer timer(callStats, TIME_FREE);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::FREE_SECURE, pid, address);
+    MemoryRegion region;
+    if (!regionIndex.find(address, region) || region.address != address || region.pid != pid) return false;
+    bool owned = false, pinned = false;
+    processSecurityProfiles.find(pid, [&](SecurityProfile& profile) {
+        owned = profile.regions.erase(address) != 0;
+        pinned = owned && profile.ciphering.count(address);
+    });
+    if (!owned) return false;
+    // A region mid-cipher is released by its pass
+    if (!pinned) releaseRegion(region);
+    return true;
+}
+
+void SecurityMemoryManager::releaseRegion(const MemoryRegion& region) {
+    regionIndex.erase(region.address, region.size);
+    arena.release(region.address, region.size, isGuarded(region.secLevel));
+}
+
+bool SecurityMemoryManager::encryptMemory(pid_t pid, void* address) {
+    ScopedTimer timer(callStats, TIME_ENCRYPT);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::ENCRYPT, pid, address);
+    return setEncrypted(pid, address, true);
+}
+
+bool SecurityMemoryManager::decryptMemory(pid_t pid, void* address) {
+    ScopedTimer timer(callStats, TIME_DECRYPT);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) t->record(TraceOp::DECRYPT, pid, address);
+    return setEncrypted(pid, address, false);
+}
+
+// The region is pinned under the owner's profile stripe, ciphered outside
+// it, and its new keyId published under the stripe again. Toggles of one
+// region are serialised by the pin: a second one waits for the pass to end
+// and looks again. A free meanwhile leaves the release to the pass, so the
+// cipher never runs over memory handed back to the arena.
+bool SecurityMemoryManager::setEncrypted(pid_t pid, void* address, bool encrypted) {
+    MemoryRegion region;
+    for (;;) {
+        bool pinned = false, busy = false;
+        uint64_t finished = 0;
+        processSecurityProfiles.find(pid, [&](SecurityProfile& profile) {
+            if (!profile.regions.count(address)) return;
+            if (!regionIndex.find(address, region) || region.address != address || region.pid != pid) return;
+            if (region.secLevel == SecurityLevel::LOW) return;
+            if (profile.ciphering.count(address)) {
+                std::lock_guard<std::mutex> lock(cipherMtx);
+                finished = cipherPassesFinished;
+                busy = true;
+                return;
+            }
+            if ((region.keyId != 0) == encrypted) return;
+            profile.ciphering.insert(address);
+            pinned = true;
+        });
+        if (pinned) break;
+        if (!busy) return false;
+        std::unique_lock<std::mutex> lock(cipherMtx);
+        cipherCv.wait(lock, [&] { return cipherPassesFinished != finished; });
+    }
+
+    if (encrypted) {
+        applyMemoryEncryption(region);
+    } else {
+        xorKeystream(region);
+        region.keyId = 0;
+    }
+    bool live = false;
+    processSecurityProfiles.find(pid, [&](SecurityProfile& profile) {
+        profile.ciphering.erase(address);
+        live = profile.regions.count(address) != 0;
+        if (live) regionIndex.insert(region);
+    });
+    if (!live) releaseRegion(region);
+    {
+        std::lock_guard<std::mutex> lock(cipherMtx);
+        cipherPassesFinished++;
+    }
+    cipherCv.notify_all();
+    return live;
+}
+
 bool SecurityMemoryManager::validateMemoryAccess(pid_t pid, void* address, size_t size, AccessType access) {
-    std::lock_guard<std::mutex> lock(mtx);
-    auto region = findMemoryRegion(address);
-    if (!region) return true;
-    return checkAccessRights(pid, region, access);
+    ScopedTimer timer(callStats, TIME_VALIDATE);
+    if (TraceRecorder* t = trace.load(std::memory_order_acquire)) {
+        t->record(TraceOp::VALIDATE_ACCESS, pid, address, static_cast<int64_t>(size), static_cast<int64_t>(access));
+    }
+    MemoryRegion region;
+    if (!findMemoryRegion(address, region)) {
+        anomalyDetector.record(pid, address, size, access, AnomalyDetector::Outcome::UNTRACKED);
+        return true;
+    }
+    bool allowed = checkAccessRights(pid, region, address, size, access);
+    anomalyDetector.record(pid, address, size, access,
+                           allowed ? AnomalyDetector::Outcome::IN_REGION : AnomalyDetector::Outcome::VIOLATION);
+    // Encrypted at rest: the owner gets plaintext (or the region is gone)
+    // by the time the access is allowed
+    if (allowed && region.keyId != 0) setEncrypted(pid, region.address, false);
+    return allowed;
+}
+
+void SecurityMemoryManager::saveState(const ProcessHandle* handles, size_t count, Snapshot::ProcessRecord* processes,
+                                      Snapshot::SecurityRecord* records) {
+    for (size_t i = 0; i < count; ++i) records[i] = Snapshot::SecurityRecord{};
+    processSecurityProfiles.findBatch(count, [&](size_t i) { return handles[i]; }, [&](size_t i, SecurityProfile& p) {
+        records[i].trustScore = p.trustScore;
+        processes[i].managers |= Snapshot::IN_SECURITY;
+    });
+}
+
+void SecurityMemoryManager::restoreState(const ProcessHandle* handles, size_t count,
+                                         const Snapshot::ProcessRecord* processes,
+                                         const Snapshot::SecurityRecord* records) {
+    auto handleOf = [&](size_t i) {
+        return processes[i].managers & Snapshot::IN_SECURITY ? handles[i] : ProcessHandle();
+    };
+    processSecurityProfiles.updateBatch(count, handleOf, [&](size_t i, SecurityProfile& p) {
+        p = SecurityProfile();
+        p.trustScore = records[i].trustScore;
+    });
 }
 
 std::vector<pid_t> SecurityMemoryManager::getAllPIDs() {
-    std::lock_guard<std::mutex> lock(mtx);
+    ScopedTimer timer(callStats, TIME_ALL_PIDS);
     std::vector<pid_t> pids;
-    for (const auto& [pid, _] : processSecurityProfiles) pids.push_back(pid);
+    processSecurityProfiles.forEach([&](pid_t pid, const SecurityProfile&) { pids.push_back(pid); });
     return pids;
 }
 
@@ -80,22 +338,41 @@ SecurityMemoryManager::MemoryProtectionLevel SecurityMemoryManager::determinePro
     if (req == SecurityLevel::MEDIUM) return MemoryProtectionLevel::ENCRYPTED;
     return MemoryProtectionLevel::STANDARD;
 }
-void* SecurityMemoryManager::memoryAllocator_allocate(size_t sz) { return malloc(sz); }
-void SecurityMemoryManager::applyMemoryEncryption(MemoryRegion&) {/* Stub */}
+void* SecurityMemoryManager::memoryAllocator_allocate(size_t sz, SecurityLevel level) {
+    return arena.allocate(sz, isGuarded(level));
+}
+void SecurityMemoryManager::applyMemoryEncryption(MemoryRegion& region) {
+    region.keyId = nextKeyId.fetch_add(1, std::memory_order_relaxed);
+    xorKeystream(region);
+}
+void SecurityMemoryManager::xorKeystream(const MemoryRegion& region) {
+    Crypto::Nonce nonce{{static_cast<uint32_t>(region.keyId), static_cast<uint32_t>(region.keyId >> 32), nonceSalt}};
+    Crypto::chacha20Xor(static_cast<uint8_t*>(region.address), region.size, masterKey, nonce);
+}
 bool SecurityMemoryManager::hardwareSupportsIsolation() { return false; }
 MemoryRegion SecurityMemoryManager::createHardwareSecureEnclave(size_t sz) {
     MemoryRegion r;
-    r.address = malloc(sz);
+    r.address = memoryAllocator_allocate(sz, SecurityLevel::HIGH);
     r.size = sz;
+    r.allocTime = std::time(nullptr);
     r.secLevel = SecurityLevel::HIGH;
     return r;
 }
 void SecurityMemoryManager::applyAccessPatternObfuscation(MemoryRegion&) {/* Stub */}
 void SecurityMemoryManager::handleSecurityBreach(const Anomaly& a) {
-    std::cout << "SECURITY BREACH! PID: " << a.pid << ", Severity: " << a.severity << std::endl;
+    EventLog::instance().log(LogLevel::ERROR, LogEvent::SECURITY_BREACH, a.pid, a.severity);
 }
 void SecurityMemoryManager::logSuspiciousActivity(const Anomaly& a) {
-    std::cout << "Suspicious activity. PID: " << a.pid << ", Severity: " << a.severity << std::endl;
+    EventLog::instance().log(LogLevel::WARN, LogEvent::SUSPICIOUS_ACTIVITY, a.pid, a.severity);
+}
+bool SecurityMemoryManager::findMemoryRegion(void* address, MemoryRegion& out) {
+    return regionIndex.find(address, out);
+}
+bool SecurityMemoryManager::checkAccessRights(pid_t pid, const MemoryRegion& region, void* address, size_t size, AccessType access) {
+    // Only the owner may touch a secure region, and never past its end
+    if (region.pid != pid) return false;
+    size_t offset = static_cast<size_t>(static_cast<char*>(address) - static_cast<char*>(region.address));
+    if (size > region.size - offset) return false;
+    // Secure regions hold data, not code
+    return access != AccessType::EXECUTE || region.secLevel == SecurityLevel::LOW;
 }
-MemoryRegion* SecurityMemoryManager::findMemoryRegion(void* address) { return nullptr; /* Stub */ }
-bool SecurityMemoryManager::checkAccessRights(pid_t, MemoryRegion*, AccessType) { return true; }
@@ -2,55 +2,127 @@
 #define SECURITY_MEMORY_MANAGER_H
 
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <ctime>
 #include <iostream>
-
-using pid_t = int;
-
-enum class SecurityLevel { LOW, MEDIUM, HIGH };
-enum class AccessType { READ, WRITE, EXECUTE };
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include "memory_region.h"
+#include "process_table.h"
+#include "slot_store.h"
+#include "address_range_index.h"
+#include "secure_arena.h"
+#include "memory_cipher.h"
+#include "anomaly_detector.h"
+#include "trace_log.h"
+#include "snapshot_format.h"
+#include "manager_stats.h"
+#include <atomic>
 
 struct SecurityProfile {
     int trustScore = 100;
+    std::unordered_set<void*> regions; // Live secure allocations, released with the process
+    // Regions with a cipher pass running outside the stripe; a region freed
+    // meanwhile is released by that pass instead
+    std::unordered_set<void*> ciphering;
 };
 
-struct MemoryRegion {
-    void* address;
+// One entry of a batched secure allocation; `previous` (when non-null and
+// owned by pid) is freed first, as with freeSecureMemory
+struct SecureRequest {
+    ProcessHandle process;
     size_t size;
     SecurityLevel secLevel;
-};
-
-struct Anomaly {
-    pid_t pid;
-    int severity;
-};
-
-struct AnomalyDetector {
-    void registerRegionForMonitoring(pid_t, const MemoryRegion&) {/* Stub */}
-    std::vector<Anomaly> detectAnomalies() { return {}; }
+    void* previous;
 };
 
 class SecurityMemoryManager {
 public:
-    SecurityMemoryManager();
-    // Register a process for security tracking
-    void registerProcess(pid_t pid);
-    // Remove a process
+    // HIGH regions get a trailing guard page unless guardHighRegions is false
+    explicit SecurityMemoryManager(bool guardHighRegions = true);
+    // Per-process state is keyed by slots of a table that may be shared
+    explicit SecurityMemoryManager(std::shared_ptr<ProcessTable> table, bool guardHighRegions = true);
+    // Register a process for security tracking; only registered processes
+    // can allocate secure memory
+    ProcessHandle registerProcess(pid_t pid);
+    // Remove a process and release all of its secure memory
     void unregisterProcess(pid_t pid);
     // Allocate secure memory for a process
     MemoryRegion allocateSecureMemory(pid_t pid, size_t size, SecurityLevel reqLevel);
-    // Monitor all memory access for anomalies
+    MemoryRegion allocateSecureMemory(ProcessHandle process, size_t size, SecurityLevel reqLevel);
+    // Batched free-then-allocateSecureMemory: every profile shard and the
+    // manager mutex are locked at most once per phase. results[i] receives the
+    // region; its address is null if the allocation failed.
+    void allocateSecureMemoryBatch(const SecureRequest* requests, size_t count, MemoryRegion* results);
+    // Wipe and return a region; false if address is not a region owned by pid
+    bool freeSecureMemory(pid_t pid, void* address);
+    // Score processes that made validated accesses since the last call and
+    // adjust their trust; cost is O(processes with new accesses)
     void monitorMemoryAccess();
-    // Validate a memory access
+    // Encrypt a plaintext region in place under a fresh nonce / decrypt it back.
+    // False if address is not a MEDIUM or HIGH region owned by pid, or is
+    // already in that state. Waits for a pass another thread is running on
+    // the region.
+    bool encryptMemory(pid_t pid, void* address);
+    bool decryptMemory(pid_t pid, void* address);
+    // Validate a memory access. Addresses outside any secure region are
+    // allowed; inside one, the access must stay in bounds and match its rights.
+    // An allowed access to an encrypted region decrypts it first, so MEDIUM
+    // and HIGH regions stay encrypted at rest until their owner touches them.
+    // Every call is fed to the anomaly detector. Never takes the manager
+    // mutex; safe from many threads.
     bool validateMemoryAccess(pid_t pid, void* address, size_t size, AccessType access);
     // For simulation: get all known PIDs
     std::vector<pid_t> getAllPIDs();
+    // Record every call above that changes state or is validated (nullptr
+    // stops); the recorder must outlive its attachment
+    void setTraceRecorder(TraceRecorder* recorder) { trace.store(recorder, std::memory_order_release); }
+    // Snapshot support (state_snapshot.h): trust scores of the given
+    // processes, setting IN_SECURITY for those registered here. Restored
+    // processes hold no regions.
+    void saveState(const ProcessHandle* handles, size_t count, Snapshot::ProcessRecord* processes,
+                   Snapshot::SecurityRecord* records);
+    void restoreState(const ProcessHandle* handles, size_t count, const Snapshot::ProcessRecord* processes,
+                      const Snapshot::SecurityRecord* records);
+    // Latency of each call above (pid overloads are timed through the handle
+    // overload they call) and contention on mtx; see manager_stats.h
+    std::string statsSnapshot(StatsFormat format = StatsFormat::JSON) { return callStats.snapshot(format); }
+    void setStatsEnabled(bool on) { callStats.setEnabled(on); }
 
 private:
-    std::unordered_map<pid_t, SecurityProfile> processSecurityProfiles;
+    std::shared_ptr<ProcessTable> table;
+    SlotStore<SecurityProfile> processSecurityProfiles;
+    // Every region handed out by allocateSecureMemory, by address
+    AddressRangeIndex<> regionIndex;
+    SecureArena arena;
+    const bool guardHighRegions;
+    // One random ChaCha20 key per manager; every encryption takes a fresh
+    // 64-bit id which, with a per-manager salt, forms the 96-bit nonce, so no
+    // keystream is ever reused
+    const Crypto::Key masterKey;
+    const uint32_t nonceSalt;
+    std::atomic<uint64_t> nextKeyId{1};
+    // A toggle finding its region mid-cipher waits on cipherCv until the
+    // pass bumps cipherPassesFinished; cipherMtx is a leaf lock
+    std::mutex cipherMtx;
+    std::condition_variable cipherCv;
+    uint64_t cipherPassesFinished = 0;
+    // Guards the anomaly detector's consumer side; recording is lock-free
     AnomalyDetector anomalyDetector;
-    std::mutex mtx;
+    enum Timed : size_t {
+        TIME_REGISTER, TIME_UNREGISTER, TIME_ALLOCATE, TIME_ALLOCATE_BATCH, TIME_MONITOR, TIME_FREE, TIME_ENCRYPT,
+        TIME_DECRYPT, TIME_VALIDATE, TIME_ALL_PIDS, TIMED_COUNT
+    };
+    static constexpr const char* TIMED_NAMES[TIMED_COUNT] = {
+        "registerProcess", "unregisterProcess", "allocateSecureMemory", "allocateSecureMemoryBatch",
+        "monitorMemoryAccess", "freeSecureMemory", "encryptMemory", "decryptMemory", "validateMemoryAccess",
+        "getAllPIDs"
+    };
+    ManagerStats callStats{"security", TIMED_NAMES, TIMED_COUNT};
+    StatsMutex mtx{callStats};
+    std::atomic<TraceRecorder*> trace{nullptr};
     const int CRITICAL_THRESHOLD = 80;
 
     enum class MemoryProtectionLevel {
@@ -61,15 +133,20 @@ private:
     };
 
     MemoryProtectionLevel determineProtectionLevel(SecurityLevel req, int trust);
-    void* memoryAllocator_allocate(size_t sz);
+    bool isGuarded(SecurityLevel level) const { return guardHighRegions && level == SecurityLevel::HIGH; }
+    MemoryRegion buildRegion(pid_t pid, size_t size, SecurityLevel reqLevel, int trustScore);
+    void* memoryAllocator_allocate(size_t sz, SecurityLevel level);
+    void releaseRegion(const MemoryRegion& region);
     void applyMemoryEncryption(MemoryRegion&);
+    void xorKeystream(const MemoryRegion& region);
+    bool setEncrypted(pid_t pid, void* address, bool encrypted);
     bool hardwareSupportsIsolation();
     MemoryRegion createHardwareSecureEnclave(size_t sz);
     void applyAccessPatternObfuscation(MemoryRegion&);
     void handleSecurityBreach(const Anomaly& a);
     void logSuspiciousActivity(const Anomaly& a);
-    MemoryRegion* findMemoryRegion(void* address);
-    bool checkAccessRights(pid_t, MemoryRegion*, AccessType);
+    bool findMemoryRegion(void* address, MemoryRegion& out);
+    bool checkAccessRights(pid_t, const MemoryRegion&, void* address, size_t size, AccessType);
 };
 
 #endif // SECURITY_MEMORY_MANAGER_H
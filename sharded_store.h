@@ -0,0 +1,174 @@
+#ifndef SHARDED_STORE_H
+#define SHARDED_STORE_H
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+#include "cache_line.h"
+
+using pid_t = int;
+
+// Per-PID state store striped over ShardCount independently locked shards.
+// A PID always hashes to the same shard, so producers working on different
+// processes rarely contend. Each shard sits on its own cache line(s) to avoid
+// false sharing between neighbouring locks.
+//
+// Optionally records which PIDs changed since the last drainChanged() so that
+// consumers can do incremental work instead of rescanning every entry.
+template <typename Value, size_t ShardCount = 64>
+class ShardedStore {
+    static_assert((ShardCount & (ShardCount - 1)) == 0, "ShardCount must be a power of two");
+
+public:
+    explicit ShardedStore(bool trackChanges = false) : trackChanges(trackChanges) {}
+
+    // Run fn(Value&) on the entry for pid, creating a default one if absent.
+    // Marks the PID as changed when change tracking is enabled.
+    template <typename Fn>
+    void update(pid_t pid, Fn&& fn) {
+        Shard& shard = shardFor(pid);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        Slot& slot = shard.entries[pid];
+        fn(slot.value);
+        if (trackChanges && !slot.changed) {
+            slot.changed = true;
+            shard.changed.push_back(pid);
+        }
+    }
+
+    // Batched update(): run fn(i, Value&) for every i in [0, count) on the entry
+    // for pidOf(i). Items are bucketed by shard first, so each shard's lock is
+    // taken at most once per call; within a shard, items keep index order.
+    // The bucketing scratch is kept per thread, so steady-state calls do not
+    // allocate.
+    template <typename PidOf, typename Fn>
+    void updateBatch(size_t count, PidOf&& pidOf, Fn&& fn) {
+        thread_local std::vector<uint32_t> scratch;
+        // Taken rather than borrowed, so a nested batch simply gets its own
+        std::vector<uint32_t> order = std::move(scratch);
+        order.resize(count);
+        size_t start[ShardCount + 1] = {};
+        for (size_t i = 0; i < count; ++i) start[shardIndex(pidOf(i)) + 1]++;
+        for (size_t s = 0; s < ShardCount; ++s) start[s + 1] += start[s];
+        size_t fill[ShardCount];
+        std::copy(start, start + ShardCount, fill);
+        for (size_t i = 0; i < count; ++i) order[fill[shardIndex(pidOf(i))]++] = static_cast<uint32_t>(i);
+
+        for (size_t s = 0; s < ShardCount; ++s) {
+            if (start[s] == start[s + 1]) continue;
+            Shard& shard = shards[s];
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            for (size_t k = start[s]; k < start[s + 1]; ++k) {
+                size_t i = order[k];
+                pid_t pid = pidOf(i);
+                Slot& slot = shard.entries[pid];
+                fn(i, slot.value);
+                if (trackChanges && !slot.changed) {
+                    slot.changed = true;
+                    shard.changed.push_back(pid);
+                }
+            }
+        }
+        scratch = std::move(order);
+    }
+
+    // Run fn(Value&) on the entry for pid if it exists; returns false otherwise
+    template <typename Fn>
+    bool find(pid_t pid, Fn&& fn) {
+        Shard& shard = shardFor(pid);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto it = shard.entries.find(pid);
+        if (it == shard.entries.end()) return false;
+        fn(it->second.value);
+        return true;
+    }
+
+    // Mark an existing entry as changed without modifying it
+    void touch(pid_t pid) {
+        if (!trackChanges) return;
+        Shard& shard = shardFor(pid);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto it = shard.entries.find(pid);
+        if (it == shard.entries.end() || it->second.changed) return;
+        it->second.changed = true;
+        shard.changed.push_back(pid);
+    }
+
+    // Insert or overwrite the entry for pid
+    void insert(pid_t pid, const Value& value) {
+        update(pid, [&](Value& v) { v = value; });
+    }
+
+    bool erase(pid_t pid) {
+        Shard& shard = shardFor(pid);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        return shard.entries.erase(pid) != 0;
+    }
+
+    bool contains(pid_t pid) {
+        Shard& shard = shardFor(pid);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        return shard.entries.count(pid) != 0;
+    }
+
+    size_t size() {
+        size_t total = 0;
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            total += shard.entries.size();
+        }
+        return total;
+    }
+
+    // Visit every entry as fn(pid, Value&), locking one shard at a time
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            for (auto& [pid, slot] : shard.entries) fn(pid, slot.value);
+        }
+    }
+
+    // Visit entries changed since the previous drain as fn(pid, const Value&)
+    // and clear their changed marks. Entries erased in between are skipped.
+    template <typename Fn>
+    void drainChanged(Fn&& fn) {
+        for (auto& shard : shards) {
+            std::lock_guard<std::mutex> lock(shard.mtx);
+            for (pid_t pid : shard.changed) {
+                auto it = shard.entries.find(pid);
+                if (it == shard.entries.end() || !it->second.changed) continue;
+                it->second.changed = false;
+                fn(pid, static_cast<const Value&>(it->second.value));
+            }
+            shard.changed.clear();
+        }
+    }
+
+    static size_t shardIndex(pid_t pid) {
+        // Fibonacci hashing spreads consecutive PIDs across shards
+        uint32_t h = static_cast<uint32_t>(pid) * 2654435769u;
+        return (h >> 16) & (ShardCount - 1);
+    }
+
+private:
+    struct Slot {
+        Value value{};
+        bool changed = false;
+    };
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        std::mutex mtx;
+        std::unordered_map<pid_t, Slot> entries;
+        std::vector<pid_t> changed;
+    };
+
+    Shard shards[ShardCount];
+    const bool trackChanges;
+
+    Shard& shardFor(pid_t pid) { return shards[shardIndex(pid)]; }
+};
+
+#endif // SHARDED_STORE_H
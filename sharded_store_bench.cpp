@@ -0,0 +1,76 @@
+// sharded_store_bench.cpp
+// Contention benchmark: per-PID update throughput from 1 to 64 producer threads,
+// comparing a single-lock store, the 64-way sharded store, and the scheduler's
+// updateUsageMetrics path that is built on it.
+#include "adaptive_scheduler.h"
+#include "sharded_store.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+
+constexpr int NUM_PIDS = 100000;
+constexpr int TOTAL_OPS = 4000000;
+constexpr int MAX_THREADS = 64;
+
+// Run `perThread(threadIndex, opsPerThread)` on `threads` threads; returns ops/sec
+template <typename Fn>
+double measure(int threads, Fn&& perThread) {
+    int opsPerThread = TOTAL_OPS / threads;
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] { perThread(t, opsPerThread); });
+    }
+    for (auto& w : workers) w.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(opsPerThread) * threads / elapsed.count();
+}
+
+template <size_t Shards>
+double benchStore(int threads) {
+    ShardedStore<UsageMetrics, Shards> store;
+    for (pid_t pid = 0; pid < NUM_PIDS; ++pid) store.insert(pid, UsageMetrics());
+    return measure(threads, [&](int t, int ops) {
+        std::mt19937 rng(t + 1);
+        std::uniform_int_distribution<pid_t> pidDist(0, NUM_PIDS - 1);
+        for (int i = 0; i < ops; ++i) {
+            store.update(pidDist(rng), [&](UsageMetrics& m) {
+                m.interactionCount++;
+                m.cpuUsage = i & 127;
+            });
+        }
+    });
+}
+
+double benchScheduler(int threads) {
+    AdaptiveScheduler scheduler;
+    for (pid_t pid = 0; pid < NUM_PIDS; ++pid) scheduler.registerProcess(pid, "bench");
+    return measure(threads, [&](int t, int ops) {
+        std::mt19937 rng(t + 1);
+        std::uniform_int_distribution<pid_t> pidDist(0, NUM_PIDS - 1);
+        for (int i = 0; i < ops; ++i) {
+            scheduler.updateUsageMetrics(pidDist(rng), {ApplicationEvent::OTHER, 0}, i & 127, i & 63);
+        }
+    });
+}
+
+int main() {
+    std::cout << "Update throughput (Mops/s), " << TOTAL_OPS << " updates over " << NUM_PIDS << " PIDs\n";
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << "\n\n";
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "single-lock"
+              << std::setw(14) << "sharded-64" << std::setw(14) << "scheduler" << "\n";
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        double single = benchStore<1>(threads);
+        double sharded = benchStore<64>(threads);
+        double sched = benchScheduler(threads);
+        std::cout << std::fixed << std::setprecision(2)
+                  << std::setw(8) << threads
+                  << std::setw(14) << single / 1e6
+                  << std::setw(14) << sharded / 1e6
+                  << std::setw(14) << sched / 1e6 << "\n";
+    }
+    return 0;
+}
@@ -1,89 +1,387 @@
 // simulation.cpp
-// Simulates 100-200 processes, resource usage, and optimization using all three modules
+// Simulates 100-200 processes, resource usage, and optimization using all three modules.
+// Processes are split into fixed partitions that a TickDriver pool works
+// through in parallel; system-wide analysis runs once per tick at the barrier.
+// Each partition is handed to the managers' batch APIs in one call per manager.
+//
+// Usage: os_simulation [--threads N] [--processes N] [--ticks N] [--seed N] [--scaling] [--unbatched]
+//                      [--no-rebalance] [--slow-tier memory|file|compressed] [--record FILE]
+//                      [--snapshot FILE] [--restore FILE] [--stats json|prometheus]
+// --scaling reruns the same workload on 1, 2, 4, .. threads and reports ticks/sec.
+// --unbatched makes one manager call per process instead, for comparison.
+// --no-rebalance keeps tier placement fixed by security level, for comparison.
+// --slow-tier picks where the slow tier keeps blocks: anonymous memory, the swap
+// file (the default) or compressed in memory.
+// --record writes every manager call to a trace for trace_replay.
+// --snapshot saves the managers' learned state to FILE every second in the
+// background and once at the end; --restore starts from such a file, so a
+// later run with the same --seed picks up where that one stopped.
+// --stats prints each manager's call latencies and lock wait and hold times
+// at the end (manager_stats.h).
 #include "adaptive_scheduler.h"
 #include "adaptive_memory_manager.h"
 #include "security_memory_manager.h"
+#include "event_log.h"
+#include "state_snapshot.h"
+#include "tick_driver.h"
+#include "trace_log.h"
+#include "workload.h"
+#include <algorithm>
 #include <iostream>
+#include <iomanip>
 #include <vector>
-#include <random>
 #include <chrono>
+#include <cstdlib>
+#include <string>
 #include <thread>
 
 constexpr int NUM_PROCESSES = 150;
 constexpr int SIMULATION_TICKS = 500;
-constexpr int MAX_CPU = 100;
-constexpr int MAX_IO = 100;
-constexpr int MAX_MEM = 16384; // 16MB
+// Processes per partition, the unit of work taken and stolen by the driver:
+// about PARTITIONS_PER_THREAD partitions per worker, within these bounds.
+// Large partitions make large batches, which share shard locks.
+constexpr size_t MIN_PARTITION_SIZE = 16;
+constexpr size_t MAX_PARTITION_SIZE = 1024;
+constexpr size_t PARTITIONS_PER_THREAD = 8;
+constexpr auto SNAPSHOT_INTERVAL = std::chrono::seconds(1);
 
-struct SimProcess {
-    pid_t pid;
-    std::string name;
-    int cpuProfile; // 0=light, 1=medium, 2=heavy
-    int ioProfile;  // 0=light, 1=medium, 2=heavy
-    int memProfile; // 0=light, 1=medium, 2=heavy
-    SecurityLevel secLevel;
-    size_t memAllocated;
-};
+namespace {
+    struct Options {
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        int processes = NUM_PROCESSES;
+        int ticks = SIMULATION_TICKS;
+        // A different run every time unless --seed is given
+        uint64_t seed = static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+        bool scaling = false;
+        bool batched = true;
+        bool rebalance = true;
+        SlowTierMode slowTier = SlowTierMode::SWAP_FILE;
+        std::string recordPath;
+        std::string snapshotPath;
+        std::string restorePath;
+        std::string statsFormat; // Empty: no statistics
+    };
 
-int main() {
-    AdaptiveScheduler scheduler;
-    AdaptiveMemoryManager memManager;
-    SecurityMemoryManager secManager;
-    std::vector<SimProcess> processes;
-    std::mt19937 rng((unsigned int)std::chrono::system_clock::now().time_since_epoch().count());
-    std::uniform_int_distribution<int> profileDist(0,2);
-    std::uniform_int_distribution<int> secDist(0,2);
-    std::uniform_int_distribution<int> cpuDist(1,MAX_CPU);
-    std::uniform_int_distribution<int> ioDist(1,MAX_IO);
-    std::uniform_int_distribution<int> memDist(1024,MAX_MEM);
+    struct RunResult {
+        double seconds;
+        uint64_t digest; // Order-independent hash of every event processed
+        uint64_t stolen;
+        size_t totalMemory;
+        ReservationStats reservations;
+        TieringStats tiering;
+        CompressionStats compression;
+        SnapshotStats restored;
+        SnapshotStats saved;
+        uint64_t snapshots = 0;
+        std::string stats; // Managers' statistics, in opts.statsFormat
+    };
 
-    // 1. Create processes
-    for (int i = 0; i < NUM_PROCESSES; ++i) {
-        pid_t pid = 1000 + i;
-        std::string name = "proc_" + std::to_string(pid);
-        int cpuP = profileDist(rng);
-        int ioP = profileDist(rng);
-        int memP = profileDist(rng);
-        SecurityLevel sec = static_cast<SecurityLevel>(secDist(rng));
-        processes.push_back({pid, name, cpuP, ioP, memP, sec, 0});
-        scheduler.registerProcess(pid, name);
-        memManager.registerProcess(pid);
-        secManager.registerProcess(pid);
+    struct alignas(CACHE_LINE_SIZE) WorkerTotals {
+        uint64_t digest = 0;
+    };
+
+    bool parseOptions(int argc, char** argv, Options& opts) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--scaling") {
+                opts.scaling = true;
+                continue;
+            }
+            if (arg == "--unbatched") {
+                opts.batched = false;
+                continue;
+            }
+            if (arg == "--no-rebalance") {
+                opts.rebalance = false;
+                continue;
+            }
+            if (i + 1 >= argc) return false;
+            const char* value = argv[++i];
+            if (arg == "--threads") opts.threads = static_cast<unsigned>(std::atoi(value));
+            else if (arg == "--processes") opts.processes = std::atoi(value);
+            else if (arg == "--ticks") opts.ticks = std::atoi(value);
+            else if (arg == "--seed") opts.seed = std::strtoull(value, nullptr, 10);
+            else if (arg == "--record") opts.recordPath = value;
+            else if (arg == "--snapshot") opts.snapshotPath = value;
+            else if (arg == "--restore") opts.restorePath = value;
+            else if (arg == "--stats" && (std::string(value) == "json" || std::string(value) == "prometheus")) {
+                opts.statsFormat = value;
+            }
+            else if (arg != "--slow-tier" || !parseSlowTierMode(value, opts.slowTier)) return false;
+        }
+        return opts.threads > 0 && opts.threads <= 256 && opts.processes > 0 && opts.ticks > 0;
+    }
+
+    uint64_t eventDigest(const SimProcess& proc, int tick, const TickEvent& e) {
+        return workloadHash(e.mem, static_cast<uint64_t>(proc.pid), static_cast<uint64_t>(tick) << 16 | e.cpu << 8 | e.io);
+    }
+
+    // One tick of count consecutive processes through the batch APIs: one call
+    // per manager instead of one per process. Returns the partition's digest.
+    uint64_t runPartitionBatched(SimProcess* procs, size_t count, int tick, uint64_t seed, AdaptiveScheduler& scheduler,
+                                 AdaptiveMemoryManager& memManager, SecurityMemoryManager& secManager) {
+        // Batch buffers, reused by each worker across partitions and ticks
+        struct Buffers {
+            std::vector<UsageUpdate> usage;
+            std::vector<MemoryUsageSample> samples;
+            std::vector<TierRequest> tierRequests;
+            std::vector<SecureRequest> secureRequests;
+            std::vector<void*> tierResults;
+            std::vector<MemoryRegion> secureResults;
+        };
+        thread_local Buffers buf;
+        buf.usage.resize(count);
+        buf.samples.resize(count);
+        buf.tierRequests.resize(count);
+        buf.secureRequests.resize(count);
+        buf.tierResults.resize(count);
+        buf.secureResults.resize(count);
+        auto& [usage, samples, tierRequests, secureRequests, tierResults, secureResults] = buf;
+        uint64_t digest = 0;
+        for (size_t i = 0; i < count; ++i) {
+            SimProcess& proc = procs[i];
+            TickEvent e = tickEvent(proc, tick, seed);
+            proc.memAllocated = e.mem;
+            usage[i] = {proc.handle, {ApplicationEvent::OTHER, 0}, e.cpu, e.io};
+            samples[i] = {proc.handle, e.mem};
+            tierRequests[i] = {proc.handle, e.mem, proc.secLevel, proc.memAddress};
+            secureRequests[i] = {proc.handle, e.mem/4, proc.secLevel, proc.secAddress};
+            digest += eventDigest(proc, tick, e);
+        }
+        scheduler.updateUsageMetricsBatch(usage.data(), count);
+        memManager.predictMemoryNeedsBatch(samples.data(), count);
+        memManager.allocateMemoryByTierBatch(tierRequests.data(), count, tierResults.data());
+        secManager.allocateSecureMemoryBatch(secureRequests.data(), count, secureResults.data());
+        for (size_t i = 0; i < count; ++i) {
+            procs[i].memAddress = tierResults[i];
+            procs[i].secAddress = secureResults[i].address;
+            // CPU-heavy processes touch their memory more; the rebalancer follows
+            memManager.recordMemoryAccess(procs[i].handle, procs[i].memAddress, usage[i].cpuUsage);
+            // Processes touch their own secure memory; the detector learns their pattern
+            secManager.validateMemoryAccess(procs[i].pid, procs[i].secAddress, 16, AccessType::READ);
+        }
+        return digest;
     }
 
-    // 2. Simulate ticks
-    for (int tick = 0; tick < SIMULATION_TICKS; ++tick) {
-        // Each process generates resource usage
+    RunResult runSimulation(const Options& opts, unsigned threads, bool verbose, TraceRecorder* recorder = nullptr) {
+        // One process table shared by the three managers: a handle from any
+        // registration addresses the process in all of them
+        auto table = std::make_shared<ProcessTable>();
+        AdaptiveScheduler scheduler(table);
+        AdaptiveMemoryManager memManager(table, opts.slowTier);
+        SecurityMemoryManager secManager(table);
+        scheduler.setTraceRecorder(recorder);
+        memManager.setTraceRecorder(recorder);
+        secManager.setTraceRecorder(recorder);
+        TickDriver driver(threads);
+        const uint64_t seed = opts.seed;
+        RunResult result{};
+        if (!opts.restorePath.empty()) {
+            std::string error;
+            if (!restoreSnapshot(opts.restorePath, *table, scheduler, memManager, secManager, &result.restored, &error)) {
+                std::cerr << "cannot restore " << opts.restorePath << ": " << error << "\n";
+            }
+        }
+
+        // 1. Create processes; restored ones keep their learned state
+        std::vector<SimProcess> processes = makeProcesses(opts.processes, WorkloadMix::BALANCED, seed);
         for (auto& proc : processes) {
-            int cpu = cpuDist(rng) * (proc.cpuProfile+1) / 3;
-            int io = ioDist(rng) * (proc.ioProfile+1) / 3;
-            size_t mem = memDist(rng) * (proc.memProfile+1) / 3;
-            proc.memAllocated = mem;
-            scheduler.updateUsageMetrics(proc.pid, {ApplicationEvent::OTHER, 0}, cpu, io);
-            memManager.predictMemoryNeeds(proc.pid, mem);
-            memManager.allocateMemoryByTier(proc.pid, mem, proc.secLevel);
-            secManager.allocateSecureMemory(proc.pid, mem/4, proc.secLevel);
+            proc.handle = table->lookup(proc.pid);
+            if (proc.handle.valid()) continue;
+            proc.handle = scheduler.registerProcess(proc.pid, proc.name);
+            memManager.registerProcess(proc.pid);
+            secManager.registerProcess(proc.pid);
+        }
+        size_t partitionSize = std::clamp(processes.size() / (threads * PARTITIONS_PER_THREAD),
+                                          MIN_PARTITION_SIZE, MAX_PARTITION_SIZE);
+        size_t partitions = (processes.size() + partitionSize - 1) / partitionSize;
+        std::vector<WorkerTotals> totals(threads);
+        // Hot/cold tier placement adapts in the background while ticks run
+        if (opts.rebalance) memManager.startRebalancer();
+        std::unique_ptr<SnapshotSaver> saver;
+        if (!opts.snapshotPath.empty()) {
+            saver = std::make_unique<SnapshotSaver>(opts.snapshotPath, *table, scheduler, memManager, secManager);
+            saver->start(SNAPSHOT_INTERVAL);
         }
-        // System-wide analysis
-        memManager.analyzeMemoryUsage();
-        secManager.monitorMemoryAccess();
-        // Scheduler optimizes
-        auto decisions = scheduler.calculateProcessPriorities();
-        // Simulate: print top 3 scheduled
-        if (tick % 100 == 0) {
-            std::cout << "Tick " << tick << " top scheduled: ";
-            for (int i = 0; i < 3 && i < (int)decisions.size(); ++i) {
-                std::cout << decisions[i].process_id << "(P=" << decisions[i].base_priority << ") ";
+
+        // 2. Simulate ticks
+        auto start = std::chrono::steady_clock::now();
+        for (int tick = 0; tick < opts.ticks; ++tick) {
+            // Each process generates resource usage. A partition is owned by
+            // one worker for the whole tick; every event comes from
+            // (seed, pid, tick), so the stream is the same for any thread count.
+            driver.runTick(partitions, [&](unsigned worker, size_t part) {
+                size_t begin = part * partitionSize;
+                size_t end = std::min(processes.size(), begin + partitionSize);
+                if (opts.batched) {
+                    totals[worker].digest += runPartitionBatched(&processes[begin], end - begin, tick, seed,
+                                                                 scheduler, memManager, secManager);
+                    return;
+                }
+                for (size_t i = begin; i < end; ++i) {
+                    SimProcess& proc = processes[i];
+                    TickEvent e = tickEvent(proc, tick, seed);
+                    size_t mem = e.mem;
+                    proc.memAllocated = mem;
+                    scheduler.updateUsageMetrics(proc.handle, {ApplicationEvent::OTHER, 0}, e.cpu, e.io);
+                    memManager.predictMemoryNeeds(proc.handle, mem);
+                    if (proc.memAddress) memManager.freeMemory(proc.pid, proc.memAddress);
+                    proc.memAddress = memManager.allocateMemoryByTier(proc.handle, mem, proc.secLevel);
+                    if (proc.secAddress) secManager.freeSecureMemory(proc.pid, proc.secAddress);
+                    proc.secAddress = secManager.allocateSecureMemory(proc.handle, mem/4, proc.secLevel).address;
+                    memManager.recordMemoryAccess(proc.handle, proc.memAddress, e.cpu);
+                    // Processes touch their own secure memory; the detector learns their pattern
+                    secManager.validateMemoryAccess(proc.pid, proc.secAddress, 16, AccessType::READ);
+                    totals[worker].digest += eventDigest(proc, tick, e);
+                }
+            });
+            // Tick barrier: all processes are done; run system-wide work on this thread.
+            // Now and then one process probes a neighbour's secure region
+            if (tick % 50 == 49) {
+                const SimProcess& rogue = processes[workloadHash(seed, tick, 0) % processes.size()];
+                const SimProcess& victim = processes[(&rogue - processes.data() + 1) % processes.size()];
+                secManager.validateMemoryAccess(rogue.pid, victim.secAddress, 16, AccessType::READ);
+            }
+            // System-wide analysis
+            memManager.analyzeMemoryUsage();
+            secManager.monitorMemoryAccess();
+            // Scheduler optimizes: only the top few are consumed, so skip the full sort
+            auto decisions = scheduler.topK(3);
+            // Simulate: print top 3 scheduled
+            if (verbose && tick % 100 == 0) {
+                // Manager events are written asynchronously; let them catch up first
+                EventLog::instance().flush();
+                std::cout << "Tick " << tick << " top scheduled: ";
+                for (int i = 0; i < (int)decisions.size(); ++i) {
+                    std::cout << decisions[i].process_id << "(P=" << decisions[i].base_priority << ") ";
+                }
+                std::cout << std::endl;
             }
-            std::cout << std::endl;
         }
-        // Optionally: std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        memManager.stopRebalancer();
+        if (saver) {
+            saver->stop();
+            result.saved = saver->lastStats();
+            result.snapshots = saver->saves();
+        }
+        scheduler.setTraceRecorder(nullptr);
+        memManager.setTraceRecorder(nullptr);
+        secManager.setTraceRecorder(nullptr);
+
+        result.seconds = elapsed.count();
+        result.stolen = driver.stolenCount();
+        result.totalMemory = memManager.getTotalMemoryUsage();
+        result.reservations = memManager.getReservationStats();
+        result.tiering = memManager.getTieringStats();
+        result.compression = memManager.getCompressionStats();
+        for (const auto& t : totals) result.digest += t.digest;
+        if (!opts.statsFormat.empty()) {
+            StatsFormat format = opts.statsFormat == "json" ? StatsFormat::JSON : StatsFormat::PROMETHEUS;
+            result.stats = scheduler.statsSnapshot(format) + "\n" + memManager.statsSnapshot(format) + "\n" +
+                           secManager.statsSnapshot(format) + "\n";
+        }
+        return result;
+    }
+
+    void runScaling(const Options& opts) {
+        // Measure the drivers, not the console
+        EventLog::instance().setLevel(LogLevel::OFF);
+        unsigned maxThreads = std::max(opts.threads, std::thread::hardware_concurrency());
+        std::cout << "Simulated ticks/sec, " << opts.processes << " processes x " << opts.ticks
+                  << " ticks, seed " << opts.seed << "\n";
+        std::cout << "hardware threads: " << std::thread::hardware_concurrency() << "\n\n";
+        std::cout << std::setw(8) << "threads" << std::setw(12) << "ticks/s" << std::setw(10) << "speedup"
+                  << std::setw(10) << "stolen" << std::setw(20) << "digest" << "\n";
+        double base = 0;
+        for (unsigned threads = 1;; threads = std::min(threads * 2, maxThreads)) {
+            RunResult r = runSimulation(opts, threads, false);
+            double rate = opts.ticks / r.seconds;
+            if (threads == 1) base = rate;
+            std::cout << std::fixed << std::setprecision(1)
+                      << std::setw(8) << threads << std::setw(12) << rate
+                      << std::setprecision(2) << std::setw(10) << rate / base
+                      << std::setw(10) << r.stolen
+                      << std::setw(20) << std::hex << r.digest << std::dec << "\n";
+            if (threads == maxThreads) break;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opts;
+    if (!parseOptions(argc, argv, opts)) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--threads N] [--processes N] [--ticks N] [--seed N] [--scaling] [--unbatched]"
+                  << " [--no-rebalance] [--slow-tier memory|file|compressed] [--record FILE]"
+                  << " [--snapshot FILE] [--restore FILE] [--stats json|prometheus]\n";
+        return 1;
+    }
+    std::unique_ptr<TraceRecorder> recorder;
+    if (!opts.recordPath.empty()) {
+        recorder = std::make_unique<TraceRecorder>(opts.recordPath);
+        if (!recorder->ok()) {
+            std::cerr << "cannot write " << opts.recordPath << "\n";
+            return 1;
+        }
+    }
+    if (opts.scaling) {
+        runScaling(opts);
+        return 0;
     }
 
+    RunResult r = runSimulation(opts, opts.threads, true, recorder.get());
+
     // 3. Print summary
+    EventLog::instance().flush();
+    if (EventLog::instance().droppedCount() > 0) {
+        std::cout << "Dropped log events: " << EventLog::instance().droppedCount() << std::endl;
+    }
     std::cout << "\nSimulation complete.\n";
-    std::cout << "Total processes: " << processes.size() << std::endl;
-    std::cout << "Total memory used: " << memManager.getTotalMemoryUsage() << " bytes" << std::endl;
+    std::cout << "Total processes: " << opts.processes << std::endl;
+    std::cout << "Total memory used: " << r.totalMemory << " bytes" << std::endl;
+    std::cout << "Worker threads: " << opts.threads << " (" << r.stolen << " partitions stolen), "
+              << opts.ticks / r.seconds << " ticks/sec" << std::endl;
+    std::cout << "Workload digest: " << std::hex << r.digest << std::dec << std::endl;
+    const ReservationStats& res = r.reservations;
+    std::cout << "Reservation hit rate: " << std::fixed << std::setprecision(1) << 100.0 * res.hitRate() << "% ("
+              << res.hits << "/" << res.allocations << " allocations, " << res.reservedBytes << " bytes reserved, "
+              << res.wastedBytes << " wasted, " << res.reclaimed << " reclaimed)" << std::endl;
+    const TieringStats& tiers = r.tiering;
+    std::cout << "Tier rebalancer: " << tiers.passes << " passes, " << tiers.promotedBytes << " bytes promoted ("
+              << tiers.promotions << " blocks), " << tiers.demotedBytes << " demoted (" << tiers.demotions
+              << " blocks), longest lock hold " << tiers.longestLockNs << " ns" << std::endl;
+    std::cout << "Fast-tier hit ratio: " << 100.0 * tiers.fastTierHitRatio() << "% of "
+              << tiers.accesses << " accesses" << std::endl;
+    if (opts.slowTier == SlowTierMode::SWAP_FILE) {
+        std::cout << "Swap file: " << tiers.fileMaps << " blocks mapped, " << tiers.writebacks << " written back (mean "
+                  << tiers.demoteNs.mean() / 1000 << " us), " << tiers.remaps << " remapped on promotion (mean "
+                  << tiers.promoteNs.mean() / 1000 << " us)" << std::endl;
+    } else if (opts.slowTier == SlowTierMode::COMPRESSED) {
+        const CompressionStats& comp = r.compression;
+        std::cout << "Slow tier compression: " << comp.compressedPages << " pages held (" << comp.zeroPages
+                  << " zero), ratio " << comp.ratio() << ", " << comp.residentBytesSaved()
+                  << " resident bytes saved, " << comp.compressSecondsPerGB() << " CPU s/GB; "
+                  << tiers.remaps << " blocks restored on promotion, " << tiers.accessRestores
+                  << " on access" << std::endl;
+    }
+    if (recorder) {
+        recorder->flush();
+        std::cout << "Trace: " << recorder->recordCount() << " calls, " << recorder->bytesWritten() << " bytes ("
+                  << double(recorder->bytesWritten()) / std::max<uint64_t>(1, recorder->recordCount())
+                  << " per call) in " << opts.recordPath << std::endl;
+    }
+    if (!opts.restorePath.empty()) {
+        std::cout << "Restored: " << r.restored.processes << " processes, " << r.restored.dependencies
+                  << " dependency nodes from " << opts.restorePath << " in " << r.restored.seconds * 1e3 << " ms"
+                  << std::endl;
+    }
+    if (!opts.snapshotPath.empty()) {
+        std::cout << "Snapshots: " << r.snapshots << " saved to " << opts.snapshotPath << ", last "
+                  << r.saved.processes << " processes, " << r.saved.bytes << " bytes in " << r.saved.seconds * 1e3
+                  << " ms" << std::endl;
+    }
+    if (!r.stats.empty()) std::cout << "Manager statistics:\n" << r.stats;
     std::cout << "(See logs above for periodic optimization results.)" << std::endl;
     return 0;
 }
@@ -0,0 +1,260 @@
+#ifndef SLOT_STORE_H
+#define SLOT_STORE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "cache_line.h"
+#include "process_table.h"
+
+// Per-process state kept in a dense array indexed by ProcessTable slot.
+// An entry is present only while its recorded generation matches the slot's
+// live generation, so state of an unregistered process disappears with its
+// handle and a recycled slot starts from a default value.
+// Locks are striped over blocks of 64 consecutive slots: processes registered
+// together share a lock, so a batch over neighbours takes few locks, while
+// distant blocks spread over Stripes independent mutexes.
+// Entries are addressed by ProcessHandle (no hashing) or by PID (one table
+// lookup). Unlike ShardedStore, nothing is created for unregistered PIDs.
+//
+// Optionally records which entries changed since the last drainChanged() so
+// that consumers can do incremental work instead of rescanning every entry.
+template <typename Value, size_t Stripes = 64>
+class SlotStore {
+    static_assert((Stripes & (Stripes - 1)) == 0, "Stripes must be a power of two");
+
+public:
+    explicit SlotStore(ProcessTable& table, bool trackChanges = false) : table(table), trackChanges(trackChanges) {}
+
+    // Reset the entry to value; false if h is stale
+    bool insert(ProcessHandle h, const Value& value) {
+        return update(h, [&](Value& v) { v = value; });
+    }
+
+    // Run fn(Value&) on the entry, creating a default one if absent; false if
+    // h is stale. Marks the entry as changed when change tracking is enabled.
+    template <typename Fn>
+    bool update(ProcessHandle h, Fn&& fn) {
+        if (!table.isLive(h) || !entries.ensure(size_t(h.slot) + 1)) return false;
+        Stripe& stripe = stripeFor(h.slot);
+        std::lock_guard<std::mutex> lock(stripe.mtx);
+        updateLocked(stripe, h, fn);
+        return true;
+    }
+
+    // Create the entry and run fn(Value&) on it unless it exists; true if
+    // created. The check and the creation share one hold of the stripe lock,
+    // so of concurrent calls for one handle exactly one creates.
+    template <typename Fn>
+    bool create(ProcessHandle h, Fn&& fn) {
+        if (!table.isLive(h) || !entries.ensure(size_t(h.slot) + 1)) return false;
+        Stripe& stripe = stripeFor(h.slot);
+        std::lock_guard<std::mutex> lock(stripe.mtx);
+        if (entries[h.slot].generation == h.generation) return false;
+        updateLocked(stripe, h, fn);
+        return true;
+    }
+
+    // create() with the entry set to value
+    bool insertIfAbsent(ProcessHandle h, const Value& value) {
+        return create(h, [&](Value& v) { v = value; });
+    }
+
+    // Run fn(Value&) on the entry if it exists; returns false otherwise
+    template <typename Fn>
+    bool find(ProcessHandle h, Fn&& fn) {
+        if (!table.isLive(h) || h.slot >= entries.capacity()) return false;
+        std::lock_guard<std::mutex> lock(stripeFor(h.slot).mtx);
+        Entry& e = entries[h.slot];
+        if (e.generation != h.generation) return false;
+        fn(e.value);
+        return true;
+    }
+
+    // Mark an existing entry as changed without modifying it
+    void touch(ProcessHandle h) {
+        if (!trackChanges) return;
+        if (!table.isLive(h) || h.slot >= entries.capacity()) return;
+        Stripe& stripe = stripeFor(h.slot);
+        std::lock_guard<std::mutex> lock(stripe.mtx);
+        Entry& e = entries[h.slot];
+        if (e.generation != h.generation || e.changed) return;
+        e.changed = true;
+        stripe.changed.push_back(h.slot);
+    }
+
+    bool erase(ProcessHandle h) {
+        return erase(h, [](Value&) {});
+    }
+
+    // Run fn(Value&) on the entry and erase it, under one hold of its lock;
+    // false if it does not exist
+    template <typename Fn>
+    bool erase(ProcessHandle h, Fn&& fn) {
+        if (h.slot >= entries.capacity()) return false;
+        std::lock_guard<std::mutex> lock(stripeFor(h.slot).mtx);
+        Entry& e = entries[h.slot];
+        if (!h.valid() || e.generation != h.generation) return false;
+        fn(e.value);
+        e.generation = 0;
+        e.value = Value();
+        return true;
+    }
+
+    bool contains(ProcessHandle h) {
+        return find(h, [](Value&) {});
+    }
+
+    // PID-addressed forms: one table lookup, then as above
+    template <typename Fn>
+    bool update(pid_t pid, Fn&& fn) { return update(table.lookup(pid), std::forward<Fn>(fn)); }
+    template <typename Fn>
+    bool find(pid_t pid, Fn&& fn) { return find(table.lookup(pid), std::forward<Fn>(fn)); }
+    bool insert(pid_t pid, const Value& value) { return insert(table.lookup(pid), value); }
+    void touch(pid_t pid) { touch(table.lookup(pid)); }
+    bool erase(pid_t pid) { return erase(table.lookup(pid)); }
+    template <typename Fn>
+    bool erase(pid_t pid, Fn&& fn) { return erase(table.lookup(pid), std::forward<Fn>(fn)); }
+    bool contains(pid_t pid) { return contains(table.lookup(pid)); }
+
+    // Batched update(): run fn(i, Value&) for every i in [0, count) whose
+    // handleOf(i) is live. Items are bucketed by stripe first, so each stripe
+    // lock is taken at most once per call; within a stripe, items keep index
+    // order. The bucketing scratch is kept per thread.
+    template <typename HandleOf, typename Fn>
+    void updateBatch(size_t count, HandleOf&& handleOf, Fn&& fn) {
+        visitBatch(count, handleOf, fn, true);
+    }
+
+    // Batched find(): as updateBatch, but only for existing entries
+    template <typename HandleOf, typename Fn>
+    void findBatch(size_t count, HandleOf&& handleOf, Fn&& fn) {
+        visitBatch(count, handleOf, fn, false);
+    }
+
+    // Visit every entry as fn(pid, Value&) in slot order, locking each block
+    // of neighbouring slots once
+    template <typename Fn>
+    void forEach(Fn&& fn) {
+        size_t n = std::min<size_t>(table.slotCount(), entries.capacity());
+        for (size_t block = 0; block < n; block += BLOCK) {
+            std::lock_guard<std::mutex> lock(stripeFor(static_cast<uint32_t>(block)).mtx);
+            for (size_t s = block; s < std::min(n, block + BLOCK); ++s) {
+                Entry& e = entries[s];
+                uint32_t slot = static_cast<uint32_t>(s);
+                if (e.generation != 0 && e.generation == table.generationOf(slot)) fn(table.pidOf(slot), e.value);
+            }
+        }
+    }
+
+    // Visit entries changed since the previous drain as
+    // fn(pid, handle, const Value&) and clear their changed marks. Entries
+    // erased in between are skipped.
+    template <typename Fn>
+    void drainChanged(Fn&& fn) {
+        for (auto& stripe : stripes) {
+            std::lock_guard<std::mutex> lock(stripe.mtx);
+            for (uint32_t slot : stripe.changed) {
+                Entry& e = entries[slot];
+                if (!e.changed) continue;
+                e.changed = false;
+                if (e.generation == 0 || e.generation != table.generationOf(slot)) continue;
+                fn(table.pidOf(slot), ProcessHandle{slot, e.generation}, static_cast<const Value&>(e.value));
+            }
+            stripe.changed.clear();
+        }
+    }
+
+    size_t size() {
+        size_t total = 0;
+        forEach([&](pid_t, const Value&) { total++; });
+        return total;
+    }
+
+    // Index of the stripe whose lock guards a slot, for state kept per stripe
+    // alongside the store and updated under the same lock
+    static constexpr size_t STRIPES = Stripes;
+    static size_t stripeIndex(uint32_t slot) { return (slot >> BLOCK_BITS) & (Stripes - 1); }
+
+private:
+    static constexpr size_t BLOCK_BITS = 6;
+    static constexpr size_t BLOCK = size_t(1) << BLOCK_BITS;
+
+    struct Entry {
+        uint32_t generation = 0; // Owner's generation; 0 when absent
+        bool changed = false;
+        Value value{};
+    };
+    struct alignas(CACHE_LINE_SIZE) Stripe {
+        std::mutex mtx;
+        std::vector<uint32_t> changed; // Slots marked since the last drain
+    };
+
+    ProcessTable& table;
+    ChunkedArray<Entry> entries;
+    Stripe stripes[Stripes];
+    const bool trackChanges;
+
+    Stripe& stripeFor(uint32_t slot) { return stripes[stripeIndex(slot)]; }
+
+    template <typename HandleOf, typename Fn>
+    void visitBatch(size_t count, HandleOf& handleOf, Fn& fn, bool create) {
+        if (count == 0) return;
+        thread_local std::vector<uint32_t> scratch;
+        // Taken rather than borrowed, so a nested batch simply gets its own
+        std::vector<uint32_t> order = std::move(scratch);
+        order.resize(count);
+        size_t start[Stripes + 1] = {};
+        uint32_t maxSlot = 0;
+        for (size_t i = 0; i < count; ++i) {
+            uint32_t slot = handleOf(i).slot;
+            maxSlot = std::max(maxSlot, slot);
+            start[stripeIndex(slot) + 1]++;
+        }
+        for (size_t s = 0; s < Stripes; ++s) start[s + 1] += start[s];
+        size_t fill[Stripes];
+        std::copy(start, start + Stripes, fill);
+        for (size_t i = 0; i < count; ++i) order[fill[stripeIndex(handleOf(i).slot)]++] = static_cast<uint32_t>(i);
+        // Stale handles may carry any slot; they are skipped below
+        entries.ensure(std::min<size_t>(size_t(maxSlot) + 1, table.slotCount()));
+
+        for (size_t s = 0; s < Stripes; ++s) {
+            if (start[s] == start[s + 1]) continue;
+            Stripe& stripe = stripes[s];
+            std::lock_guard<std::mutex> lock(stripe.mtx);
+            for (size_t k = start[s]; k < start[s + 1]; ++k) {
+                size_t i = order[k];
+                ProcessHandle h = handleOf(i);
+                if (!table.isLive(h) || h.slot >= entries.capacity()) continue;
+                if (create) {
+                    auto apply = [&](Value& v) { fn(i, v); };
+                    updateLocked(stripe, h, apply);
+                } else if (entries[h.slot].generation == h.generation) {
+                    fn(i, entries[h.slot].value);
+                }
+            }
+        }
+        scratch = std::move(order);
+    }
+
+    // Caller holds the stripe lock and has checked that h is live
+    template <typename Fn>
+    void updateLocked(Stripe& stripe, ProcessHandle h, Fn& fn) {
+        Entry& e = entries[h.slot];
+        if (e.generation != h.generation) {
+            // First use by this owner; whatever is left belongs to a previous one
+            e.generation = h.generation;
+            e.value = Value();
+        }
+        fn(e.value);
+        if (trackChanges && !e.changed) {
+            e.changed = true;
+            stripe.changed.push_back(h.slot);
+        }
+    }
+};
+
+#endif // SLOT_STORE_H
@@ -0,0 +1,122 @@
+// snapshot_bench.cpp
+// Builds up state for N processes (default 1M) in all three managers, saves
+// a snapshot, restores it into fresh managers and saves those again. Reports
+// the time of each step against rebuilding the state call by call, and checks
+// that the second snapshot matches the first section for section.
+//
+// Usage: snapshot_bench [--processes N] [--file PATH]
+#include "state_snapshot.h"
+#include "event_log.h"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    struct Managers {
+        std::shared_ptr<ProcessTable> table = std::make_shared<ProcessTable>();
+        AdaptiveScheduler scheduler{table};
+        AdaptiveMemoryManager memory{table};
+        SecurityMemoryManager security{table};
+    };
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Register n processes everywhere and give each some usage, a memory
+    // forecast and a focus history
+    void populate(Managers& m, size_t n) {
+        std::vector<ProcessHandle> handles(n);
+        for (size_t i = 0; i < n; ++i) {
+            pid_t pid = static_cast<pid_t>(1000 + i);
+            handles[i] = m.scheduler.registerProcess(pid, "app-" + std::to_string(i % 5000));
+            m.memory.registerProcess(pid);
+            if (i % 4 == 0) m.security.registerProcess(pid);
+        }
+        std::vector<UsageUpdate> updates(n);
+        std::vector<MemoryUsageSample> samples(n);
+        for (int round = 0; round < 3; ++round) {
+            for (size_t i = 0; i < n; ++i) {
+                pid_t previous = static_cast<pid_t>(1000 + (i * 7 + round) % n);
+                auto type = i % 16 == 0 ? ApplicationEvent::FOCUS_CHANGE : ApplicationEvent::OTHER;
+                updates[i] = UsageUpdate{handles[i], {type, previous}, int(i % 100), int((i + round) % 50)};
+                samples[i] = MemoryUsageSample{handles[i], (i % 256 + 1) * 4096 * size_t(round + 1)};
+            }
+            m.scheduler.updateUsageMetricsBatch(updates.data(), n);
+            m.memory.predictMemoryNeedsBatch(samples.data(), n);
+        }
+    }
+
+    template <typename T>
+    bool sameSection(const SnapshotImage& a, const SnapshotImage& b, Snapshot::Section section) {
+        size_t countA, countB;
+        const T* p = a.records<T>(section, countA);
+        const T* q = b.records<T>(section, countB);
+        return countA == countB && std::memcmp(p, q, countA * sizeof(T)) == 0;
+    }
+
+    bool sameSections(const SnapshotImage& a, const SnapshotImage& b) {
+        using namespace Snapshot;
+        return sameSection<ProcessRecord>(a, b, PROCESSES) && sameSection<SchedulerRecord>(a, b, SCHEDULER) &&
+               sameSection<MemoryRecord>(a, b, MEMORY) && sameSection<SecurityRecord>(a, b, SECURITY) &&
+               sameSection<DependencyRecord>(a, b, DEPENDENCIES) && sameSection<char>(a, b, NAMES);
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t processes = 1000000;
+    std::string path = "/tmp/snapshot_bench.snap";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--processes") processes = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--file") path = argv[i + 1];
+        else {
+            std::cerr << "usage: " << argv[0] << " [--processes N] [--file PATH]\n";
+            return 1;
+        }
+    }
+    EventLog::instance().setLevel(LogLevel::OFF);
+    std::cout << std::fixed << std::setprecision(1);
+
+    auto start = std::chrono::steady_clock::now();
+    Managers original;
+    populate(original, processes);
+    std::cout << "build state call by call: " << secondsSince(start) * 1e3 << " ms for " << processes
+              << " processes\n";
+
+    SnapshotStats saved;
+    if (!saveSnapshot(path, *original.table, original.scheduler, original.memory, original.security, &saved)) {
+        std::cerr << "cannot write " << path << "\n";
+        return 1;
+    }
+    std::cout << "save:    " << saved.seconds * 1e3 << " ms, " << saved.bytes << " bytes ("
+              << double(saved.bytes) / std::max<uint64_t>(1, saved.processes) << " per process), "
+              << saved.dependencies << " dependency nodes\n";
+
+    Managers restored;
+    SnapshotStats loaded;
+    std::string error;
+    if (!restoreSnapshot(path, *restored.table, restored.scheduler, restored.memory, restored.security, &loaded,
+                         &error)) {
+        std::cerr << "restore failed: " << error << "\n";
+        return 1;
+    }
+    std::cout << "restore: " << loaded.seconds * 1e3 << " ms, " << loaded.processes << " processes\n";
+
+    std::string again = path + ".again";
+    if (!saveSnapshot(again, *restored.table, restored.scheduler, restored.memory, restored.security)) {
+        std::cerr << "cannot write " << again << "\n";
+        return 1;
+    }
+    SnapshotImage first(path), second(again);
+    bool same = first.ok() && second.ok() && loaded.processes == processes && sameSections(first, second);
+    std::cout << "restored state " << (same ? "matches" : "DIFFERS FROM") << " the original\n";
+    unlink(again.c_str());
+    unlink(path.c_str());
+    return same ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+#ifndef SNAPSHOT_FORMAT_H
+#define SNAPSHOT_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "snapshot records are stored little-endian"
+#endif
+
+// Layout of a state snapshot file (see state_snapshot.h):
+//
+//   FileHeader | SectionEntry[SECTION_COUNT] | sections, each 8-byte aligned
+//
+// Sections are arrays of the flat records below, read in place from the
+// mapped file: they hold offsets rather than pointers, and every field sits
+// at its natural alignment with explicit padding. Each section carries a
+// CRC-32C, and the header one of itself and the section table.
+//
+// The per-process sections are parallel arrays: entry i of SCHEDULER,
+// MEMORY and SECURITY belongs to ProcessRecord i, and is meaningful only if
+// that record's managers bit for the section is set. NAMES is a byte pool.
+namespace Snapshot {
+    constexpr char MAGIC[8] = {'O', 'S', 'S', 'N', 'A', 'P', 'S', 'H'};
+    constexpr uint32_t VERSION = 2;
+
+    enum Section : uint32_t { PROCESSES, SCHEDULER, MEMORY, SECURITY, DEPENDENCIES, NAMES, SECTION_COUNT };
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t sectionCount;
+        uint64_t fileBytes;
+        int64_t createdUnixNs;
+        uint32_t headerCrc; // Of this header, with this field zero, and the section table
+        uint32_t pad;
+    };
+
+    struct SectionEntry {
+        uint64_t offset;
+        uint64_t count;     // Records
+        uint64_t bytes;     // count * recordBytes
+        uint32_t recordBytes;
+        uint32_t crc;       // Of the section's bytes
+    };
+
+    // ProcessRecord::managers bits: the managers the process was registered with
+    enum : uint8_t { IN_SCHEDULER = 1, IN_MEMORY = 2, IN_SECURITY = 4 };
+
+    struct ProcessRecord {
+        int32_t pid;
+        uint8_t managers;
+        uint8_t pad[3];
+    };
+
+    // Usage metrics, updates by local hour and profile name (at nameOffset in NAMES)
+    struct SchedulerRecord {
+        int64_t lastInteractionTime;
+        int32_t interactionCount;
+        int32_t burstCount;
+        int32_t cpuUsage;
+        int32_t ioUsage;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint8_t hourActivity[24];
+    };
+
+    // Usage forecast, access heat and tier choices; blocks and reservations
+    // are addresses of the running process and are not kept
+    struct MemoryRecord {
+        float level;
+        float trend;
+        float deviation;
+        uint32_t samples;
+        uint64_t usage;
+        float heat;
+        int8_t preferredTier;
+        int8_t placement;
+        uint8_t pad[2];
+    };
+
+    struct SecurityRecord {
+        int32_t trustScore;
+    };
+
+    // One DependencyGraph node: pid's predecessors with weights decayed to stamp
+    struct DependencyRecord {
+        static constexpr size_t MAX_EDGES = 8;
+        int32_t pid;
+        uint32_t edgeCount;
+        float totalWeight;
+        uint32_t pad;
+        double stamp;
+        struct {
+            int32_t pid;
+            float weight;
+        } edges[MAX_EDGES];
+    };
+
+    static_assert(sizeof(FileHeader) == 40 && sizeof(SectionEntry) == 32, "snapshot header layout changed");
+    static_assert(sizeof(ProcessRecord) == 8 && sizeof(SchedulerRecord) == 56 && sizeof(MemoryRecord) == 32 &&
+                  sizeof(SecurityRecord) == 4 && sizeof(DependencyRecord) == 88, "snapshot record layout changed");
+    static_assert(std::is_trivially_copyable<DependencyRecord>::value && std::is_trivially_copyable<MemoryRecord>::value,
+                  "snapshot records must be plain data");
+}
+
+#endif // SNAPSHOT_FORMAT_H
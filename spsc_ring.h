@@ -0,0 +1,66 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include "cache_line.h"
+
+// Bounded single-producer/single-consumer ring buffer.
+// push() and pop() are wait-free; a full ring rejects the push so the producer
+// can drop instead of blocking. Head and tail live on separate cache lines and
+// each side caches the other's index to avoid needless cross-core traffic.
+template <typename T>
+class SpscRing {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        slots.resize(cap);
+        mask = cap - 1;
+    }
+
+    // Producer side
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead > mask) return false;
+        }
+        slots[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: pop up to max items into out; returns the count
+    size_t popBulk(T* out, size_t max) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (cachedTail == h) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (cachedTail == h) return 0;
+        }
+        size_t n = cachedTail - h;
+        if (n > max) n = max;
+        for (size_t i = 0; i < n; ++i) out[i] = slots[(h + i) & mask];
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    bool pop(T& item) { return popBulk(&item, 1) == 1; }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+    size_t capacity() const { return mask + 1; }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head{0}; // Next slot to read
+    size_t cachedTail = 0;                                // Consumer's view of tail
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0}; // Next slot to write
+    size_t cachedHead = 0;                                // Producer's view of head
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,354 @@
+#include "state_snapshot.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SNAPSHOT_X86_CRC 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    using namespace Snapshot;
+
+    // CRC-32C (Castagnoli), reflected, as computed by the SSE4.2 crc32 instruction
+    struct CrcTable {
+        uint32_t entries[256];
+        constexpr CrcTable() : entries() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1)));
+                entries[i] = c;
+            }
+        }
+    };
+    constexpr CrcTable CRC_TABLE;
+
+    uint32_t crcScalar(uint32_t crc, const uint8_t* p, size_t n) {
+        for (size_t i = 0; i < n; ++i) crc = CRC_TABLE.entries[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+        return crc;
+    }
+
+#ifdef SNAPSHOT_X86_CRC
+    __attribute__((target("sse4.2")))
+    uint32_t crcSSE42(uint32_t crc, const uint8_t* p, size_t n) {
+        uint64_t c = crc;
+        for (; n >= 8; p += 8, n -= 8) {
+            uint64_t word;
+            std::memcpy(&word, p, sizeof word);
+            c = _mm_crc32_u64(c, word);
+        }
+        return crcScalar(static_cast<uint32_t>(c), p, n);
+    }
+#endif
+
+    // Running CRC-32C: start from 0, feed update() in order
+    uint32_t crcUpdate(uint32_t crc, const void* data, size_t n) {
+        auto p = static_cast<const uint8_t*>(data);
+        crc = ~crc;
+#ifdef SNAPSHOT_X86_CRC
+        static const bool hardware = __builtin_cpu_supports("sse4.2");
+        if (hardware) return ~crcSSE42(crc, p, n);
+#endif
+        return ~crcScalar(crc, p, n);
+    }
+
+    constexpr uint64_t align8(uint64_t n) { return (n + 7) & ~uint64_t(7); }
+
+    bool writeAt(int fd, const void* data, size_t n, uint64_t offset) {
+        auto p = static_cast<const char*>(data);
+        while (n > 0) {
+            ssize_t w = pwrite(fd, p, n, static_cast<off_t>(offset));
+            if (w < 0) return false;
+            p += w;
+            n -= static_cast<size_t>(w);
+            offset += static_cast<uint64_t>(w);
+        }
+        return true;
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Record size of each section, NAMES being bytes
+    constexpr uint32_t RECORD_BYTES[SECTION_COUNT] = {
+        sizeof(ProcessRecord), sizeof(SchedulerRecord), sizeof(MemoryRecord), sizeof(SecurityRecord),
+        sizeof(DependencyRecord), 1
+    };
+    constexpr uint64_t SECTIONS_START = align8(sizeof(FileHeader) + sizeof(SectionEntry) * SECTION_COUNT);
+
+    // Appends records to the sections of a file being written, checksumming
+    // as it goes
+    class SectionWriter {
+    public:
+        SectionWriter(int fd, SectionEntry* sections) : fd(fd), sections(sections) {}
+        bool append(Section s, const void* records, size_t count) {
+            SectionEntry& e = sections[s];
+            size_t n = count * e.recordBytes;
+            if (!writeAt(fd, records, n, e.offset + written[s])) return false;
+            e.crc = crcUpdate(e.crc, records, n);
+            written[s] += n;
+            return true;
+        }
+
+    private:
+        int fd;
+        SectionEntry* sections;
+        uint64_t written[SECTION_COUNT] = {};
+    };
+
+    bool writeSections(int fd, ProcessTable& table, AdaptiveScheduler& scheduler, AdaptiveMemoryManager& memory,
+                       SecurityMemoryManager& security, SnapshotStats& stats) {
+        std::vector<pid_t> pids;
+        std::vector<ProcessHandle> handles;
+        table.forEach([&](pid_t pid, ProcessHandle h) {
+            pids.push_back(pid);
+            handles.push_back(h);
+        });
+        std::vector<DependencyRecord> dependencies;
+        scheduler.saveDependencies(dependencies);
+        size_t n = handles.size();
+
+        // Every section but NAMES has a size known up front; NAMES goes last
+        SectionEntry sections[SECTION_COUNT] = {};
+        uint64_t offset = SECTIONS_START;
+        for (uint32_t s = 0; s < SECTION_COUNT; ++s) {
+            SectionEntry& e = sections[s];
+            e.offset = offset;
+            e.recordBytes = RECORD_BYTES[s];
+            e.count = s == DEPENDENCIES ? dependencies.size() : s == NAMES ? 0 : n;
+            e.bytes = e.count * e.recordBytes;
+            offset = align8(offset + e.bytes);
+        }
+
+        SectionWriter writer(fd, sections);
+        std::vector<ProcessRecord> processes(std::min(n, CHUNK_PROCESSES));
+        std::vector<SchedulerRecord> schedulerRecords(processes.size());
+        std::vector<MemoryRecord> memoryRecords(processes.size());
+        std::vector<SecurityRecord> securityRecords(processes.size());
+        std::string names;
+        for (size_t i = 0; i < n; i += CHUNK_PROCESSES) {
+            size_t m = std::min(CHUNK_PROCESSES, n - i);
+            for (size_t k = 0; k < m; ++k) processes[k] = ProcessRecord{pids[i + k], 0, {}};
+            scheduler.saveState(&handles[i], m, processes.data(), schedulerRecords.data(), names);
+            memory.saveState(&handles[i], m, processes.data(), memoryRecords.data());
+            security.saveState(&handles[i], m, processes.data(), securityRecords.data());
+            if (!writer.append(PROCESSES, processes.data(), m) ||
+                !writer.append(SCHEDULER, schedulerRecords.data(), m) ||
+                !writer.append(MEMORY, memoryRecords.data(), m) ||
+                !writer.append(SECURITY, securityRecords.data(), m)) {
+                return false;
+            }
+        }
+        SectionEntry& pool = sections[NAMES];
+        pool.count = pool.bytes = names.size();
+        if (!writer.append(DEPENDENCIES, dependencies.data(), dependencies.size()) ||
+            !writer.append(NAMES, names.data(), names.size())) {
+            return false;
+        }
+
+        FileHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof MAGIC);
+        header.version = VERSION;
+        header.sectionCount = SECTION_COUNT;
+        header.fileBytes = pool.offset + pool.bytes;
+        header.createdUnixNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        header.headerCrc = crcUpdate(crcUpdate(0, &header, sizeof header), sections, sizeof sections);
+        if (!writeAt(fd, &header, sizeof header, 0) || !writeAt(fd, sections, sizeof sections, sizeof header)) {
+            return false;
+        }
+        stats.processes = n;
+        stats.dependencies = dependencies.size();
+        stats.bytes = header.fileBytes;
+        return true;
+    }
+}
+
+bool saveSnapshot(const std::string& path, ProcessTable& table, AdaptiveScheduler& scheduler,
+                  AdaptiveMemoryManager& memory, SecurityMemoryManager& security, SnapshotStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    std::string temporary = path + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    SnapshotStats s;
+    bool written = writeSections(fd, table, scheduler, memory, security, s) && fsync(fd) == 0;
+    written = close(fd) == 0 && written;
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        unlink(temporary.c_str());
+        return false;
+    }
+    s.seconds = secondsSince(start);
+    if (stats) *stats = s;
+    return true;
+}
+
+SnapshotImage::SnapshotImage(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        failure = "cannot open " + path;
+        return;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(SECTIONS_START)) {
+        close(fd);
+        failure = "too short for a snapshot";
+        return;
+    }
+    size = static_cast<size_t>(st.st_size);
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    flags |= MAP_POPULATE; // Everything is read once, by the checksums
+#endif
+    void* p = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        size = 0;
+        failure = "cannot map " + path;
+        return;
+    }
+    data = static_cast<const uint8_t*>(p);
+    if (!validate()) {
+        munmap(const_cast<uint8_t*>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+}
+
+SnapshotImage::~SnapshotImage() {
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+}
+
+bool SnapshotImage::validate() {
+    FileHeader h = header();
+    if (std::memcmp(h.magic, MAGIC, sizeof MAGIC) != 0) {
+        failure = "not a snapshot";
+        return false;
+    }
+    if (h.version != VERSION || h.sectionCount != SECTION_COUNT) {
+        failure = "unsupported snapshot version " + std::to_string(h.version);
+        return false;
+    }
+    uint32_t expected = h.headerCrc;
+    h.headerCrc = 0;
+    if (crcUpdate(crcUpdate(0, &h, sizeof h), sections(), sizeof(SectionEntry) * SECTION_COUNT) != expected) {
+        failure = "header checksum mismatch";
+        return false;
+    }
+    if (h.fileBytes != size) {
+        failure = "truncated or extended: " + std::to_string(size) + " bytes, header says " +
+                  std::to_string(h.fileBytes);
+        return false;
+    }
+    for (uint32_t s = 0; s < SECTION_COUNT; ++s) {
+        const SectionEntry& e = sections()[s];
+        bool fits = e.offset >= SECTIONS_START && e.offset % 8 == 0 && e.offset <= size && e.bytes <= size - e.offset;
+        if (!fits || e.recordBytes != RECORD_BYTES[s] || e.bytes / e.recordBytes != e.count ||
+            e.bytes % e.recordBytes != 0) {
+            failure = "section " + std::to_string(s) + " malformed";
+            return false;
+        }
+        if (s != PROCESSES && s < DEPENDENCIES && e.count != sections()[PROCESSES].count) {
+            failure = "section " + std::to_string(s) + " does not match the process count";
+            return false;
+        }
+        if (crcUpdate(0, data + e.offset, e.bytes) != e.crc) {
+            failure = "section " + std::to_string(s) + " checksum mismatch";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool restoreSnapshot(const std::string& path, ProcessTable& table, AdaptiveScheduler& scheduler,
+                     AdaptiveMemoryManager& memory, SecurityMemoryManager& security, SnapshotStats* stats,
+                     std::string* error) {
+    auto start = std::chrono::steady_clock::now();
+    SnapshotImage image(path);
+    if (!image.ok()) {
+        if (error) *error = image.error();
+        return false;
+    }
+    size_t n, dependencyCount, namesBytes;
+    const ProcessRecord* processes = image.records<ProcessRecord>(PROCESSES, n);
+    const SchedulerRecord* schedulerRecords = image.records<SchedulerRecord>(SCHEDULER, n);
+    const MemoryRecord* memoryRecords = image.records<MemoryRecord>(MEMORY, n);
+    const SecurityRecord* securityRecords = image.records<SecurityRecord>(SECURITY, n);
+    const DependencyRecord* dependencies = image.records<DependencyRecord>(DEPENDENCIES, dependencyCount);
+    const char* names = image.records<char>(NAMES, namesBytes);
+
+    // One table reference per manager the process was registered with
+    std::vector<pid_t> pids(n);
+    std::vector<uint32_t> refs(n);
+    bool shared = table.size() > 0;
+    for (size_t i = 0; i < n; ++i) {
+        pids[i] = processes[i].pid;
+        refs[i] = static_cast<uint32_t>(__builtin_popcount(processes[i].managers & (IN_SCHEDULER | IN_MEMORY | IN_SECURITY)));
+        if (shared && table.lookup(pids[i]).valid()) refs[i] = 0;
+    }
+    std::vector<ProcessHandle> handles(n);
+    table.acquireBatch(pids.data(), refs.data(), n, handles.data());
+    scheduler.restoreState(handles.data(), n, processes, schedulerRecords, names, namesBytes);
+    memory.restoreState(handles.data(), n, processes, memoryRecords);
+    security.restoreState(handles.data(), n, processes, securityRecords);
+    scheduler.restoreDependencies(dependencies, dependencyCount);
+
+    if (stats) {
+        stats->processes = 0;
+        for (const auto& h : handles) stats->processes += h.valid();
+        stats->dependencies = dependencyCount;
+        stats->bytes = image.fileBytes();
+        stats->seconds = secondsSince(start);
+    }
+    return true;
+}
+
+SnapshotSaver::SnapshotSaver(std::string path, ProcessTable& table, AdaptiveScheduler& scheduler,
+                             AdaptiveMemoryManager& memory, SecurityMemoryManager& security)
+    : path(std::move(path)), table(table), scheduler(scheduler), memory(memory), security(security) {}
+
+void SnapshotSaver::start(std::chrono::milliseconds interval) {
+    stop();
+    std::lock_guard<std::mutex> lock(threadMtx);
+    stopping = false;
+    thread = std::thread([this, interval] {
+        std::unique_lock<std::mutex> lock(threadMtx);
+        while (!threadCv.wait_for(lock, interval, [&] { return stopping; })) {
+            lock.unlock();
+            saveNow();
+            lock.lock();
+        }
+    });
+}
+
+void SnapshotSaver::stop() {
+    {
+        std::lock_guard<std::mutex> lock(threadMtx);
+        if (!thread.joinable()) return;
+        stopping = true;
+    }
+    threadCv.notify_all();
+    thread.join();
+    saveNow();
+}
+
+bool SnapshotSaver::saveNow() {
+    std::lock_guard<std::mutex> lock(saveMtx);
+    SnapshotStats s;
+    if (!saveSnapshot(path, table, scheduler, memory, security, &s)) {
+        failed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    last = s;
+    saved.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+SnapshotStats SnapshotSaver::lastStats() {
+    std::lock_guard<std::mutex> lock(saveMtx);
+    return last;
+}
@@ -0,0 +1,117 @@
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+#include "adaptive_scheduler.h"
+#include "adaptive_memory_manager.h"
+#include "security_memory_manager.h"
+#include "snapshot_format.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Learned state of the three managers, saved to and restored from a flat,
+// versioned, checksummed file (layout in snapshot_format.h): registrations
+// and profile names, usage metrics, the dependency graph, memory forecasts,
+// access heat and tier choices, and trust scores. Allocations are addresses
+// of the running process and are not kept; restored processes hold none.
+
+struct SnapshotStats {
+    uint64_t processes = 0;
+    uint64_t dependencies = 0;
+    uint64_t bytes = 0;
+    double seconds = 0;
+};
+
+// Processes copied per step of a save
+constexpr size_t CHUNK_PROCESSES = 4096;
+
+// Write the state of the managers sharing table to path. Processes are
+// copied CHUNK_PROCESSES at a time under the stripe locks of their entries
+// only, so the managers keep serving calls meanwhile; each process's entry is
+// consistent, the snapshot as a whole is not one instant. The file is written
+// beside path and renamed over it once synced, so a crash leaves the previous
+// snapshot. Returns false on I/O errors.
+bool saveSnapshot(const std::string& path, ProcessTable& table, AdaptiveScheduler& scheduler,
+                  AdaptiveMemoryManager& memory, SecurityMemoryManager& security, SnapshotStats* stats = nullptr);
+
+// Map path, check it, and register each process it holds with the managers
+// it was registered with, with its saved state. Meant for fresh managers:
+// processes already in table are skipped. On failure nothing is restored and
+// error (if given) says why.
+bool restoreSnapshot(const std::string& path, ProcessTable& table, AdaptiveScheduler& scheduler,
+                     AdaptiveMemoryManager& memory, SecurityMemoryManager& security, SnapshotStats* stats = nullptr,
+                     std::string* error = nullptr);
+
+// A snapshot file mapped read-only and validated: magic, version, bounds and
+// record sizes of every section, and all checksums. Records are used in
+// place.
+class SnapshotImage {
+public:
+    explicit SnapshotImage(const std::string& path);
+    ~SnapshotImage();
+    SnapshotImage(const SnapshotImage&) = delete;
+    SnapshotImage& operator=(const SnapshotImage&) = delete;
+
+    bool ok() const { return failure.empty(); }
+    const std::string& error() const { return failure; }
+    size_t fileBytes() const { return size; }
+    int64_t createdUnixNs() const { return header().createdUnixNs; }
+
+    // Records of a section; requires ok() and T matching the section
+    template <typename T>
+    const T* records(Snapshot::Section section, size_t& count) const {
+        const Snapshot::SectionEntry& e = sections()[section];
+        count = static_cast<size_t>(e.count);
+        return reinterpret_cast<const T*>(data + e.offset);
+    }
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    std::string failure;
+
+    const Snapshot::FileHeader& header() const { return *reinterpret_cast<const Snapshot::FileHeader*>(data); }
+    const Snapshot::SectionEntry* sections() const {
+        return reinterpret_cast<const Snapshot::SectionEntry*>(data + sizeof(Snapshot::FileHeader));
+    }
+    bool validate();
+};
+
+// Saves a snapshot every interval on a background thread, and once more when
+// stopped, so a restart loses at most one interval of learning
+class SnapshotSaver {
+public:
+    SnapshotSaver(std::string path, ProcessTable& table, AdaptiveScheduler& scheduler, AdaptiveMemoryManager& memory,
+                  SecurityMemoryManager& security);
+    ~SnapshotSaver() { stop(); }
+    SnapshotSaver(const SnapshotSaver&) = delete;
+    SnapshotSaver& operator=(const SnapshotSaver&) = delete;
+
+    void start(std::chrono::milliseconds interval);
+    void stop();
+    // Save on the calling thread now
+    bool saveNow();
+    uint64_t saves() const { return saved.load(std::memory_order_relaxed); }
+    uint64_t failures() const { return failed.load(std::memory_order_relaxed); }
+    SnapshotStats lastStats();
+
+private:
+    const std::string path;
+    ProcessTable& table;
+    AdaptiveScheduler& scheduler;
+    AdaptiveMemoryManager& memory;
+    SecurityMemoryManager& security;
+
+    std::mutex saveMtx; // Serialises saves; guards last
+    SnapshotStats last;
+    std::atomic<uint64_t> saved{0}, failed{0};
+    std::mutex threadMtx; // Guards the thread's lifetime
+    std::condition_variable threadCv;
+    bool stopping = false;
+    std::thread thread;
+};
+
+#endif // STATE_SNAPSHOT_H
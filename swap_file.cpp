@@ -0,0 +1,111 @@
+#include "swap_file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
+
+SwapFile::SwapFile(void* base, size_t capacity, const std::string& directory)
+    : base(static_cast<char*>(base)), pageSize(static_cast<size_t>(sysconf(_SC_PAGESIZE))) {
+    this->capacity = capacity / pageSize * pageSize;
+    if (!base || this->capacity == 0 || directory.empty()) return;
+    std::string path = directory + "/tier-swap-XXXXXX";
+    int file = mkstemp(path.data());
+    if (file < 0) return;
+    unlink(path.c_str());
+    if (ftruncate(file, static_cast<off_t>(this->capacity)) != 0) {
+        close(file);
+        return;
+    }
+    fd = file;
+    pages.assign(this->capacity / pageSize, ANONYMOUS);
+}
+
+SwapFile::~SwapFile() {
+    // Mappings keep their own reference to the file
+    if (fd >= 0) close(fd);
+}
+
+bool SwapFile::remappable(const void* addr, size_t size) const {
+    auto p = static_cast<const char*>(addr);
+    if (!enabled() || size == 0 || size % pageSize != 0 || p < base) return false;
+    size_t offset = static_cast<size_t>(p - base);
+    return offset % pageSize == 0 && offset + size <= capacity;
+}
+
+bool SwapFile::onFile(const void* addr) const {
+    return remappable(addr, pageSize) && pages[pageOf(addr)] != ANONYMOUS;
+}
+
+bool SwapFile::shared(const void* addr) const {
+    return remappable(addr, pageSize) && pages[pageOf(addr)] == SHARED;
+}
+
+// Replace the range's mapping with the file pages at the same offset
+bool SwapFile::mapAt(void* addr, size_t size, int flags) {
+    off_t offset = static_cast<off_t>(static_cast<char*>(addr) - base);
+    void* mem = mmap(addr, size, PROT_READ | PROT_WRITE, flags | MAP_FIXED | MAP_NORESERVE, fd, offset);
+    return mem != MAP_FAILED;
+}
+
+bool SwapFile::mapFile(void* addr, size_t size) {
+    if (!remappable(addr, size)) return false;
+    Backing& backing = pages[pageOf(addr)];
+    if (backing == SHARED) return true;
+    if (!mapAt(addr, size, MAP_SHARED)) return false;
+    backing = SHARED;
+    return true;
+}
+
+bool SwapFile::copyOut(const void* addr, size_t size) {
+    if (!remappable(addr, size)) return false;
+    if (pages[pageOf(addr)] == SHARED) return true;
+    // A private mapping of the file is copied onto its own pages, which is
+    // harmless
+    off_t offset = static_cast<off_t>(static_cast<const char*>(addr) - base);
+    for (size_t done = 0; done < size;) {
+        ssize_t n = pwrite(fd, static_cast<const char*>(addr) + done, size - done, offset + static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool SwapFile::mapCopied(void* addr, size_t size) {
+    if (!remappable(addr, size)) return false;
+    Backing& backing = pages[pageOf(addr)];
+    if (backing == SHARED) return true;
+    if (!mapAt(addr, size, MAP_SHARED)) return false;
+    backing = SHARED;
+    return true;
+}
+
+void SwapFile::pageOut(void* addr, size_t size) {
+    if (!remappable(addr, size)) return;
+    off_t offset = static_cast<off_t>(static_cast<char*>(addr) - base);
+    // msync(MS_ASYNC) does nothing on Linux; this queues the writeback itself
+    sync_file_range(fd, offset, static_cast<off_t>(size), SYNC_FILE_RANGE_WRITE);
+    madvise(addr, size, MADV_PAGEOUT);
+}
+
+bool SwapFile::remapPrivate(void* addr, size_t size) {
+    if (!remappable(addr, size)) return false;
+    Backing& backing = pages[pageOf(addr)];
+    if (backing != SHARED || !mapAt(addr, size, MAP_PRIVATE)) return false;
+    backing = PRIVATE;
+    madvise(addr, size, MADV_WILLNEED);
+    return true;
+}
+
+void SwapFile::discard(void* addr, size_t size) {
+    if (!remappable(addr, size)) return;
+    Backing& backing = pages[pageOf(addr)];
+    if (backing == ANONYMOUS) return;
+    void* mem = mmap(addr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) return;
+    backing = ANONYMOUS;
+    off_t offset = static_cast<off_t>(static_cast<char*>(addr) - base);
+    fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, static_cast<off_t>(size));
+}
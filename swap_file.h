@@ -0,0 +1,67 @@
+#ifndef SWAP_FILE_H
+#define SWAP_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Disk file behind the slow memory tier. Whole-page ranges of an existing
+// mapping (the tier arena) are switched between anonymous memory and pages of
+// the file with mmap(MAP_FIXED), so data changes backing without changing
+// address. File offsets mirror offsets into the mapping: neighbouring ranges
+// map neighbouring file pages, which the kernel merges into one mapping. The
+// file is sparse and unlinked as soon as it is created.
+//
+// Each range is switched by its owner (the holder of the block), so calls on
+// different ranges need no locking against each other. Only the state of a
+// range's first page is kept; ranges are always switched whole.
+class SwapFile {
+public:
+    // Disabled: every call fails and nothing is file-backed
+    SwapFile() = default;
+    // File of `capacity` bytes in `directory` behind [base, base + capacity).
+    // Disabled if directory is empty or the file cannot be created.
+    SwapFile(void* base, size_t capacity, const std::string& directory);
+    ~SwapFile();
+    SwapFile(const SwapFile&) = delete;
+    SwapFile& operator=(const SwapFile&) = delete;
+
+    bool enabled() const { return fd >= 0; }
+    // Whether [addr, addr + size) is whole pages inside the mapping
+    bool remappable(const void* addr, size_t size) const;
+    bool onFile(const void* addr) const;
+    // Whether the range is mapped shared, so its writes go to the file
+    bool shared(const void* addr) const;
+
+    // Put a range that is about to be handed out on file pages; its contents
+    // are unspecified
+    bool mapFile(void* addr, size_t size);
+    // Demotion, in three steps. copyOut writes the range to its file pages
+    // and leaves it as it is; mapCopied then maps those pages in its place (a
+    // write in between is lost by mapping); pageOut starts writeback, and RAM
+    // is reclaimed once the pages are clean. A shared range needs no copy.
+    bool copyOut(const void* addr, size_t size);
+    bool mapCopied(void* addr, size_t size);
+    void pageOut(void* addr, size_t size);
+    // Promotion: map the file pages copy-on-write in place of shared ones, so
+    // nothing is copied up front, and start reading them in
+    bool remapPrivate(void* addr, size_t size);
+    // Back the range with anonymous memory again and drop its file blocks.
+    // Contents are lost.
+    void discard(void* addr, size_t size);
+
+private:
+    enum Backing : uint8_t { ANONYMOUS, SHARED, PRIVATE };
+
+    char* base = nullptr;
+    size_t capacity = 0;
+    size_t pageSize = 0;
+    int fd = -1;
+    std::vector<Backing> pages; // Backing of each range, by its first page
+
+    size_t pageOf(const void* addr) const { return static_cast<size_t>(static_cast<const char*>(addr) - base) / pageSize; }
+    bool mapAt(void* addr, size_t size, int flags);
+};
+
+#endif // SWAP_FILE_H
@@ -0,0 +1,114 @@
+#include "tick_driver.h"
+
+namespace {
+    uint64_t pack(uint32_t front, uint32_t back) { return static_cast<uint64_t>(back) << 32 | front; }
+    uint32_t frontOf(uint64_t r) { return static_cast<uint32_t>(r); }
+    uint32_t backOf(uint64_t r) { return static_cast<uint32_t>(r >> 32); }
+}
+
+TickDriver::TickDriver(unsigned threads) : workers(threads ? threads : 1) {
+    for (unsigned i = 1; i < workers.size(); ++i) {
+        threadPool.emplace_back(&TickDriver::threadMain, this, i);
+    }
+}
+
+TickDriver::~TickDriver() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    startCv.notify_all();
+    for (auto& t : threadPool) t.join();
+}
+
+void TickDriver::runTick(size_t partitions, const PartitionFn& fn) {
+    // Contiguous initial ranges keep neighbouring processes on one worker
+    size_t n = workers.size();
+    for (size_t i = 0; i < n; ++i) {
+        workers[i].range.store(pack(static_cast<uint32_t>(partitions * i / n),
+                                    static_cast<uint32_t>(partitions * (i + 1) / n)),
+                               std::memory_order_relaxed);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        work = &fn;
+        running = static_cast<unsigned>(n - 1);
+        failure = nullptr;
+        generation++;
+    }
+    startCv.notify_all();
+
+    std::exception_ptr error;
+    try {
+        runWorker(0);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    std::unique_lock<std::mutex> lock(mtx);
+    doneCv.wait(lock, [&] { return running == 0; });
+    work = nullptr;
+    if (!error) error = failure;
+    lock.unlock();
+    if (error) std::rethrow_exception(error);
+}
+
+void TickDriver::threadMain(unsigned index) {
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            startCv.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        std::exception_ptr error;
+        try {
+            runWorker(index);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        if (error && !failure) failure = error;
+        if (--running == 0) doneCv.notify_one();
+    }
+}
+
+void TickDriver::runWorker(unsigned index) {
+    Worker& self = workers[index];
+    size_t partition;
+    do {
+        while (take(self, partition)) (*work)(index, partition);
+    } while (steal(index));
+}
+
+bool TickDriver::take(Worker& w, size_t& partition) {
+    uint64_t r = w.range.load(std::memory_order_acquire);
+    while (frontOf(r) < backOf(r)) {
+        if (w.range.compare_exchange_weak(r, pack(frontOf(r) + 1, backOf(r)), std::memory_order_acq_rel)) {
+            partition = frontOf(r);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Move the back half of the first non-empty victim range into the thief's own
+// (empty) range. Only the thief stores to its range while it is empty, and a
+// CAS on an empty range never succeeds, so the plain store cannot race.
+bool TickDriver::steal(unsigned thief) {
+    size_t n = workers.size();
+    for (size_t k = 1; k < n; ++k) {
+        Worker& victim = workers[(thief + k) % n];
+        uint64_t r = victim.range.load(std::memory_order_acquire);
+        while (frontOf(r) < backOf(r)) {
+            uint32_t count = backOf(r) - frontOf(r);
+            uint32_t split = backOf(r) - (count + 1) / 2;
+            if (victim.range.compare_exchange_weak(r, pack(frontOf(r), split), std::memory_order_acq_rel)) {
+                workers[thief].range.store(pack(split, backOf(r)), std::memory_order_release);
+                stolen.fetch_add(backOf(r) - split, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    return false;
+}
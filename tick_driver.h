@@ -0,0 +1,65 @@
+#ifndef TICK_DRIVER_H
+#define TICK_DRIVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "cache_line.h"
+
+// Fixed worker pool that runs one simulation tick at a time.
+// runTick() splits the partitions into one contiguous range per worker; a
+// worker takes partitions from the front of its own range and, once empty,
+// steals the back half of another worker's range. A range is a single packed
+// atomic word, so taking and stealing are one CAS each and never lock.
+// runTick() returns only when every partition is done, which is the tick
+// barrier: the caller then runs system-wide work while the workers are parked.
+// The calling thread is worker 0. Not reentrant; one caller at a time.
+class TickDriver {
+public:
+    // Work for one partition; worker is in [0, threads())
+    using PartitionFn = std::function<void(unsigned worker, size_t partition)>;
+
+    explicit TickDriver(unsigned threads);
+    ~TickDriver();
+    TickDriver(const TickDriver&) = delete;
+    TickDriver& operator=(const TickDriver&) = delete;
+
+    // Run work for every partition in [0, partitions); rethrows the first
+    // exception thrown by work once all workers have stopped
+    void runTick(size_t partitions, const PartitionFn& work);
+    unsigned threads() const { return static_cast<unsigned>(workers.size()); }
+    // Partitions moved between workers by stealing, over all ticks
+    uint64_t stolenCount() const { return stolen.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Worker {
+        std::atomic<uint64_t> range{0}; // back << 32 | front
+    };
+
+    std::vector<Worker> workers;
+    std::vector<std::thread> threadPool;
+    const PartitionFn* work = nullptr;
+    std::atomic<uint64_t> stolen{0};
+
+    std::mutex mtx; // Guards everything below
+    std::condition_variable startCv;
+    std::condition_variable doneCv;
+    uint64_t generation = 0;
+    unsigned running = 0; // Pool threads still working on this tick
+    bool stopping = false;
+    std::exception_ptr failure;
+
+    void threadMain(unsigned index);
+    void runWorker(unsigned index);
+    bool take(Worker& w, size_t& partition);
+    bool steal(unsigned thief);
+};
+
+#endif // TICK_DRIVER_H
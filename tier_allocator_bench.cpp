@@ -0,0 +1,174 @@
+// tier_allocator_bench.cpp
+// Allocation latency and fragmentation under the simulation's workload: every
+// tick each process frees one of its live blocks and allocates a new one of
+// 1-16 KiB scaled by its memory profile. Compares malloc/free, a bare
+// BuddyArena, and AdaptiveMemoryManager::allocateMemoryByTier/freeMemory.
+// Aborts first if the slow tier's LZ4 codec fails to round-trip its inputs.
+#include "buddy_arena.h"
+#include "adaptive_memory_manager.h"
+#include "event_log.h"
+#include "lz_codec.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+
+constexpr int NUM_PROCESSES = 10000;
+constexpr int LIVE_PER_PROCESS = 8;
+constexpr int TICKS = 50;
+constexpr size_t ARENA_SIZE = 1024ull * 1024 * 1024;
+
+void check(bool ok, const char* what) {
+    if (ok) return;
+    std::cerr << "self-check failed: " << what << "\n";
+    std::abort();
+}
+
+// Pages of the kinds the slow tier compresses (zeros, runs, text-like,
+// random) and a MAX_INPUT block must decompress to exactly their input;
+// random data must also be refused when there is no room to shrink it, and
+// a truncated block must fail to decode
+void selfCheck() {
+    const size_t page = 4096;
+    std::mt19937 rng(11);
+    std::vector<std::vector<uint8_t>> inputs(5, std::vector<uint8_t>(page));
+    for (size_t i = 0; i < page; ++i) {
+        inputs[1][i] = static_cast<uint8_t>(i / 64);
+        inputs[2][i] = static_cast<uint8_t>("the quick brown fox "[i % 20]);
+        inputs[3][i] = static_cast<uint8_t>(rng());
+    }
+    inputs[4].resize(Compression::MAX_INPUT);
+    for (size_t i = 0; i < inputs[4].size(); ++i) inputs[4][i] = static_cast<uint8_t>((i * i) >> 7);
+    std::vector<uint8_t> packed, unpacked;
+    for (const auto& in : inputs) {
+        packed.assign(in.size() + in.size() / 255 + 16, 0);
+        size_t n = Compression::compress(in.data(), in.size(), packed.data(), packed.size());
+        check(n > 0, "LZ4 compresses within the worst-case bound");
+        unpacked.assign(in.size(), 0);
+        check(Compression::decompress(packed.data(), n, unpacked.data(), unpacked.size()) && unpacked == in,
+              "LZ4 round trip");
+        if (n > 1) {
+            check(!Compression::decompress(packed.data(), n - 1, unpacked.data(), unpacked.size()),
+                  "LZ4 rejects a truncated block");
+        }
+    }
+    check(Compression::compress(inputs[3].data(), page, packed.data(), page / 2) == 0,
+          "LZ4 refuses random data it cannot shrink");
+}
+
+struct Op {
+    int process;
+    int slot;
+    size_t size;
+};
+
+// Deterministic op stream shared by every allocator
+std::vector<Op> makeWorkload(std::vector<int>& profiles) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> profileDist(0, 2);
+    std::uniform_int_distribution<int> memDist(1024, 16384);
+    std::uniform_int_distribution<int> slotDist(0, LIVE_PER_PROCESS - 1);
+    profiles.resize(NUM_PROCESSES);
+    for (auto& p : profiles) p = profileDist(rng);
+    std::vector<Op> ops;
+    ops.reserve(static_cast<size_t>(NUM_PROCESSES) * (LIVE_PER_PROCESS + TICKS));
+    // Fill every slot first, then churn one slot per process per tick
+    for (int s = 0; s < LIVE_PER_PROCESS; ++s)
+        for (int p = 0; p < NUM_PROCESSES; ++p) ops.push_back({p, s, static_cast<size_t>(memDist(rng) * (profiles[p] + 1) / 3)});
+    for (int t = 0; t < TICKS; ++t)
+        for (int p = 0; p < NUM_PROCESSES; ++p) ops.push_back({p, slotDist(rng), static_cast<size_t>(memDist(rng) * (profiles[p] + 1) / 3)});
+    return ops;
+}
+
+struct Result {
+    std::vector<double> allocNs;
+    std::vector<double> freeNs;
+    double internalFrag = 0.0; // 1 - requested / reserved
+    double externalFrag = 0.0; // 1 - largest free block / free bytes
+};
+
+double percentile(std::vector<double>& v, double p) {
+    if (v.empty()) return 0.0;
+    size_t i = static_cast<size_t>(p * (v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + i, v.end());
+    return v[i];
+}
+
+// alloc(op) -> void*, release(op, ptr); both timed individually
+template <typename Alloc, typename Free>
+Result run(const std::vector<Op>& ops, Alloc&& alloc, Free&& release) {
+    Result r;
+    r.allocNs.reserve(ops.size());
+    r.freeNs.reserve(ops.size());
+    std::vector<void*> live(static_cast<size_t>(NUM_PROCESSES) * LIVE_PER_PROCESS, nullptr);
+    using clock = std::chrono::steady_clock;
+    for (const Op& op : ops) {
+        void*& slot = live[static_cast<size_t>(op.process) * LIVE_PER_PROCESS + op.slot];
+        if (slot) {
+            auto start = clock::now();
+            release(op, slot);
+            r.freeNs.push_back(std::chrono::duration<double, std::nano>(clock::now() - start).count());
+        }
+        auto start = clock::now();
+        slot = alloc(op);
+        r.allocNs.push_back(std::chrono::duration<double, std::nano>(clock::now() - start).count());
+    }
+    return r;
+}
+
+void print(const char* name, Result r, bool showFrag) {
+    std::cout << std::fixed << std::setprecision(1)
+              << std::setw(10) << name
+              << std::setw(10) << percentile(r.allocNs, 0.5)
+              << std::setw(10) << percentile(r.allocNs, 0.99)
+              << std::setw(10) << percentile(r.freeNs, 0.5)
+              << std::setw(10) << percentile(r.freeNs, 0.99);
+    if (showFrag) {
+        std::cout << std::setw(11) << r.internalFrag * 100 << "%" << std::setw(11) << r.externalFrag * 100 << "%";
+    }
+    std::cout << "\n";
+}
+
+int main() {
+    selfCheck();
+    std::vector<int> profiles;
+    std::vector<Op> ops = makeWorkload(profiles);
+    std::cout << ops.size() << " allocations, " << NUM_PROCESSES << " processes x "
+              << LIVE_PER_PROCESS << " live blocks, 1-16 KiB\n\n";
+    std::cout << std::setw(10) << "allocator" << std::setw(10) << "alloc p50" << std::setw(10) << "alloc p99"
+              << std::setw(10) << "free p50" << std::setw(10) << "free p99"
+              << std::setw(12) << "int. frag" << std::setw(12) << "ext. frag" << "  (ns)\n";
+
+    print("malloc", run(ops, [](const Op& op) { return std::malloc(op.size); },
+                        [](const Op&, void* p) { std::free(p); }), false);
+
+    BuddyArena arena(ARENA_SIZE);
+    size_t requested = 0;
+    std::vector<size_t> liveSize(static_cast<size_t>(NUM_PROCESSES) * LIVE_PER_PROCESS, 0);
+    Result buddy = run(ops,
+        [&](const Op& op) {
+            size_t& s = liveSize[static_cast<size_t>(op.process) * LIVE_PER_PROCESS + op.slot];
+            requested += op.size - s;
+            s = op.size;
+            return arena.allocate(op.size);
+        },
+        [&](const Op&, void* p) { arena.release(p); });
+    size_t used = arena.capacityBytes() - arena.freeBytes();
+    buddy.internalFrag = 1.0 - static_cast<double>(requested) / used;
+    buddy.externalFrag = 1.0 - static_cast<double>(arena.largestFreeBlock()) / arena.freeBytes();
+    print("buddy", buddy, true);
+
+    // The manager logs every allocation; keep the sink quiet for timing
+    EventLog::instance().setLevel(LogLevel::OFF);
+    AdaptiveMemoryManager manager;
+    for (int p = 0; p < NUM_PROCESSES; ++p) manager.registerProcess(p);
+    const SecurityLevel levels[] = {SecurityLevel::LOW, SecurityLevel::MEDIUM, SecurityLevel::HIGH};
+    print("manager", run(ops,
+        [&](const Op& op) { return manager.allocateMemoryByTier(op.process, op.size, levels[profiles[op.process]]); },
+        [&](const Op& op, void* p) { manager.freeMemory(op.process, p); }), false);
+    return 0;
+}
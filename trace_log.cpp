@@ -0,0 +1,432 @@
+#include "trace_log.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+
+namespace {
+    constexpr char MAGIC[8] = {'O', 'S', 'T', 'R', 'A', 'C', 'E', '1'};
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t FILE_HEADER_BYTES = 16;
+    // Chunk header: payload bytes, records, stream, reserved, first timestamp
+    constexpr size_t CHUNK_HEADER_BYTES = 24;
+    // Worst case of one record: op, five 10-byte varints, four arguments and
+    // a name with its length
+    constexpr size_t MAX_RECORD_BYTES = 1 + 10 * 7 + 2 + TraceRecorder::MAX_NAME;
+    // Recording threads a trace may have
+    constexpr uint32_t MAX_STREAMS = 1 << 16;
+    // Free chunks kept for reuse
+    constexpr size_t SPARE_CHUNKS = 16;
+
+    struct OpLayout {
+        const char* name;
+        bool pid;
+        bool addr;
+        uint8_t args;
+    };
+    constexpr OpLayout LAYOUT[] = {
+        {"schedRegister", true, false, 0},
+        {"schedUnregister", true, false, 0},
+        {"usageUpdate", true, false, 4},
+        {"calculatePriorities", false, false, 0},
+        {"topK", false, false, 1},
+        {"nextDecision", false, false, 0},
+        {"memRegister", true, false, 0},
+        {"memUnregister", true, false, 0},
+        {"analyzeMemory", false, false, 0},
+        {"predictMemory", true, false, 1},
+        {"allocateTier", true, true, 2},
+        {"freeMemory", true, true, 0},
+        {"releaseProcess", true, false, 0},
+        {"recordAccess", true, true, 1},
+        {"rebalance", false, false, 0},
+        {"secRegister", true, false, 0},
+        {"secUnregister", true, false, 0},
+        {"allocateSecure", true, true, 2},
+        {"freeSecure", true, true, 0},
+        {"monitorAccess", false, false, 0},
+        {"encrypt", true, true, 0},
+        {"decrypt", true, true, 0},
+        {"validateAccess", true, true, 2},
+    };
+    static_assert(std::size(LAYOUT) == static_cast<size_t>(TraceOp::COUNT), "one layout per op");
+
+    uint64_t nowNs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    uint64_t zigzag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+    int64_t unzigzag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+    void putVarint(uint8_t*& p, uint64_t v) {
+        while (v >= 0x80) {
+            *p++ = static_cast<uint8_t>(v | 0x80);
+            v >>= 7;
+        }
+        *p++ = static_cast<uint8_t>(v);
+    }
+
+    bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) return false;
+            uint8_t b = *p++;
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    void put32(uint8_t* p, uint32_t v) { std::memcpy(p, &v, sizeof v); }
+    void put64(uint8_t* p, uint64_t v) { std::memcpy(p, &v, sizeof v); }
+    uint32_t get32(const uint8_t* p) {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof v);
+        return v;
+    }
+    uint64_t get64(const uint8_t* p) {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof v);
+        return v;
+    }
+
+    bool writeAll(int fd, iovec* iov, int count) {
+        while (count > 0) {
+            ssize_t n = writev(fd, iov, count);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            size_t done = static_cast<size_t>(n);
+            for (; count > 0 && done >= iov->iov_len; ++iov, --count) done -= iov->iov_len;
+            if (count > 0) {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+                iov->iov_len -= done;
+            }
+        }
+        return true;
+    }
+}
+
+const char* traceOpName(TraceOp op) {
+    return op < TraceOp::COUNT ? LAYOUT[static_cast<size_t>(op)].name : "unknown";
+}
+
+bool traceOpHasPid(TraceOp op) { return op < TraceOp::COUNT && LAYOUT[static_cast<size_t>(op)].pid; }
+
+// Owns the calling thread's buffers, one per recorder it has recorded into;
+// marks them abandoned on thread exit so flush() can drop them
+struct TraceBufferHandle {
+    std::vector<std::pair<uint64_t, std::shared_ptr<TraceRecorder::ThreadBuffer>>> buffers;
+    ~TraceBufferHandle() {
+        for (auto& entry : buffers) entry.second->abandoned.store(true, std::memory_order_release);
+    }
+};
+
+namespace {
+    std::atomic<uint64_t> nextRecorderId{1};
+}
+
+TraceRecorder::TraceRecorder(const std::string& path) : id(nextRecorderId.fetch_add(1, std::memory_order_relaxed)) {
+    int file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (file < 0) return;
+    uint8_t header[FILE_HEADER_BYTES];
+    std::memcpy(header, MAGIC, sizeof MAGIC);
+    put32(header + 8, VERSION);
+    put32(header + 12, static_cast<uint32_t>(CHUNK_HEADER_BYTES));
+    iovec iov{header, sizeof header};
+    if (!writeAll(file, &iov, 1)) {
+        close(file);
+        return;
+    }
+    fd = file;
+    written.store(sizeof header, std::memory_order_relaxed);
+    writer = std::thread([this] { writerLoop(); });
+}
+
+TraceRecorder::~TraceRecorder() {
+    if (!ok()) return;
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(queueMtx);
+        stopping = true;
+    }
+    queueCv.notify_all();
+    writer.join();
+    close(fd);
+}
+
+TraceRecorder::ThreadBuffer& TraceRecorder::localBuffer() {
+    thread_local TraceBufferHandle handle;
+    for (auto& entry : handle.buffers) {
+        if (entry.first == id) return *entry.second;
+    }
+    // Forget buffers of recorders that are gone
+    handle.buffers.erase(std::remove_if(handle.buffers.begin(), handle.buffers.end(),
+                                        [](const auto& entry) { return entry.second.use_count() == 1; }),
+                         handle.buffers.end());
+    auto buffer = std::make_shared<ThreadBuffer>();
+    {
+        std::lock_guard<std::mutex> lock(registryMtx);
+        buffer->stream = nextStream++;
+        buffers.push_back(buffer);
+    }
+    handle.buffers.emplace_back(id, buffer);
+    return *buffer;
+}
+
+void TraceRecorder::record(TraceOp op, pid_t pid, const void* addr, int64_t a, int64_t b, int64_t c, int64_t d) {
+    const int64_t args[4] = {a, b, c, d};
+    append(op, pid, addr, args, nullptr);
+}
+
+void TraceRecorder::recordRegister(pid_t pid, const std::string& name) {
+    const int64_t args[4] = {};
+    append(TraceOp::SCHED_REGISTER, pid, nullptr, args, &name);
+}
+
+void TraceRecorder::append(TraceOp op, pid_t pid, const void* addr, const int64_t* args, const std::string* name) {
+    if (!ok() || op >= TraceOp::COUNT) return;
+    const OpLayout& layout = LAYOUT[static_cast<size_t>(op)];
+    ThreadBuffer& buffer = localBuffer();
+    uint64_t now = nowNs();
+    std::lock_guard<std::mutex> lock(buffer.mtx);
+    if (!buffer.chunk || buffer.chunk->used + MAX_RECORD_BYTES > CHUNK_BYTES) sealLocked(buffer);
+    Chunk& chunk = *buffer.chunk;
+    if (chunk.records == 0) {
+        chunk.firstNs = now;
+        buffer.lastNs = now;
+        buffer.lastPid = 0;
+        buffer.lastAddr = 0;
+    }
+    now = std::max(now, buffer.lastNs);
+    uint8_t* p = chunk.data + chunk.used;
+    *p++ = static_cast<uint8_t>(op);
+    putVarint(p, now - buffer.lastNs);
+    buffer.lastNs = now;
+    if (layout.pid) {
+        putVarint(p, zigzag(static_cast<int64_t>(pid) - buffer.lastPid));
+        buffer.lastPid = pid;
+    }
+    if (layout.addr) {
+        auto a = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(addr));
+        putVarint(p, zigzag(static_cast<int64_t>(a - buffer.lastAddr)));
+        buffer.lastAddr = a;
+    }
+    for (uint8_t i = 0; i < layout.args; ++i) putVarint(p, zigzag(args[i]));
+    if (name) {
+        size_t n = std::min(name->size(), MAX_NAME);
+        putVarint(p, n);
+        std::memcpy(p, name->data(), n);
+        p += n;
+    }
+    chunk.used = static_cast<uint32_t>(p - chunk.data);
+    chunk.records++;
+}
+
+// Queue the buffer's chunk, if it has records, for the writer and give the
+// buffer an empty one. Caller holds buffer.mtx.
+void TraceRecorder::sealLocked(ThreadBuffer& buffer) {
+    std::lock_guard<std::mutex> lock(queueMtx);
+    if (buffer.chunk && buffer.chunk->records == 0) return;
+    if (buffer.chunk) {
+        records.fetch_add(buffer.chunk->records, std::memory_order_relaxed);
+        sealed.emplace_back(buffer.stream, std::move(buffer.chunk));
+        sealedCount++;
+        queueCv.notify_all();
+    }
+    if (!spare.empty()) {
+        buffer.chunk = std::move(spare.back());
+        spare.pop_back();
+    } else {
+        buffer.chunk.reset(new Chunk);
+    }
+    buffer.chunk->records = 0;
+    buffer.chunk->used = 0;
+}
+
+void TraceRecorder::flush() {
+    if (!ok()) return;
+    {
+        std::lock_guard<std::mutex> lock(registryMtx);
+        for (size_t i = 0; i < buffers.size();) {
+            ThreadBuffer& buffer = *buffers[i];
+            // Read the flag first so a record made just before exit is not lost
+            bool abandoned = buffer.abandoned.load(std::memory_order_acquire);
+            {
+                std::lock_guard<std::mutex> bufferLock(buffer.mtx);
+                if (buffer.chunk && buffer.chunk->records > 0) sealLocked(buffer);
+            }
+            if (abandoned) {
+                buffers[i] = std::move(buffers.back());
+                buffers.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+    std::unique_lock<std::mutex> lock(queueMtx);
+    uint64_t ticket = sealedCount;
+    queueCv.wait(lock, [&] { return writtenCount >= ticket; });
+}
+
+void TraceRecorder::writerLoop() {
+    std::vector<std::pair<uint32_t, std::unique_ptr<Chunk>>> batch;
+    std::unique_lock<std::mutex> lock(queueMtx);
+    for (;;) {
+        queueCv.wait(lock, [&] { return stopping || !sealed.empty(); });
+        if (sealed.empty()) return;
+        batch.swap(sealed);
+        lock.unlock();
+        for (auto& [stream, chunk] : batch) {
+            uint8_t header[CHUNK_HEADER_BYTES];
+            put32(header, chunk->used);
+            put32(header + 4, chunk->records);
+            put32(header + 8, stream);
+            put32(header + 12, 0);
+            put64(header + 16, chunk->firstNs);
+            iovec iov[2] = {{header, sizeof header}, {chunk->data, chunk->used}};
+            if (writeAll(fd, iov, 2)) written.fetch_add(sizeof header + chunk->used, std::memory_order_relaxed);
+        }
+        lock.lock();
+        writtenCount += batch.size();
+        for (auto& entry : batch) {
+            if (spare.size() < SPARE_CHUNKS) spare.push_back(std::move(entry.second));
+        }
+        batch.clear();
+        queueCv.notify_all();
+    }
+}
+
+TraceReader::TraceReader(const std::string& path) {
+    int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0) return;
+    struct stat st;
+    if (fstat(file, &st) != 0 || static_cast<size_t>(st.st_size) < FILE_HEADER_BYTES) {
+        close(file);
+        return;
+    }
+    size_t bytes = static_cast<size_t>(st.st_size);
+    void* mem = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mem == MAP_FAILED) return;
+    auto p = static_cast<const uint8_t*>(mem);
+    if (std::memcmp(p, MAGIC, sizeof MAGIC) != 0 || get32(p + 8) != VERSION ||
+        get32(p + 12) != CHUNK_HEADER_BYTES) {
+        munmap(mem, bytes);
+        return;
+    }
+    madvise(mem, bytes, MADV_SEQUENTIAL);
+    data = p;
+    size = bytes;
+    // Index the chunks by stream; only the headers are read
+    for (size_t pos = FILE_HEADER_BYTES; pos < size;) {
+        if (size - pos < CHUNK_HEADER_BYTES) {
+            damaged = true;
+            break;
+        }
+        uint32_t payload = get32(data + pos);
+        uint32_t count = get32(data + pos + 4);
+        uint32_t stream = get32(data + pos + 8);
+        if (payload > size - pos - CHUNK_HEADER_BYTES || stream >= MAX_STREAMS) {
+            damaged = true;
+            break;
+        }
+        if (streams.size() <= stream) streams.resize(stream + 1);
+        streams[stream].chunks.push_back({pos + CHUNK_HEADER_BYTES, payload, count, get64(data + pos + 16)});
+        total += count;
+        pos += CHUNK_HEADER_BYTES + payload;
+    }
+    rewind();
+}
+
+TraceReader::~TraceReader() {
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+}
+
+void TraceReader::rewind() {
+    for (Stream& s : streams) {
+        s.chunk = 0;
+        s.left = 0;
+        s.pending = false;
+        if (s.chunks.empty()) continue;
+        s.pos = s.chunks[0].offset;
+        s.left = s.chunks[0].records;
+        s.lastNs = s.chunks[0].firstNs;
+        s.lastAddr = 0;
+        s.lastPid = 0;
+    }
+}
+
+// Decode the stream's next record into s.head; false at its end
+bool TraceReader::advance(uint32_t index, Stream& s) {
+    while (s.left == 0) {
+        if (s.chunks.empty() || ++s.chunk >= s.chunks.size()) return false;
+        const ChunkRef& c = s.chunks[s.chunk];
+        s.pos = c.offset;
+        s.left = c.records;
+        s.lastNs = c.firstNs;
+        s.lastAddr = 0;
+        s.lastPid = 0;
+    }
+    const ChunkRef& c = s.chunks[s.chunk];
+    const uint8_t* p = data + s.pos;
+    const uint8_t* end = data + c.offset + c.bytes;
+    auto fail = [&] {
+        damaged = true;
+        s.left = 0;
+        s.chunk = s.chunks.size();
+        return false;
+    };
+    if (p >= end || *p >= static_cast<uint8_t>(TraceOp::COUNT)) return fail();
+    TraceRecord& r = s.head;
+    r = TraceRecord();
+    r.op = static_cast<TraceOp>(*p++);
+    r.stream = index;
+    const OpLayout& layout = LAYOUT[static_cast<size_t>(r.op)];
+    uint64_t v;
+    if (!getVarint(p, end, v)) return fail();
+    s.lastNs += v;
+    r.timestampNs = s.lastNs;
+    if (layout.pid) {
+        if (!getVarint(p, end, v)) return fail();
+        s.lastPid = static_cast<pid_t>(s.lastPid + unzigzag(v));
+        r.pid = s.lastPid;
+    }
+    if (layout.addr) {
+        if (!getVarint(p, end, v)) return fail();
+        s.lastAddr += static_cast<uint64_t>(unzigzag(v));
+        r.addr = s.lastAddr;
+    }
+    for (uint8_t i = 0; i < layout.args; ++i) {
+        if (!getVarint(p, end, v)) return fail();
+        r.args[i] = unzigzag(v);
+    }
+    if (r.op == TraceOp::SCHED_REGISTER) {
+        if (!getVarint(p, end, v) || v > TraceRecorder::MAX_NAME || v > static_cast<uint64_t>(end - p)) return fail();
+        r.name = reinterpret_cast<const char*>(p);
+        r.nameLength = static_cast<uint32_t>(v);
+        p += v;
+    }
+    s.pos = static_cast<size_t>(p - data);
+    s.left--;
+    return true;
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    Stream* earliest = nullptr;
+    for (uint32_t i = 0; i < streams.size(); ++i) {
+        Stream& s = streams[i];
+        if (!s.pending) s.pending = advance(i, s);
+        if (s.pending && (!earliest || s.head.timestampNs < earliest->head.timestampNs)) earliest = &s;
+    }
+    if (!earliest) return false;
+    record = earliest->head;
+    earliest->pending = false;
+    return true;
+}
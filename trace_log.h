@@ -0,0 +1,187 @@
+#ifndef TRACE_LOG_H
+#define TRACE_LOG_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using pid_t = int;
+
+// Calls into the three managers captured by a TraceRecorder. Each carries
+// the fields listed (pid unless noted); `addr` is an address passed in or,
+// for allocations, the one returned (0 on failure).
+enum class TraceOp : uint8_t {
+    // AdaptiveScheduler
+    SCHED_REGISTER,       // name
+    SCHED_UNREGISTER,
+    USAGE_UPDATE,         // args = event type, previous pid, cpu, io
+    CALCULATE_PRIORITIES, // no pid
+    TOP_K,                // no pid; args = n
+    NEXT_DECISION,        // no pid
+    // AdaptiveMemoryManager
+    MEM_REGISTER,
+    MEM_UNREGISTER,
+    ANALYZE_MEMORY,       // no pid
+    PREDICT_MEMORY,       // args = current usage
+    ALLOCATE_TIER,        // addr; args = size, security level
+    FREE_MEMORY,          // addr
+    RELEASE_PROCESS,
+    RECORD_ACCESS,        // addr; args = count
+    REBALANCE,            // no pid
+    // SecurityMemoryManager
+    SEC_REGISTER,
+    SEC_UNREGISTER,
+    ALLOCATE_SECURE,      // addr; args = size, security level
+    FREE_SECURE,          // addr
+    MONITOR_ACCESS,       // no pid
+    ENCRYPT,              // addr
+    DECRYPT,              // addr
+    VALIDATE_ACCESS,      // addr; args = size, access type
+    COUNT
+};
+
+const char* traceOpName(TraceOp op);
+// False for the calls marked "no pid"
+bool traceOpHasPid(TraceOp op);
+
+// One decoded call. `name` points into the trace file and is only set for
+// SCHED_REGISTER.
+struct TraceRecord {
+    uint64_t timestampNs = 0;
+    uint64_t addr = 0;
+    int64_t args[4] = {};
+    const char* name = nullptr;
+    uint32_t nameLength = 0;
+    uint32_t stream = 0; // Recording thread
+    pid_t pid = 0;
+    TraceOp op = TraceOp::COUNT;
+};
+
+// Binary call log. The file is a header followed by chunks of records, each
+// chunk from one recording thread (its stream) and decodable on its own.
+// Inside a chunk every field is a LEB128 varint: timestamps as the delta from
+// the previous record, pids and addresses as zigzag deltas, and arguments
+// zigzag encoded, so a typical call takes 6-12 bytes.
+//
+// Each recording thread appends to its own chunk under an uncontended lock
+// (taken by another thread only to flush); full chunks go to a writer thread,
+// which does all the I/O. Managers hold a raw pointer to the recorder, so
+// detach it from them (setTraceRecorder(nullptr)) before destroying it.
+class TraceRecorder {
+public:
+    static constexpr size_t CHUNK_BYTES = 64 * 1024;
+    static constexpr size_t MAX_NAME = 255; // Longer names are cut
+
+    // Record into path, truncating it; check ok()
+    explicit TraceRecorder(const std::string& path);
+    ~TraceRecorder();
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    bool ok() const { return fd >= 0; }
+    void record(TraceOp op, pid_t pid, const void* addr = nullptr, int64_t a = 0, int64_t b = 0, int64_t c = 0,
+                int64_t d = 0);
+    void recordRegister(pid_t pid, const std::string& name);
+    // Block until everything recorded before this call is written
+    void flush();
+    // Both counted per chunk handed to the writer: current after flush()
+    uint64_t recordCount() const { return records.load(std::memory_order_relaxed); }
+    uint64_t bytesWritten() const { return written.load(std::memory_order_relaxed); }
+
+private:
+    struct Chunk {
+        uint32_t records = 0;
+        uint32_t used = 0;
+        uint64_t firstNs = 0;
+        uint8_t data[CHUNK_BYTES];
+    };
+    struct ThreadBuffer {
+        std::mutex mtx;
+        std::unique_ptr<Chunk> chunk;
+        // Delta bases; reset with each chunk
+        uint64_t lastNs = 0;
+        uint64_t lastAddr = 0;
+        pid_t lastPid = 0;
+        uint32_t stream = 0;
+        std::atomic<bool> abandoned{false}; // Owning thread has exited
+    };
+    friend struct TraceBufferHandle;
+
+    ThreadBuffer& localBuffer();
+    void append(TraceOp op, pid_t pid, const void* addr, const int64_t* args, const std::string* name);
+    void sealLocked(ThreadBuffer& buffer);
+    void writerLoop();
+
+    const uint64_t id; // Tells this recorder's thread buffers from others'
+    int fd = -1;
+    std::atomic<uint64_t> records{0};
+    std::atomic<uint64_t> written{0};
+
+    std::mutex registryMtx; // Guards buffers
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    uint32_t nextStream = 0;
+
+    std::mutex queueMtx; // Guards the queues and the writer state
+    std::condition_variable queueCv;
+    std::vector<std::pair<uint32_t, std::unique_ptr<Chunk>>> sealed; // Stream and chunk, in order
+    std::vector<std::unique_ptr<Chunk>> spare;
+    uint64_t sealedCount = 0;
+    uint64_t writtenCount = 0;
+    bool stopping = false;
+    std::thread writer;
+};
+
+// Read side: maps a trace file and yields its records in timestamp order,
+// merging the streams. Bounds-checked; a malformed chunk ends its stream and
+// sets corrupt().
+class TraceReader {
+public:
+    explicit TraceReader(const std::string& path);
+    ~TraceReader();
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    bool ok() const { return data != nullptr; }
+    bool corrupt() const { return damaged; }
+    size_t fileBytes() const { return size; }
+    // Records in the file, from the chunk headers
+    uint64_t recordCount() const { return total; }
+    // Start over from the first record
+    void rewind();
+    bool next(TraceRecord& record);
+
+private:
+    struct ChunkRef {
+        size_t offset; // Of the payload
+        uint32_t bytes;
+        uint32_t records;
+        uint64_t firstNs;
+    };
+    struct Stream {
+        std::vector<ChunkRef> chunks;
+        size_t chunk = 0;  // Current chunk
+        size_t pos = 0;    // Into its payload
+        uint32_t left = 0; // Records left in it
+        uint64_t lastNs = 0;
+        uint64_t lastAddr = 0;
+        pid_t lastPid = 0;
+        bool pending = false; // head holds the next record
+        TraceRecord head;
+    };
+
+    bool advance(uint32_t index, Stream& s);
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    uint64_t total = 0;
+    bool damaged = false;
+    std::vector<Stream> streams;
+};
+
+#endif // TRACE_LOG_H
@@ -0,0 +1,250 @@
+#include "trace_replay.h"
+#include "spsc_ring.h"
+#include <chrono>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+// Replays the calls routed to it. Recorded addresses are translated through
+// the blocks it allocated in their place, kept per process: every call that
+// names an address also names its pid, so a process's blocks never leave its
+// worker.
+class TraceReplayer::Worker {
+public:
+    explicit Worker(TraceReplayer& owner) : owner(owner), ring(RING_CAPACITY) {}
+
+    void execute(const TraceRecord& r);
+
+    // Threaded use: start(), then submit() from one thread, drain() to wait
+    // for everything submitted, finish() to stop
+    void start() { thread = std::thread([this] { run(); }); }
+    void submit(const TraceRecord& r) {
+        while (!ring.push(r)) std::this_thread::yield();
+        ++sent;
+    }
+    void drain() {
+        while (done.load(std::memory_order_acquire) != sent) std::this_thread::yield();
+    }
+    void finish() {
+        stopping.store(true, std::memory_order_release);
+        if (thread.joinable()) thread.join();
+    }
+
+    ReplayStats stats;
+
+private:
+    static constexpr size_t RING_CAPACITY = 4096;
+    static constexpr size_t POP_BATCH = 64;
+
+    struct Block {
+        void* addr; // Replayed
+        uint64_t size;
+    };
+    using Blocks = std::map<uint64_t, Block>; // By recorded address
+    struct ProcessBlocks {
+        Blocks tier;
+        Blocks secure;
+    };
+
+    void run();
+    // Record an allocation's outcome; frees what only the replay got
+    void mapAllocation(const TraceRecord& r, Blocks& blocks, void* replayed);
+    // The replayed block at exactly r.addr, or nullptr (counted unknown)
+    void* exact(const TraceRecord& r, Blocks& blocks, bool erase);
+    // The replayed address of r.addr inside a block, or nullptr
+    void* inside(const TraceRecord& r, const Blocks& blocks) const;
+
+    TraceReplayer& owner;
+    std::unordered_map<pid_t, ProcessBlocks> processes;
+    SpscRing<TraceRecord> ring;
+    std::atomic<uint64_t> done{0};
+    uint64_t sent = 0;
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+};
+
+void TraceReplayer::Worker::run() {
+    TraceRecord batch[POP_BATCH];
+    for (;;) {
+        size_t n = ring.popBulk(batch, POP_BATCH);
+        if (n == 0) {
+            if (stopping.load(std::memory_order_acquire) && ring.empty()) return;
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < n; ++i) execute(batch[i]);
+        done.fetch_add(n, std::memory_order_release);
+    }
+}
+
+void TraceReplayer::Worker::mapAllocation(const TraceRecord& r, Blocks& blocks, void* replayed) {
+    if (r.addr && replayed) {
+        blocks[r.addr] = Block{replayed, static_cast<uint64_t>(r.args[0])};
+        return;
+    }
+    if (!r.addr && !replayed) return;
+    stats.divergedAllocations++;
+    if (!replayed) return;
+    if (r.op == TraceOp::ALLOCATE_TIER) owner.memory.freeMemory(r.pid, replayed);
+    else owner.security.freeSecureMemory(r.pid, replayed);
+}
+
+void* TraceReplayer::Worker::exact(const TraceRecord& r, Blocks& blocks, bool erase) {
+    auto it = blocks.find(r.addr);
+    if (it == blocks.end()) {
+        stats.unknownAddresses++;
+        return nullptr;
+    }
+    void* addr = it->second.addr;
+    if (erase) blocks.erase(it);
+    return addr;
+}
+
+void* TraceReplayer::Worker::inside(const TraceRecord& r, const Blocks& blocks) const {
+    auto it = blocks.upper_bound(r.addr);
+    if (it == blocks.begin()) return nullptr;
+    --it;
+    uint64_t offset = r.addr - it->first;
+    if (offset >= it->second.size) return nullptr;
+    return static_cast<char*>(it->second.addr) + offset;
+}
+
+void TraceReplayer::Worker::execute(const TraceRecord& r) {
+    stats.records++;
+    stats.calls[static_cast<size_t>(r.op)]++;
+    AdaptiveScheduler& scheduler = owner.scheduler;
+    AdaptiveMemoryManager& memory = owner.memory;
+    SecurityMemoryManager& security = owner.security;
+    switch (r.op) {
+        case TraceOp::SCHED_REGISTER:
+            scheduler.registerProcess(r.pid, std::string(r.name, r.nameLength));
+            break;
+        case TraceOp::SCHED_UNREGISTER:
+            scheduler.unregisterProcess(r.pid);
+            break;
+        case TraceOp::USAGE_UPDATE: {
+            ApplicationEvent event{static_cast<ApplicationEvent::Type>(r.args[0]), static_cast<pid_t>(r.args[1])};
+            scheduler.updateUsageMetrics(r.pid, event, static_cast<int>(r.args[2]), static_cast<int>(r.args[3]));
+            break;
+        }
+        case TraceOp::CALCULATE_PRIORITIES:
+            scheduler.calculateProcessPriorities();
+            break;
+        case TraceOp::TOP_K:
+            scheduler.topK(static_cast<size_t>(r.args[0]));
+            break;
+        case TraceOp::NEXT_DECISION: {
+            AdaptiveScheduler::SchedulingDecision decision;
+            scheduler.next(decision);
+            break;
+        }
+        case TraceOp::MEM_REGISTER:
+            // Registering again releases the process's blocks, as unregistering does
+            memory.registerProcess(r.pid);
+            processes[r.pid].tier.clear();
+            break;
+        case TraceOp::MEM_UNREGISTER:
+            memory.unregisterProcess(r.pid);
+            processes[r.pid].tier.clear();
+            break;
+        case TraceOp::ANALYZE_MEMORY:
+            memory.analyzeMemoryUsage();
+            break;
+        case TraceOp::PREDICT_MEMORY:
+            memory.predictMemoryNeeds(r.pid, static_cast<size_t>(r.args[0]));
+            break;
+        case TraceOp::ALLOCATE_TIER: {
+            void* addr = memory.allocateMemoryByTier(r.pid, static_cast<size_t>(r.args[0]),
+                                                     static_cast<SecurityLevel>(r.args[1]));
+            mapAllocation(r, processes[r.pid].tier, addr);
+            break;
+        }
+        case TraceOp::FREE_MEMORY:
+            memory.freeMemory(r.pid, exact(r, processes[r.pid].tier, true));
+            break;
+        case TraceOp::RELEASE_PROCESS:
+            memory.releaseProcess(r.pid);
+            processes[r.pid].tier.clear();
+            break;
+        case TraceOp::RECORD_ACCESS: {
+            void* addr = inside(r, processes[r.pid].tier);
+            if (!addr) stats.unknownAddresses++;
+            memory.recordMemoryAccess(r.pid, addr, static_cast<uint32_t>(r.args[0]));
+            break;
+        }
+        case TraceOp::REBALANCE:
+            memory.rebalanceOnce();
+            break;
+        case TraceOp::SEC_REGISTER:
+            security.registerProcess(r.pid);
+            break;
+        case TraceOp::SEC_UNREGISTER:
+            security.unregisterProcess(r.pid);
+            processes[r.pid].secure.clear();
+            break;
+        case TraceOp::ALLOCATE_SECURE: {
+            MemoryRegion region = security.allocateSecureMemory(r.pid, static_cast<size_t>(r.args[0]),
+                                                                static_cast<SecurityLevel>(r.args[1]));
+            mapAllocation(r, processes[r.pid].secure, region.address);
+            break;
+        }
+        case TraceOp::FREE_SECURE:
+            security.freeSecureMemory(r.pid, exact(r, processes[r.pid].secure, true));
+            break;
+        case TraceOp::MONITOR_ACCESS:
+            security.monitorMemoryAccess();
+            break;
+        case TraceOp::ENCRYPT:
+            security.encryptMemory(r.pid, exact(r, processes[r.pid].secure, false));
+            break;
+        case TraceOp::DECRYPT:
+            security.decryptMemory(r.pid, exact(r, processes[r.pid].secure, false));
+            break;
+        case TraceOp::VALIDATE_ACCESS: {
+            // Addresses outside the process's regions are replayed as recorded:
+            // the manager treats them as untracked either way
+            void* addr = inside(r, processes[r.pid].secure);
+            if (!addr) addr = reinterpret_cast<void*>(r.addr);
+            security.validateMemoryAccess(r.pid, addr, static_cast<size_t>(r.args[0]),
+                                          static_cast<AccessType>(r.args[1]));
+            break;
+        }
+        case TraceOp::COUNT:
+            break;
+    }
+}
+
+ReplayStats TraceReplayer::replay(TraceReader& trace, unsigned threads) {
+    auto start = std::chrono::steady_clock::now();
+    // Runs everything single-threaded, and the calls without a pid otherwise
+    Worker local(*this);
+    std::vector<std::unique_ptr<Worker>> workers;
+    if (threads > 1) {
+        for (unsigned i = 0; i < threads; ++i) {
+            workers.push_back(std::make_unique<Worker>(*this));
+            workers.back()->start();
+        }
+    }
+    TraceRecord r;
+    while (trace.next(r)) {
+        if (workers.empty()) {
+            local.execute(r);
+        } else if (!traceOpHasPid(r.op)) {
+            for (auto& w : workers) w->drain();
+            local.execute(r);
+        } else {
+            workers[(static_cast<uint32_t>(r.pid) * 2654435761u) % workers.size()]->submit(r);
+        }
+    }
+    ReplayStats stats = local.stats;
+    for (auto& w : workers) {
+        w->finish();
+        const ReplayStats& s = w->stats;
+        stats.records += s.records;
+        for (size_t i = 0; i < static_cast<size_t>(TraceOp::COUNT); ++i) stats.calls[i] += s.calls[i];
+        stats.unknownAddresses += s.unknownAddresses;
+        stats.divergedAllocations += s.divergedAllocations;
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
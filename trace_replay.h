@@ -0,0 +1,40 @@
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include "adaptive_scheduler.h"
+#include "adaptive_memory_manager.h"
+#include "security_memory_manager.h"
+#include "trace_log.h"
+#include <cstdint>
+
+struct ReplayStats {
+    uint64_t records = 0;
+    uint64_t calls[static_cast<size_t>(TraceOp::COUNT)] = {};
+    uint64_t unknownAddresses = 0;  // Frees and accesses naming no block the replay holds
+    uint64_t divergedAllocations = 0; // Succeeded in the recording but not in the replay, or the reverse
+    double seconds = 0;
+    double callsPerSecond() const { return seconds > 0 ? records / seconds : 0.0; }
+};
+
+// Drives the managers with the calls of a trace as fast as they go.
+// Addresses in the trace are translated to the blocks the replay allocated
+// in their place. With more than one thread, calls are routed by pid to
+// worker threads through SPSC rings, so each process's calls keep their
+// order; calls without a pid (analysis and priority passes) wait for the
+// workers to drain and run on the calling thread.
+class TraceReplayer {
+public:
+    TraceReplayer(AdaptiveScheduler& scheduler, AdaptiveMemoryManager& memory, SecurityMemoryManager& security)
+        : scheduler(scheduler), memory(memory), security(security) {}
+
+    ReplayStats replay(TraceReader& trace, unsigned threads = 1);
+
+private:
+    class Worker;
+
+    AdaptiveScheduler& scheduler;
+    AdaptiveMemoryManager& memory;
+    SecurityMemoryManager& security;
+};
+
+#endif // TRACE_REPLAY_H
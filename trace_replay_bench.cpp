@@ -0,0 +1,95 @@
+// trace_replay_bench.cpp
+// Replays a trace recorded with --record (os_simulation, os_benchmark) into
+// fresh managers as fast as they go, on 1, 2, 4 and 8 threads or the count
+// given, and reports calls/sec. Each run is repeated and the best kept.
+//
+// Usage: trace_replay_bench TRACE [--threads N] [--repeat N] [--slow-tier memory|file|compressed]
+#include "trace_replay.h"
+#include "event_log.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+
+namespace {
+    struct Options {
+        std::string path;
+        unsigned threads = 0; // 0: 1, 2, 4 and 8
+        int repeat = 3;
+        SlowTierMode slowTier = SlowTierMode::SWAP_FILE;
+    };
+
+    bool parseOptions(int argc, char** argv, Options& opts) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.compare(0, 2, "--") != 0) {
+                if (!opts.path.empty()) return false;
+                opts.path = arg;
+                continue;
+            }
+            if (i + 1 >= argc) return false;
+            const char* value = argv[++i];
+            if (arg == "--threads") opts.threads = static_cast<unsigned>(std::atoi(value));
+            else if (arg == "--repeat") opts.repeat = std::atoi(value);
+            else if (arg != "--slow-tier" || !parseSlowTierMode(value, opts.slowTier)) return false;
+        }
+        return !opts.path.empty() && opts.threads <= 256 && opts.repeat > 0;
+    }
+
+    ReplayStats replayOnce(TraceReader& trace, unsigned threads, SlowTierMode slowTier) {
+        auto table = std::make_shared<ProcessTable>();
+        AdaptiveScheduler scheduler(table);
+        AdaptiveMemoryManager memManager(table, slowTier);
+        SecurityMemoryManager secManager(table);
+        TraceReplayer replayer(scheduler, memManager, secManager);
+        trace.rewind();
+        return replayer.replay(trace, threads);
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opts;
+    if (!parseOptions(argc, argv, opts)) {
+        std::cerr << "usage: " << argv[0]
+                  << " TRACE [--threads N] [--repeat N] [--slow-tier memory|file|compressed]\n";
+        return 1;
+    }
+    EventLog::instance().setLevel(LogLevel::OFF);
+    TraceReader trace(opts.path);
+    if (!trace.ok()) {
+        std::cerr << "cannot read " << opts.path << "\n";
+        return 1;
+    }
+
+    std::cout << opts.path << ": " << trace.recordCount() << " calls, " << trace.fileBytes() << " bytes ("
+              << std::fixed << std::setprecision(2) << double(trace.fileBytes()) / std::max<uint64_t>(1, trace.recordCount())
+              << " per call)\n";
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << "\n\n";
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "calls/s" << std::setw(10) << "seconds"
+              << std::setw(10) << "unknown" << std::setw(10) << "diverged" << "\n";
+    ReplayStats last;
+    for (unsigned threads = opts.threads ? opts.threads : 1; threads <= (opts.threads ? opts.threads : 8); threads *= 2) {
+        ReplayStats best;
+        for (int i = 0; i < opts.repeat; ++i) {
+            ReplayStats s = replayOnce(trace, threads, opts.slowTier);
+            if (i == 0 || s.seconds < best.seconds) best = s;
+        }
+        std::cout << std::setw(8) << threads << std::setprecision(0) << std::setw(14) << best.callsPerSecond()
+                  << std::setprecision(3) << std::setw(10) << best.seconds << std::setw(10) << best.unknownAddresses
+                  << std::setw(10) << best.divergedAllocations << "\n";
+        last = best;
+    }
+
+    std::cout << "\ncalls by type:\n";
+    for (size_t i = 0; i < static_cast<size_t>(TraceOp::COUNT); ++i) {
+        if (last.calls[i]) std::cout << "  " << std::setw(20) << std::left << traceOpName(static_cast<TraceOp>(i))
+                                     << std::right << last.calls[i] << "\n";
+    }
+    if (trace.corrupt()) {
+        std::cout << "trace is damaged: replayed up to the first bad chunk of each thread\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "workload.h"
+
+namespace {
+    uint64_t splitmix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ull;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    int uniform(uint64_t h, int lo, int hi) {
+        return lo + static_cast<int>(h % static_cast<uint64_t>(hi - lo + 1));
+    }
+
+    // Profile 0..2, skewed towards `heavy` with probability 2/3 when set
+    int profile(uint64_t h, bool heavy, bool light) {
+        if (heavy && h % 3 != 0) return 2;
+        if (light && h % 3 != 0) return 0;
+        return static_cast<int>((h >> 8) % 3);
+    }
+
+    enum Field : uint64_t { CPU_PROFILE, IO_PROFILE, MEM_PROFILE, SEC_LEVEL, CPU, IO, MEM };
+}
+
+uint64_t workloadHash(uint64_t seed, uint64_t a, uint64_t b) {
+    return splitmix(splitmix(splitmix(seed) ^ a) ^ b);
+}
+
+const char* workloadMixName(WorkloadMix mix) {
+    switch (mix) {
+        case WorkloadMix::CPU_HEAVY: return "cpu";
+        case WorkloadMix::MEMORY_HEAVY: return "memory";
+        case WorkloadMix::SECURE_HEAVY: return "secure";
+        case WorkloadMix::BALANCED: default: return "balanced";
+    }
+}
+
+bool parseWorkloadMix(const std::string& name, WorkloadMix& mix) {
+    for (WorkloadMix m : {WorkloadMix::BALANCED, WorkloadMix::CPU_HEAVY, WorkloadMix::MEMORY_HEAVY,
+                          WorkloadMix::SECURE_HEAVY}) {
+        if (name == workloadMixName(m)) {
+            mix = m;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<SimProcess> makeProcesses(int count, WorkloadMix mix, uint64_t seed, pid_t firstPid) {
+    std::vector<SimProcess> processes;
+    processes.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        pid_t pid = firstPid + i;
+        auto h = [&](Field f) { return workloadHash(seed, static_cast<uint64_t>(pid), f); };
+        SimProcess proc{pid, "proc_" + std::to_string(pid), 0, 0, 0, SecurityLevel::LOW, 0, nullptr, nullptr, {}};
+        proc.cpuProfile = profile(h(CPU_PROFILE), mix == WorkloadMix::CPU_HEAVY, false);
+        proc.ioProfile = profile(h(IO_PROFILE), false, false);
+        proc.memProfile = profile(h(MEM_PROFILE), mix == WorkloadMix::MEMORY_HEAVY, mix == WorkloadMix::CPU_HEAVY);
+        proc.secLevel = static_cast<SecurityLevel>(profile(h(SEC_LEVEL), mix == WorkloadMix::SECURE_HEAVY, false));
+        processes.push_back(std::move(proc));
+    }
+    return processes;
+}
+
+TickEvent tickEvent(const SimProcess& proc, int tick, uint64_t seed) {
+    uint64_t base = workloadHash(seed, static_cast<uint64_t>(proc.pid), static_cast<uint64_t>(tick) << 8);
+    auto h = [&](Field f) { return splitmix(base ^ f); };
+    TickEvent e;
+    e.cpu = uniform(h(CPU), 1, MAX_CPU) * (proc.cpuProfile + 1) / 3;
+    e.io = uniform(h(IO), 1, MAX_IO) * (proc.ioProfile + 1) / 3;
+    e.mem = static_cast<size_t>(uniform(h(MEM), 1024, MAX_MEM) * (proc.memProfile + 1) / 3);
+    return e;
+}
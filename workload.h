@@ -0,0 +1,56 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "memory_region.h"
+#include "process_table.h"
+
+// Synthetic process population and per-tick resource events shared by the
+// simulation and the benchmark. Everything is derived from (seed, pid, tick)
+// with a counter-based hash, so a run is reproducible no matter how many
+// threads replay it or in which order processes are visited.
+
+constexpr int MAX_CPU = 100;
+constexpr int MAX_IO = 100;
+constexpr int MAX_MEM = 16384; // 16MB
+
+enum class WorkloadMix {
+    BALANCED,     // Every profile and security level equally likely
+    CPU_HEAVY,    // Mostly heavy CPU, light memory
+    MEMORY_HEAVY, // Mostly heavy memory
+    SECURE_HEAVY  // Mostly HIGH security regions
+};
+
+struct SimProcess {
+    pid_t pid;
+    std::string name;
+    int cpuProfile; // 0=light, 1=medium, 2=heavy
+    int ioProfile;  // 0=light, 1=medium, 2=heavy
+    int memProfile; // 0=light, 1=medium, 2=heavy
+    SecurityLevel secLevel;
+    size_t memAllocated;
+    void* memAddress; // Current tier allocation, replaced every tick
+    void* secAddress; // Current secure region, replaced every tick
+    ProcessHandle handle; // Slot in the table shared by the three managers
+};
+
+struct TickEvent {
+    int cpu;
+    int io;
+    size_t mem;
+};
+
+const char* workloadMixName(WorkloadMix mix);
+// Accepts balanced, cpu, memory, secure
+bool parseWorkloadMix(const std::string& name, WorkloadMix& mix);
+
+std::vector<SimProcess> makeProcesses(int count, WorkloadMix mix, uint64_t seed, pid_t firstPid = 1000);
+// Resource usage of proc during tick; a pure function of its arguments
+TickEvent tickEvent(const SimProcess& proc, int tick, uint64_t seed);
+// Deterministic 64-bit hash of (seed, a, b) for any other per-tick decision
+uint64_t workloadHash(uint64_t seed, uint64_t a, uint64_t b);
+
+#endif // WORKLOAD_H